@@ -0,0 +1,51 @@
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+# heap_inst_enable_site_ids(<target> [TABLE <file>])
+#
+# Assigns every C/C++ source of <target> a 16-bit file id, passed to the
+# compiler as HEAPINST_FILE_ID, for the HEAPINST_MALLOC()/... macros in
+# heapInst/heapInstSite.h. The id is derived from the source path relative
+# to the project root, so it is stable across build trees and machines.
+#
+# The id -> path table is written to <file> (default:
+# ${CMAKE_CURRENT_BINARY_DIR}/<target>.heapinst_sites), one "0xID path" line
+# per file, for host tools to resolve site ids to file:line.
+function(heap_inst_enable_site_ids target)
+    cmake_parse_arguments(PARSE_ARGV 1 ARG "" "TABLE" "")
+    if(NOT ARG_TABLE)
+        set(ARG_TABLE "${CMAKE_CURRENT_BINARY_DIR}/${target}.heapinst_sites")
+    endif()
+
+    get_target_property(_sources ${target} SOURCES)
+    get_target_property(_source_dir ${target} SOURCE_DIR)
+
+    set(_table "# heapInst site table: file_id path\n")
+    set(_used_ids "")
+    foreach(_src IN LISTS _sources)
+        if(_src MATCHES "\\$<" OR NOT _src MATCHES "\\.(c|cc|cpp|cxx)$")
+            continue()
+        endif()
+        cmake_path(ABSOLUTE_PATH _src BASE_DIRECTORY "${_source_dir}" NORMALIZE
+                   OUTPUT_VARIABLE _abs)
+        cmake_path(RELATIVE_PATH _abs BASE_DIRECTORY "${PROJECT_SOURCE_DIR}"
+                   OUTPUT_VARIABLE _rel)
+
+        # 0 is reserved for "unregistered"; probe past collisions
+        string(MD5 _hash "${_rel}")
+        string(SUBSTRING "${_hash}" 0 4 _hex)
+        math(EXPR _id "0x${_hex}" OUTPUT_FORMAT DECIMAL)
+        while(_id EQUAL 0 OR _id IN_LIST _used_ids)
+            message(WARNING "heap_inst_enable_site_ids: file id collision for ${_rel}")
+            math(EXPR _id "(${_id} + 1) & 0xFFFF")
+        endwhile()
+        list(APPEND _used_ids ${_id})
+        math(EXPR _id_hex "${_id}" OUTPUT_FORMAT HEXADECIMAL)
+
+        set_property(SOURCE "${_abs}" TARGET_DIRECTORY ${target}
+                     APPEND PROPERTY COMPILE_DEFINITIONS HEAPINST_FILE_ID=${_id_hex})
+        string(APPEND _table "${_id_hex} ${_rel}\n")
+    endforeach()
+
+    file(WRITE "${ARG_TABLE}" "${_table}")
+    set_property(TARGET ${target} PROPERTY HEAPINST_SITE_TABLE "${ARG_TABLE}")
+endfunction()
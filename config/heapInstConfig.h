@@ -25,6 +25,205 @@ extern "C" {
 #define HEAPINST_CFG_DEBUG_LOG 1
 #endif
 
+/**
+ * @def HEAPINST_CFG_WRAP_SBRK
+ * @brief Enable/disable recording of program break movement (HEAP_OP_SBRK).
+ *
+ * When enabled (1), heapInst_wrap.c provides a wrapper for the allocator's
+ * break function (_sbrk on newlib, sbrk on Linux) so every arena growth or
+ * trim is recorded with its increment and the resulting break. Host
+ * allocators usually move the break without going through sbrk (glibc's
+ * internal __sbrk, brk), so when sbrk is wrapped the wrappers additionally
+ * poll the break after each allocation call and record any movement with
+ * HEAP_SBRK_FLAG_OBSERVED.
+ *
+ * Requires the matching -Wl,--wrap linker flag, which CMake adds when the
+ * HEAPINST_WRAP_SBRK option is ON.
+ *
+ * Default: 0 (disabled)
+ */
+#ifndef HEAPINST_CFG_WRAP_SBRK
+#define HEAPINST_CFG_WRAP_SBRK 0
+#endif
+
+/**
+ * @def HEAPINST_CFG_SBRK_UNDERSCORE
+ * @brief Which break function HEAPINST_CFG_WRAP_SBRK wraps.
+ *
+ * 1 wraps _sbrk (newlib, cross builds), 0 wraps sbrk (native hosts,
+ * whatever their libc). Set by CMake together with the --wrap flag so the
+ * two always match; the default only serves builds without CMake.
+ *
+ * Default: 1 with newlib, 0 otherwise
+ */
+#ifndef HEAPINST_CFG_SBRK_UNDERSCORE
+#if defined(__NEWLIB__)
+#define HEAPINST_CFG_SBRK_UNDERSCORE 1
+#else
+#define HEAPINST_CFG_SBRK_UNDERSCORE 0
+#endif
+#endif
+
+/**
+ * @def HEAPINST_CFG_RECORD_USABLE_SIZE
+ * @brief Enable/disable recording of the allocator's usable block size.
+ *
+ * When enabled (1), the malloc/calloc/realloc wrappers store
+ * malloc_usable_size() of the returned block in arg4 and set
+ * HEAP_RECORD_FLAG_USABLE_SIZE. The difference to the requested size is the
+ * allocator's rounding slack, i.e. internal fragmentation per size class.
+ *
+ * Default: 0 (disabled)
+ */
+#ifndef HEAPINST_CFG_RECORD_USABLE_SIZE
+#define HEAPINST_CFG_RECORD_USABLE_SIZE 0
+#endif
+
+/**
+ * @def HEAPINST_CFG_STACK_HWM
+ * @brief Enable/disable stack painting and STACK_HWM records.
+ *
+ * When enabled (1), registered stacks are painted with
+ * HEAPINST_CFG_STACK_PAINT_PATTERN and periodically scanned for the deepest
+ * overwritten word. The resulting high-water marks share the heap records'
+ * timestamps, so heap growth and stack growth can be compared directly.
+ *
+ * Default: 0 (disabled)
+ */
+#ifndef HEAPINST_CFG_STACK_HWM
+#define HEAPINST_CFG_STACK_HWM 0
+#endif
+
+/**
+ * @def HEAPINST_CFG_STACK_MAX
+ * @brief Maximum number of stacks that can be registered (one per core on Pico).
+ */
+#ifndef HEAPINST_CFG_STACK_MAX
+#define HEAPINST_CFG_STACK_MAX 2
+#endif
+
+/**
+ * @def HEAPINST_CFG_STACK_SAMPLE_INTERVAL
+ * @brief Number of trace records between automatic stack samples.
+ *
+ * Each sample scans the painted part of every stack, so keep this large on
+ * big stacks. 0 disables automatic sampling; call heap_inst_stack_sample()
+ * instead.
+ *
+ * Default: 64
+ */
+#ifndef HEAPINST_CFG_STACK_SAMPLE_INTERVAL
+#define HEAPINST_CFG_STACK_SAMPLE_INTERVAL 64
+#endif
+
+/**
+ * @def HEAPINST_CFG_STACK_PAINT_PATTERN
+ * @brief 32-bit pattern written to unused stack words.
+ */
+#ifndef HEAPINST_CFG_STACK_PAINT_PATTERN
+#define HEAPINST_CFG_STACK_PAINT_PATTERN 0xA5A5A5A5u
+#endif
+
+/**
+ * @def HEAPINST_CFG_MEMMAP
+ * @brief Enable/disable the static memory map (HEAP_OP_MEMMAP) at init.
+ *
+ * When enabled (1), heap_inst_init() follows the INIT record with one
+ * MEMMAP record per region: .data, .bss, heap, stacks and scratch X/Y from
+ * the Pico linker symbols, or the executable's data/bss, [heap] and [stack]
+ * mappings from /proc/self/maps on Linux hosts.
+ *
+ * Default: 0 (disabled)
+ */
+#ifndef HEAPINST_CFG_MEMMAP
+#define HEAPINST_CFG_MEMMAP 0
+#endif
+
+/**
+ * @def HEAPINST_CFG_TOPK
+ * @brief Enable/disable the on-target heavy-hitter callsite table.
+ *
+ * When enabled (1), every malloc/calloc/realloc updates a fixed-size
+ * Space-Saving table keyed by callsite, readable with heap_inst_topk_get()
+ * and dumped into the trace as HEAP_OP_TOPK records.
+ *
+ * Default: 0 (disabled)
+ */
+#ifndef HEAPINST_CFG_TOPK
+#define HEAPINST_CFG_TOPK 0
+#endif
+
+/**
+ * @def HEAPINST_CFG_TOPK_SLOTS
+ * @brief Number of callsites tracked by the top-K table.
+ *
+ * Each slot costs 24 bytes (32-bit targets); lookups scan all slots.
+ */
+#ifndef HEAPINST_CFG_TOPK_SLOTS
+#define HEAPINST_CFG_TOPK_SLOTS 8
+#endif
+
+/**
+ * @def HEAPINST_CFG_TOPK_DUMP_INTERVAL
+ * @brief Allocations between automatic HEAP_OP_TOPK dumps (0 = manual only).
+ *
+ * Default: 1024
+ */
+#ifndef HEAPINST_CFG_TOPK_DUMP_INTERVAL
+#define HEAPINST_CFG_TOPK_DUMP_INTERVAL 1024
+#endif
+
+/**
+ * @def HEAPINST_CFG_LIVE_TABLE
+ * @brief Enable/disable the in-process live allocation table.
+ *
+ * When enabled (1), every live allocation is tracked in a fixed-size hash
+ * table so heap_inst_checkpoint()/heap_inst_diff() can report per-phase
+ * leaks at run time.
+ *
+ * Default: 0 (disabled)
+ */
+#ifndef HEAPINST_CFG_LIVE_TABLE
+#define HEAPINST_CFG_LIVE_TABLE 0
+#endif
+
+/**
+ * @def HEAPINST_CFG_LIVE_SLOTS
+ * @brief Capacity of the live allocation table (power of two).
+ *
+ * One slot is kept free; allocations beyond that are not tracked and set
+ * the overflow flag. Each slot costs 20 bytes on 32-bit targets.
+ *
+ * Default: 256
+ */
+#ifndef HEAPINST_CFG_LIVE_SLOTS
+#define HEAPINST_CFG_LIVE_SLOTS 256
+#endif
+
+/**
+ * @def HEAPINST_CFG_DIFF_MAX_GROUPS
+ * @brief Distinct callsites/tags reported by heap_inst_diff() before the rest
+ *        are folded into a HEAP_INST_DIFF_KEY_OTHER group.
+ */
+#ifndef HEAPINST_CFG_DIFF_MAX_GROUPS
+#define HEAPINST_CFG_DIFF_MAX_GROUPS 16
+#endif
+
+/**
+ * @def HEAPINST_CFG_RSS_SAMPLER
+ * @brief Enable/disable resident-memory sampling (HEAP_OP_RSS) on Linux hosts.
+ *
+ * When enabled (1), heap_inst_rss_sample() and the background sampler
+ * (heap_inst_rss_sampler_start()) record RSS, anonymous memory and the
+ * mapping count so requested live bytes can be compared with the real
+ * process footprint. Requires pthreads; ignored on non-Linux targets.
+ *
+ * Default: 0 (disabled)
+ */
+#ifndef HEAPINST_CFG_RSS_SAMPLER
+#define HEAPINST_CFG_RSS_SAMPLER 0
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -41,12 +41,34 @@ typedef enum {
     HEAP_OP_MALLOC,
     HEAP_OP_FREE,
     HEAP_OP_REALLOC,
+    HEAP_OP_SBRK,
+    HEAP_OP_STACK_HWM,
+    HEAP_OP_MEMMAP,
+    HEAP_OP_RSS,
+    HEAP_OP_TOPK,
+    HEAP_OP_RESOURCE_ALLOC,
+    HEAP_OP_RESOURCE_FREE,
+    HEAP_OP_MARKER,
+    HEAP_OP_TIME_SYNC,
 } heap_inst_operation_t;
 
+/**
+ * @brief Memory region identifiers carried in HEAP_OP_MEMMAP records.
+ */
+typedef enum {
+    HEAP_MEMMAP_DATA = 0, /* initialized data (.data) */
+    HEAP_MEMMAP_BSS,      /* zero-initialized data (.bss) */
+    HEAP_MEMMAP_HEAP,     /* heap region (__end__..__StackLimit, [heap] on host) */
+    HEAP_MEMMAP_STACK,    /* core 0 / main thread stack */
+    HEAP_MEMMAP_STACK1,   /* core 1 stack */
+    HEAP_MEMMAP_SCRATCH_X, /* .scratch_x contents (SCRATCH_X bank) */
+    HEAP_MEMMAP_SCRATCH_Y, /* .scratch_y contents (SCRATCH_Y bank) */
+} heap_inst_memmap_region_t;
+
 /**
  * @brief Encoded heap operation record written to the trace stream.
  *
- * Fixed 24-byte record format. Fields arg1..arg3 are interpreted based on
+ * Fixed 32-byte record format. Fields arg1..arg4 are interpreted based on
  * the operation type:
  *
  * HEAP_OP_INIT:
@@ -58,6 +80,7 @@ typedef enum {
  *   - arg1: size        - Requested allocation size in bytes
  *   - arg2: ptr         - Returned pointer (or 0 if allocation failed)
  *   - arg3: (unused)
+ *   - arg4: usable_size - malloc_usable_size(ptr) if HEAP_RECORD_FLAG_USABLE_SIZE
  *
  * HEAP_OP_FREE:
  *   - arg1: ptr         - Pointer being freed
@@ -68,22 +91,91 @@ typedef enum {
  *   - arg1: old_ptr     - Original pointer (or 0 for malloc-like behavior)
  *   - arg2: new_size    - Requested new size
  *   - arg3: new_ptr     - Returned pointer (or 0 if reallocation failed)
+ *   - arg4: usable_size - malloc_usable_size(new_ptr) if HEAP_RECORD_FLAG_USABLE_SIZE
+ *
+ * HEAP_OP_SBRK:
+ *   - arg1: increment   - Requested break increment (signed, two's complement)
+ *   - arg2: new_break   - Program break after the call (or 0 if it failed)
+ *   - arg3: flags       - Bit flags (see HEAP_SBRK_FLAG_*)
+ *
+ * HEAP_OP_STACK_HWM:
+ *   - arg1: stack_id    - Registered stack (core number for auto-detected stacks)
+ *   - arg2: hwm         - Deepest stack usage seen so far, in bytes
+ *   - arg3: stack_size  - Total size of the stack region in bytes
+ *
+ * HEAP_OP_MEMMAP (emitted once after INIT, one record per known region):
+ *   - arg1: region      - Region identifier (heap_inst_memmap_region_t)
+ *   - arg2: base        - Start address of the region
+ *   - arg3: size        - Size of the region in bytes
+ *
+ * HEAP_OP_RSS (Linux hosts, HEAPINST_CFG_RSS_SAMPLER):
+ *   - arg1: rss_kb      - Resident set size in KiB
+ *   - arg2: anon_kb     - Resident anonymous memory in KiB
+ *   - arg3: mappings    - Number of entries in /proc/self/maps
+ *
+ * HEAP_OP_TOPK (one record per tracked callsite, site = callsite; flags carry
+ *   HEAP_RECORD_FLAG_SITE_ID when it is a source-location id):
+ *   - arg1: count       - Allocations from the callsite (upper bound)
+ *   - arg2: bytes       - Bytes requested from the callsite (upper bound, saturated)
+ *   - arg3: error       - Maximum overestimate of count
+ *   - arg4: rank        - 0 for the heaviest callsite
+ *
+ * HEAP_OP_RESOURCE_ALLOC (tag = heap id of the memory resource):
+ *   - arg1: size        - Requested size in bytes
+ *   - arg2: ptr         - Returned pointer
+ *   - arg3: alignment   - Requested alignment in bytes
+ *
+ * HEAP_OP_RESOURCE_FREE (tag = heap id of the memory resource):
+ *   - arg1: ptr         - Pointer being released
+ *   - arg2: size        - Size passed to deallocate
+ *   - arg3: alignment   - Alignment passed to deallocate
+ *
+ * HEAP_OP_MARKER (heap_inst_mark()):
+ *   - arg1: marker_id   - Application-defined phase/event id
+ *
+ * HEAP_OP_TIME_SYNC (heap_inst_time_sync(), timestamp_us = local clock):
+ *   - arg1: ref_lo      - Reference clock at the same instant, low 32 bits
+ *   - arg2: ref_hi      - Reference clock, high 32 bits
+ *
+ * Resource records describe allocations from a user memory resource (e.g.
+ * std::pmr via heapinst::traced_resource) and form their own address space
+ * per heap id. If the resource's upstream uses malloc, the underlying
+ * MALLOC/FREE records appear as well; analyzers should not sum the two.
+ *
+ * For MALLOC, REALLOC and FREE, site is the return address of the wrapped
+ * call (with the Thumb bit set on Cortex-M), or a source-location id when
+ * HEAP_RECORD_FLAG_SITE_ID is set, and tag is the value set with
+ * heap_inst_set_tag() when the call was made.
  */
 typedef struct heap_inst_record {
     uint8_t operation;     /* heap_inst_operation_t */
-    uint8_t padding;       /* reserved for alignment/future flags */
-    uint16_t reserved;     /* reserved */
+    uint8_t flags;         /* HEAP_RECORD_FLAG_* */
+    uint16_t tag;          /* allocation tag active at the call (0 = untagged) */
+    uint32_t site;         /* callsite (caller return address), 0 if unknown */
     uint64_t timestamp_us; /* platform-provided timestamp */
     uint32_t arg1;         /* op-specific argument */
     uint32_t arg2;         /* op-specific argument */
     uint32_t arg3;         /* op-specific argument */
+    uint32_t arg4;         /* op-specific argument (0 unless flagged) */
 } heap_inst_record_t;
 
+/**
+ * @brief Flags for the record flags field (valid for every operation).
+ */
+#define HEAP_RECORD_FLAG_USABLE_SIZE  (1 << 0)  /* arg4 holds the allocator's usable size */
+#define HEAP_RECORD_FLAG_SITE_ID      (1 << 1)  /* site is a source-location id (heapInstSite.h) */
+
 /**
  * @brief Flags for HEAP_OP_INIT record arg3 field.
  */
 #define HEAP_INIT_FLAG_HEAP_INFO_VALID  (1 << 0)  /* heap_base and heap_size are valid */
 
+/**
+ * @brief Flags for HEAP_OP_SBRK record arg3 field.
+ */
+#define HEAP_SBRK_FLAG_FAILED    (1 << 0)  /* sbrk returned (void*)-1, break unchanged */
+#define HEAP_SBRK_FLAG_OBSERVED  (1 << 1)  /* break movement observed, not an intercepted call */
+
 /**
  * @brief Platform hooks injected by the port layer.
  */
@@ -115,6 +207,25 @@ typedef struct heap_inst_heap_info {
     size_t heap_size;   /* Total size of heap region in bytes (0 if unknown) */
 } heap_inst_heap_info_t;
 
+/**
+ * @brief Stack region registered for high-water-mark sampling.
+ *
+ * Stacks grow down from stack_bottom + stack_size toward stack_bottom. On
+ * Pico platforms the stack the instrumentation is initialized on (core 0's
+ * __StackBottom..__StackTop, or core 1's __StackOneBottom..__StackOneTop)
+ * is registered automatically as stack id 0 or 1. The other core's stack
+ * is not: it may already be in use. Register it explicitly before the core
+ * starts, e.g. before multicore_launch_core1():
+ *
+ *   extern char __StackOneBottom, __StackOneTop;
+ *   heap_inst_stack_info_t core1 = {&__StackOneBottom, &__StackOneTop - &__StackOneBottom};
+ *   heap_inst_stack_register(1, &core1);
+ */
+typedef struct heap_inst_stack_info {
+    void* stack_bottom; /* Lowest address of the stack region */
+    size_t stack_size;  /* Size of the stack region in bytes */
+} heap_inst_stack_info_t;
+
 /* Platform hooks registration */
 void heap_inst_register_platform_hooks(const heap_inst_platform_hooks_t* hooks);
 
@@ -138,6 +249,217 @@ void heap_inst_init(const heap_inst_heap_info_t* heap_info);
 void heap_inst_flush(void);
 bool heap_inst_is_initialized(void);
 
+/* Stack high-water-mark sampling (HEAPINST_CFG_STACK_HWM) */
+
+/**
+ * @brief Register and paint a stack region for high-water-mark sampling.
+ *
+ * The unused part of the region is filled with a known pattern. If the
+ * calling thread is running on this stack, only the part below the current
+ * stack pointer is painted; otherwise the whole region is, so stacks of other
+ * cores must be registered before those cores start.
+ *
+ * @param stack_id  Identifier reported in STACK_HWM records (0..HEAPINST_CFG_STACK_MAX-1).
+ * @param info      Stack region.
+ * @return 0 on success, -1 if the id/region is invalid or sampling is disabled.
+ */
+int heap_inst_stack_register(uint8_t stack_id, const heap_inst_stack_info_t* info);
+
+/**
+ * @brief Emit a STACK_HWM record for every registered stack.
+ *
+ * Also runs automatically every HEAPINST_CFG_STACK_SAMPLE_INTERVAL records.
+ */
+void heap_inst_stack_sample(void);
+
+/* Resident-memory sampling (Linux hosts, HEAPINST_CFG_RSS_SAMPLER) */
+
+/**
+ * @brief Record the current RSS, anonymous memory and mapping count.
+ *
+ * @return 0 on success, -1 if unsupported, uninitialized or /proc is unreadable.
+ */
+int heap_inst_rss_sample(void);
+
+/**
+ * @brief Start a background thread calling heap_inst_rss_sample() periodically.
+ *
+ * The thread records concurrently with the application: register lock/unlock
+ * hooks (recursive, since a flush may allocate) before starting it.
+ *
+ * @param interval_ms Sampling period in milliseconds (must be non-zero).
+ * @return 0 on success, -1 if unsupported, already running or thread creation failed.
+ */
+int heap_inst_rss_sampler_start(uint32_t interval_ms);
+
+/** @brief Stop and join the sampler thread (no-op if not running). */
+void heap_inst_rss_sampler_stop(void);
+
+/*
+ * Records an allocation/release from a user-defined memory resource (heap id
+ * in the record tag). Unlike the malloc family these are not tracked in the
+ * live table or the top-K table.
+ */
+void heap_inst_record_resource_alloc(uint16_t heap_id, void* ptr, size_t size,
+                                     size_t alignment, const void* site);
+void heap_inst_record_resource_free(uint16_t heap_id, void* ptr, size_t size,
+                                    size_t alignment, const void* site);
+
+/**
+ * @brief Malloc-family calls attributed to a source-location id.
+ *
+ * Used by the HEAPINST_MALLOC()/... macros in heapInstSite.h. They allocate
+ * through the real allocator like the wrapped calls, but record site_id
+ * (with HEAP_RECORD_FLAG_SITE_ID) instead of a return address. Defined in
+ * heapInst_wrap.c, so they need HEAPINST_AUTO_WRAP.
+ */
+void* heap_inst_malloc_site(size_t size, uint32_t site_id);
+void* heap_inst_calloc_site(size_t nmemb, size_t size, uint32_t site_id);
+void* heap_inst_realloc_site(void* ptr, size_t size, uint32_t site_id);
+void heap_inst_free_site(void* ptr, uint32_t site_id);
+
+/* Allocation tags */
+
+/**
+ * @brief Set the tag stamped on subsequent malloc/realloc/free records.
+ *
+ * Tags attribute allocations to a subsystem or container independent of the
+ * callsite. The current tag is per thread on hosts and global on Pico.
+ *
+ * @param tag New tag (0 = untagged).
+ * @return The previous tag, to be restored by the caller.
+ */
+uint16_t heap_inst_set_tag(uint16_t tag);
+
+/** @brief Current allocation tag. */
+uint16_t heap_inst_get_tag(void);
+
+/**
+ * @brief Emit a HEAP_OP_MARKER record.
+ *
+ * Markers delimit phases in the trace (boot done, test case start, ...) so
+ * host tools can snapshot or restrict analysis to a marker range.
+ */
+void heap_inst_mark(uint32_t marker_id);
+
+/**
+ * @brief Emit a HEAP_OP_TIME_SYNC record pairing the local timestamp with
+ * a reference clock reading taken at the same instant.
+ *
+ * When traces from several cores, threads with their own buffers or
+ * devices are merged, the host shifts each stream by (reference - local)
+ * from its latest sync record. Emit one at start-up and then periodically
+ * if the clocks drift, e.g. with the other core's timer or the time from
+ * a host handshake.
+ *
+ * @param reference_us Reference clock in microseconds.
+ */
+void heap_inst_time_sync(uint64_t reference_us);
+
+/* Live allocation table and checkpoints (HEAPINST_CFG_LIVE_TABLE) */
+
+/**
+ * @brief Opaque position in the allocation sequence.
+ */
+typedef struct heap_inst_checkpoint {
+    uint32_t seq;
+} heap_inst_checkpoint_t;
+
+/**
+ * @brief Grouping key for heap_inst_diff().
+ */
+typedef enum {
+    HEAP_INST_DIFF_BY_SITE = 0,
+    HEAP_INST_DIFF_BY_TAG,
+} heap_inst_diff_group_by_t;
+
+/** @brief Group key used for allocations beyond HEAPINST_CFG_DIFF_MAX_GROUPS. */
+#define HEAP_INST_DIFF_KEY_OTHER UINTPTR_MAX
+
+/** @brief heap_inst_diff() result when the live table is compiled out. */
+#define HEAP_INST_DIFF_UNAVAILABLE SIZE_MAX
+
+/**
+ * @brief Allocations still live since a checkpoint, for one callsite or tag.
+ */
+typedef struct heap_inst_diff_entry {
+    uintptr_t key;   /* callsite or tag, HEAP_INST_DIFF_KEY_OTHER for overflow */
+    size_t count;    /* live allocations */
+    size_t bytes;    /* live requested bytes */
+    uint8_t flags;   /* HEAP_RECORD_FLAG_SITE_ID if key is a source-location id */
+} heap_inst_diff_entry_t;
+
+typedef void (*heap_inst_diff_fn)(const heap_inst_diff_entry_t* entry, void* ctx);
+
+/**
+ * @brief Mark the current point in the allocation sequence.
+ */
+heap_inst_checkpoint_t heap_inst_checkpoint(void);
+
+/**
+ * @brief Report allocations made after a checkpoint that are still live.
+ *
+ * A block allocated before the checkpoint and resized after it is not
+ * reported. The callback runs once per group after the table lock has been
+ * released, so it may allocate.
+ *
+ * @param checkpoint Value returned by heap_inst_checkpoint().
+ * @param group_by   Group by callsite or by tag.
+ * @param callback   Called once per group (may be NULL to only count).
+ * @param ctx        Passed to callback.
+ * @return Number of live allocations made since the checkpoint (0 = no leaks),
+ *         or HEAP_INST_DIFF_UNAVAILABLE without HEAPINST_CFG_LIVE_TABLE, so a
+ *         leak check fails instead of passing when the table is compiled out.
+ */
+size_t heap_inst_diff(heap_inst_checkpoint_t checkpoint, heap_inst_diff_group_by_t group_by,
+                      heap_inst_diff_fn callback, void* ctx);
+
+/** @brief Number of allocations currently in the live table. */
+size_t heap_inst_live_get_count(void);
+
+/**
+ * @brief Whether the live table ran out of slots (diffs may then miss leaks).
+ *
+ * Always true without HEAPINST_CFG_LIVE_TABLE: nothing is tracked.
+ */
+bool heap_inst_live_overflowed(void);
+
+/* Heavy-hitter callsites (HEAPINST_CFG_TOPK) */
+
+/**
+ * @brief Callsite entry of the on-target top-K table.
+ *
+ * The table is a Space-Saving sketch with HEAPINST_CFG_TOPK_SLOTS slots: any
+ * callsite with more than total/slots allocations is guaranteed to be
+ * present, and count - error is a lower bound on its true count.
+ */
+typedef struct heap_inst_topk_entry {
+    uintptr_t site;  /* callsite: return address, or source-location id (flags) */
+    uint32_t count;  /* allocations, overestimated by at most error */
+    uint32_t error;  /* count inherited from the evicted callsite */
+    uint64_t bytes;  /* bytes requested (includes the evicted callsite's bytes) */
+    uint8_t flags;   /* HEAP_RECORD_FLAG_SITE_ID if site is a source-location id */
+} heap_inst_topk_entry_t;
+
+/**
+ * @brief Copy the tracked callsites, heaviest first.
+ *
+ * @param out         Destination array.
+ * @param max_entries Capacity of out.
+ * @return Number of entries written.
+ */
+size_t heap_inst_topk_get(heap_inst_topk_entry_t* out, size_t max_entries);
+
+/**
+ * @brief Emit one HEAP_OP_TOPK record per tracked callsite.
+ *
+ * Also runs automatically every HEAPINST_CFG_TOPK_DUMP_INTERVAL allocations.
+ */
+void heap_inst_topk_dump(void);
+
+/** @brief Clear the top-K table. */
+void heap_inst_topk_reset(void);
+
 /* Buffer status helpers */
 size_t heap_inst_get_buffer_count(void);
 size_t heap_inst_get_buffer_capacity(void);
@@ -149,10 +471,32 @@ size_t heap_inst_get_buffer_capacity(void);
  *
  * Applications should NOT call these directly - they are called automatically
  * by the linker-wrapped malloc/free/realloc/calloc functions.
+ *
+ * usable_size is the block size reported by the allocator (0 if unknown);
+ * the difference to the requested size is the per-block slack. site is the
+ * return address of the intercepted call (NULL if unknown); the *_site
+ * variants take a source-location id instead.
+ */
+void heap_inst_record_malloc(size_t size, void* result, size_t usable_size,
+                             const void* site);
+void heap_inst_record_free(void* ptr, const void* site);
+void heap_inst_record_realloc(void* old_ptr, size_t new_size, void* result,
+                              size_t usable_size, const void* site);
+void heap_inst_record_malloc_site(size_t size, void* result,
+                                  size_t usable_size, uint32_t site_id);
+void heap_inst_record_free_site(void* ptr, uint32_t site_id);
+void heap_inst_record_realloc_site(void* old_ptr, size_t new_size,
+                                   void* result, size_t usable_size,
+                                   uint32_t site_id);
+
+/*
+ * Records a change of the program break (heap arena growth or trim).
+ *
+ * Called by the optional _sbrk/sbrk wrapper (HEAPINST_WRAP_SBRK). prev_break
+ * is the value returned by sbrk ((void*)-1 on failure); the new break is
+ * derived from it and the increment.
  */
-void heap_inst_record_malloc(size_t size, void* result);
-void heap_inst_record_free(void* ptr);
-void heap_inst_record_realloc(void* old_ptr, size_t new_size, void* result);
+void heap_inst_record_sbrk(intptr_t increment, void* prev_break, uint32_t flags);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,119 @@
+/**
+ * @file heapInstAllocator.hpp
+ * @brief Header-only tagged allocator for per-container heap accounting.
+ *
+ * heapinst::tracking_allocator<T, Tag> allocates through malloc/free from
+ * inline code, so the calls are compiled into the application and pass
+ * through the linker-wrapped (instrumented) path, with the allocation tag
+ * set to Tag for their duration. Give each container its own tag to see
+ * which one causes the realloc churn in the trace:
+ *
+ *   std::vector<Sample, heapinst::tracking_allocator<Sample, 12>> samples;
+ *   std::map<int, Item, std::less<int>,
+ *            heapinst::tracking_allocator<std::pair<const int, Item>, 13>> items;
+ *
+ * Note: on hosts, operator new inside a shared libstdc++ bypasses --wrap,
+ * so containers using std::allocator may not appear in the trace at all.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+#include "heapInst/heapInst.h"
+
+namespace heapinst
+{
+
+/**
+ * @brief Sets the allocation tag for the lifetime of the object.
+ */
+class scoped_tag
+{
+   public:
+    explicit scoped_tag(uint16_t tag) noexcept : previous_(heap_inst_set_tag(tag)) {}
+    ~scoped_tag() { heap_inst_set_tag(previous_); }
+
+    scoped_tag(const scoped_tag&) = delete;
+    scoped_tag& operator=(const scoped_tag&) = delete;
+
+   private:
+    uint16_t previous_;
+};
+
+/**
+ * @brief Standard allocator recording its allocations under tag Tag.
+ *
+ * Stateless: all instances compare equal, so containers can swap and move
+ * storage freely. Types with extended alignment are not supported since
+ * only malloc/free are instrumented.
+ */
+template <class T, uint16_t Tag>
+class tracking_allocator
+{
+   public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using propagate_on_container_move_assignment = std::true_type;
+    using is_always_equal = std::true_type;
+
+    static constexpr uint16_t tag = Tag;
+
+    /* Tag is a non-type parameter, so allocator_traits cannot rebind on its own */
+    template <class U>
+    struct rebind {
+        using other = tracking_allocator<U, Tag>;
+    };
+
+    tracking_allocator() noexcept = default;
+
+    template <class U>
+    tracking_allocator(const tracking_allocator<U, Tag>&) noexcept
+    {
+    }
+
+    T* allocate(size_type n)
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t),
+                      "tracking_allocator does not support over-aligned types");
+
+        if (n > std::numeric_limits<size_type>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+
+        scoped_tag scope(Tag);
+        void* p = std::malloc(n * sizeof(T));
+        if (p == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_type) noexcept
+    {
+        scoped_tag scope(Tag);
+        std::free(p);
+    }
+};
+
+template <class T, class U, uint16_t Tag>
+constexpr bool operator==(const tracking_allocator<T, Tag>&, const tracking_allocator<U, Tag>&) noexcept
+{
+    return true;
+}
+
+template <class T, class U, uint16_t Tag>
+constexpr bool operator!=(const tracking_allocator<T, Tag>&, const tracking_allocator<U, Tag>&) noexcept
+{
+    return false;
+}
+
+}  // namespace heapinst
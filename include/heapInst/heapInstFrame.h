@@ -0,0 +1,76 @@
+/**
+ * @file heapInstFrame.h
+ * @brief Framing of trace records for lossy transports (UDP, serial).
+ *
+ * The filesystem and semihosting ports write the bare record stream, which
+ * is fine on a reliable channel. On UDP or a UART, datagram boundaries and
+ * bytes get lost without any trace of it. Framed transports therefore send
+ *
+ *   heap_inst_frame_header_t | record_count x heap_inst_record_t
+ *
+ * where sequence counts frames per device (so the receiver can count lost
+ * and late frames) and crc32 is the CRC-32 (IEEE 802.3, as zlib) of the
+ * first 12 header bytes followed by the records. On a byte stream the
+ * receiver resynchronizes on the magic. All fields are little-endian.
+ *
+ * stream/udp is the port that frames its output. heapinst_analyze receive
+ * expects frames on every input, --serial and --tcp included, so a UART or
+ * TCP port has to build the same frames; bare record streams (semihosting,
+ * filesystem) are read by the analyzer directly as trace files instead.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#ifndef HEAPINST_FRAME_H
+#define HEAPINST_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HEAP_INST_FRAME_MAGIC 0x46495048u /* "HPIF" */
+
+/* Receivers reject larger frames as corrupt */
+#define HEAP_INST_FRAME_MAX_RECORDS 1024u
+
+typedef struct heap_inst_frame_header {
+    uint32_t magic;
+    uint16_t device_id;
+    uint16_t record_count;
+    uint32_t sequence;
+    uint32_t crc32;
+} heap_inst_frame_header_t;
+
+/* Bytes of the header covered by crc32 */
+#define HEAP_INST_FRAME_CRC_OFFSET 12u
+
+/**
+ * @brief Continue a CRC-32 over len bytes; start (and finish) with crc = 0.
+ *
+ * Nibble table: 64 bytes of constants, two lookups per byte.
+ */
+static inline uint32_t heap_inst_crc32(uint32_t crc, const void* data, size_t len)
+{
+    static const uint32_t table[16] = {
+        0x00000000u, 0x1db71064u, 0x3b6e20c8u, 0x26d930acu, 0x76dc4190u, 0x6b6b51f4u, 0x4db26158u, 0x5005713cu,
+        0xedb88320u, 0xf00f9344u, 0xd6d6a3e8u, 0xcb61b38cu, 0x9b64c2b0u, 0x86d3d2d4u, 0xa00ae278u, 0xbdbdf21cu,
+    };
+    const uint8_t* p = (const uint8_t*)data;
+
+    crc = ~crc;
+    while (len-- > 0) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ table[crc & 0x0f];
+        crc = (crc >> 4) ^ table[crc & 0x0f];
+    }
+    return ~crc;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEAPINST_FRAME_H */
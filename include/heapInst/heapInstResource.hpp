@@ -0,0 +1,78 @@
+/**
+ * @file heapInstResource.hpp
+ * @brief std::pmr::memory_resource adapter recording into the heap trace.
+ *
+ * heapinst::traced_resource forwards to an upstream memory resource and
+ * records every do_allocate/do_deallocate (size and alignment) as
+ * HEAP_OP_RESOURCE_ALLOC/FREE under a caller-chosen heap id. Wrapping a
+ * monotonic_buffer_resource or pool resource makes pmr users visible in the
+ * same trace as malloc, so the effect of moving to pmr can be measured:
+ *
+ *   std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer));
+ *   heapinst::traced_resource traced(3, &arena);
+ *   std::pmr::vector<int> values(&traced);
+ *
+ * Requires C++17.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+#include "heapInst/heapInst.h"
+
+namespace heapinst
+{
+
+/**
+ * @brief Memory resource that records allocations made through it.
+ *
+ * Not copyable; the upstream resource must outlive it. Thread safety is
+ * that of the upstream resource.
+ */
+class traced_resource : public std::pmr::memory_resource
+{
+   public:
+    explicit traced_resource(uint16_t heap_id,
+                             std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept
+        : heap_id_(heap_id), upstream_(upstream)
+    {
+    }
+
+    traced_resource(const traced_resource&) = delete;
+    traced_resource& operator=(const traced_resource&) = delete;
+
+    uint16_t heap_id() const noexcept { return heap_id_; }
+    std::pmr::memory_resource* upstream_resource() const noexcept { return upstream_; }
+
+   protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        void* p = upstream_->allocate(bytes, alignment);
+        heap_inst_record_resource_alloc(heap_id_, p, bytes, alignment,
+                                        __builtin_return_address(0));
+        return p;
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+    {
+        heap_inst_record_resource_free(heap_id_, p, bytes, alignment,
+                                       __builtin_return_address(0));
+        upstream_->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+   private:
+    uint16_t heap_id_;
+    std::pmr::memory_resource* upstream_;
+};
+
+}  // namespace heapinst
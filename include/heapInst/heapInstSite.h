@@ -0,0 +1,64 @@
+/**
+ * @file heapInstSite.h
+ * @brief Source-location (file:line) attribution for malloc-family calls.
+ *
+ * Return addresses need the exact firmware image and a symbolizer to map
+ * back to source. With site ids, HEAPINST_MALLOC() and friends record a
+ * compile-time constant instead:
+ *
+ *   site = (HEAPINST_FILE_ID << 16) | __LINE__
+ *
+ * HEAPINST_FILE_ID is assigned per source file by the CMake function
+ * heap_inst_enable_site_ids(<target>), which also writes the id -> path
+ * table next to the build (<target>.heapinst_sites). Records carrying a
+ * site id have HEAP_RECORD_FLAG_SITE_ID set.
+ *
+ *   char* name = HEAPINST_MALLOC(len + 1);
+ *   ...
+ *   HEAPINST_FREE(name);
+ *
+ * Defining HEAPINST_SITE_REDEFINE_MALLOC before including this header maps
+ * malloc/calloc/realloc/free onto the macros for the rest of the file; do
+ * that after all system headers. The macros call heap_inst_malloc_site() and
+ * friends from heapInst_wrap.c, so HEAPINST_AUTO_WRAP must be enabled. The id
+ * travels with the call itself, so concurrent allocations on the other core
+ * or in an ISR are never attributed to it.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#ifndef HEAPINST_SITE_H
+#define HEAPINST_SITE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "heapInst/heapInst.h"
+
+#ifndef HEAPINST_FILE_ID
+/* File not registered with heap_inst_enable_site_ids(): line number only */
+#define HEAPINST_FILE_ID 0
+#endif
+
+/** @brief Site id of the current source line. */
+#define HEAPINST_SITE_ID ((uint32_t)(((uint32_t)(HEAPINST_FILE_ID) << 16) | ((uint32_t)__LINE__ & 0xFFFFu)))
+
+/** @brief Extract the file id / line number from a site id. */
+#define HEAPINST_SITE_FILE(site_id) ((uint16_t)((site_id) >> 16))
+#define HEAPINST_SITE_LINE(site_id) ((uint16_t)((site_id) & 0xFFFFu))
+
+#define HEAPINST_MALLOC(size) heap_inst_malloc_site((size), HEAPINST_SITE_ID)
+#define HEAPINST_CALLOC(nmemb, size) heap_inst_calloc_site((nmemb), (size), HEAPINST_SITE_ID)
+#define HEAPINST_REALLOC(ptr, size) heap_inst_realloc_site((ptr), (size), HEAPINST_SITE_ID)
+#define HEAPINST_FREE(ptr) heap_inst_free_site((ptr), HEAPINST_SITE_ID)
+
+#endif /* HEAPINST_SITE_H */
+
+/* Outside the include guard so a later include can still opt in */
+#if defined(HEAPINST_SITE_REDEFINE_MALLOC) && !defined(HEAPINST_SITE_MALLOC_REDEFINED)
+#define HEAPINST_SITE_MALLOC_REDEFINED
+#define malloc(size) HEAPINST_MALLOC(size)
+#define calloc(nmemb, size) HEAPINST_CALLOC(nmemb, size)
+#define realloc(ptr, size) HEAPINST_REALLOC(ptr, size)
+#define free(ptr) HEAPINST_FREE(ptr)
+#endif
@@ -1,6 +1,7 @@
 #include "heapInst/heapInst.h"
 #include "heapInstConfig.h"
 #include "heapInstStream.h"
+#include "heapInst_internal.h"
 
 #include <inttypes.h>
 #include <stdarg.h>
@@ -9,21 +10,25 @@
 #include <stdio.h>
 #include <string.h>
 
+_Static_assert(sizeof(heap_inst_record_t) == 32,
+               "heap_inst_record_t is part of the trace format and must stay 32 bytes");
+
 // Static buffer for tracking heap operations
 static heap_inst_record_t heap_buffer[HEAP_INST_BUFFER_SIZE / sizeof(heap_inst_record_t)];
 static size_t buffer_index = 0;
 static bool tracker_initialized = false;
 static bool streamport_available = false;
 static heap_inst_platform_hooks_t g_platform_hooks = {0};
+static HEAPINST_THREAD_LOCAL uint16_t g_current_tag = 0;
 
-static void heapInst_lock(void)
+void heapInst_lock(void)
 {
     if (g_platform_hooks.lock) {
         g_platform_hooks.lock(g_platform_hooks.lock_ctx);
     }
 }
 
-static void heapInst_unlock(void)
+void heapInst_unlock(void)
 {
     if (g_platform_hooks.unlock) {
         g_platform_hooks.unlock(g_platform_hooks.unlock_ctx);
@@ -31,7 +36,7 @@ static void heapInst_unlock(void)
 }
 
 #if HEAPINST_CFG_DEBUG_LOG
-static void heap_inst_logf(const char* fmt, ...)
+void heap_inst_logf(const char* fmt, ...)
 {
     char msg[256];
     va_list args;
@@ -45,11 +50,9 @@ static void heap_inst_logf(const char* fmt, ...)
         fputs(msg, stdout);
     }
 }
-#else
-#define heap_inst_logf(...) ((void)0)
 #endif  // HEAPINST_CFG_DEBUG_LOG
 
-static uint64_t heap_inst_timestamp_us(void)
+uint64_t heap_inst_timestamp_us(void)
 {
     if (g_platform_hooks.timestamp_us) {
         return g_platform_hooks.timestamp_us(g_platform_hooks.timestamp_ctx);
@@ -92,6 +95,12 @@ static void flush_buffer_to_transport(void)
             heap_inst_logf("RECORD:%zu,OP:%u,TIME:%llu", i,
                            (unsigned int)rec->operation,
                            (unsigned long long)rec->timestamp_us);
+            if (rec->site != 0) {
+                heap_inst_logf(",SITE:0x%" PRIx32, rec->site);
+            }
+            if (rec->tag != 0) {
+                heap_inst_logf(",TAG:%u", (unsigned int)rec->tag);
+            }
 
             switch (rec->operation) {
                 case HEAP_OP_INIT:
@@ -102,6 +111,9 @@ static void flush_buffer_to_transport(void)
                 case HEAP_OP_MALLOC:
                     heap_inst_logf(",SIZE:%" PRIu32 ",PTR:0x%" PRIx32, rec->arg1,
                                    rec->arg2);
+                    if (rec->flags & HEAP_RECORD_FLAG_USABLE_SIZE) {
+                        heap_inst_logf(",USABLE:%" PRIu32, rec->arg4);
+                    }
                     break;
                 case HEAP_OP_FREE:
                     heap_inst_logf(",PTR:0x%" PRIx32, rec->arg1);
@@ -110,6 +122,52 @@ static void flush_buffer_to_transport(void)
                     heap_inst_logf(",OLD_PTR:0x%" PRIx32 ",SIZE:%" PRIu32
                                    ",NEW_PTR:0x%" PRIx32,
                                    rec->arg1, rec->arg2, rec->arg3);
+                    if (rec->flags & HEAP_RECORD_FLAG_USABLE_SIZE) {
+                        heap_inst_logf(",USABLE:%" PRIu32, rec->arg4);
+                    }
+                    break;
+                case HEAP_OP_SBRK:
+                    heap_inst_logf(",INCR:%" PRId32 ",BREAK:0x%" PRIx32
+                                   ",FLAGS:0x%" PRIx32,
+                                   (int32_t)rec->arg1, rec->arg2, rec->arg3);
+                    break;
+                case HEAP_OP_STACK_HWM:
+                    heap_inst_logf(",STACK:%" PRIu32 ",HWM:%" PRIu32
+                                   ",SIZE:%" PRIu32,
+                                   rec->arg1, rec->arg2, rec->arg3);
+                    break;
+                case HEAP_OP_RSS:
+                    heap_inst_logf(",RSS_KB:%" PRIu32 ",ANON_KB:%" PRIu32
+                                   ",MAPS:%" PRIu32,
+                                   rec->arg1, rec->arg2, rec->arg3);
+                    break;
+                case HEAP_OP_TOPK:
+                    heap_inst_logf(",COUNT:%" PRIu32 ",BYTES:%" PRIu32
+                                   ",ERROR:%" PRIu32 ",RANK:%" PRIu32,
+                                   rec->arg1, rec->arg2, rec->arg3, rec->arg4);
+                    break;
+                case HEAP_OP_RESOURCE_ALLOC:
+                    heap_inst_logf(",SIZE:%" PRIu32 ",PTR:0x%" PRIx32
+                                   ",ALIGN:%" PRIu32,
+                                   rec->arg1, rec->arg2, rec->arg3);
+                    break;
+                case HEAP_OP_RESOURCE_FREE:
+                    heap_inst_logf(",PTR:0x%" PRIx32 ",SIZE:%" PRIu32
+                                   ",ALIGN:%" PRIu32,
+                                   rec->arg1, rec->arg2, rec->arg3);
+                    break;
+                case HEAP_OP_MARKER:
+                    heap_inst_logf(",MARKER:%" PRIu32, rec->arg1);
+                    break;
+                case HEAP_OP_MEMMAP:
+                    heap_inst_logf(",REGION:%" PRIu32 ",BASE:0x%" PRIx32
+                                   ",SIZE:%" PRIu32,
+                                   rec->arg1, rec->arg2, rec->arg3);
+                    break;
+                case HEAP_OP_TIME_SYNC:
+                    heap_inst_logf(",REF:%llu",
+                                   (unsigned long long)(rec->arg1 |
+                                                        ((uint64_t)rec->arg2 << 32)));
                     break;
                 default:
                     break;
@@ -123,7 +181,7 @@ static void flush_buffer_to_transport(void)
 }
 
 // Function to add operation to buffer
-static void log_heap_operation(const heap_inst_record_t* record)
+void heap_inst_log_record(const heap_inst_record_t* record)
 {
     heapInst_lock();
 
@@ -136,6 +194,8 @@ static void log_heap_operation(const heap_inst_record_t* record)
     heap_buffer[buffer_index++] = *record;
 
     heapInst_unlock();
+
+    heap_inst_stack_tick();
 }
 
 /*
@@ -202,10 +262,13 @@ void heap_inst_init(const heap_inst_heap_info_t* heap_info)
         .arg1 = heap_base,
         .arg2 = heap_size,
         .arg3 = flags,
-        .padding = 0,
-        .reserved = 0};
+        .flags = 0,
+        .tag = 0};
+
+    heap_inst_log_record(&init_record);
 
-    log_heap_operation(&init_record);
+    heap_inst_memmap_emit(current_time);
+    heap_inst_stack_init();
 
     heap_inst_logf("[HEAP_TRACKER] Initialized - buffer size: %zu records\n",
                    sizeof(heap_buffer) / sizeof(heap_buffer[0]));
@@ -235,39 +298,60 @@ bool heap_inst_is_initialized(void) { return tracker_initialized; }
  * the buffering and transport logic.
  */
 
-void heap_inst_record_malloc(size_t size, void* result)
+/*
+ * The site of a malloc-family record is either the wrapper's return address
+ * or, for the heap_inst_*_site() entry points (heapInstSite.h), a
+ * source-location id flagged with HEAP_RECORD_FLAG_SITE_ID. The id is passed
+ * down the call chain rather than parked in shared state, so another core or
+ * an ISR allocating in between cannot pick it up.
+ */
+static void record_malloc(size_t size, void* result, size_t usable_size,
+                          uintptr_t callsite, uint8_t flags)
 {
     if (!tracker_initialized) {
         heap_inst_init(NULL);
     }
 
+    if (usable_size) {
+        flags |= HEAP_RECORD_FLAG_USABLE_SIZE;
+    }
+
     heap_inst_record_t record = {
         .operation = HEAP_OP_MALLOC,
+        .tag = g_current_tag,
+        .site = (uint32_t)callsite,
         .timestamp_us = heap_inst_timestamp_us(),
         .arg1 = (uint32_t)size,
         .arg2 = (uint32_t)(uintptr_t)result,
         .arg3 = 0,
-        .padding = 0};
+        .arg4 = (uint32_t)usable_size,
+        .flags = flags};
 
-    log_heap_operation(&record);
+    heap_inst_log_record(&record);
+    heap_inst_live_alloc(result, size, callsite,
+                         flags & HEAP_RECORD_FLAG_SITE_ID, g_current_tag);
+    heap_inst_topk_update(callsite, flags & HEAP_RECORD_FLAG_SITE_ID, size);
     heap_inst_logf("[MALLOC] Requested %zu bytes, allocated at %p\n", size,
                    result);
 }
 
-void heap_inst_record_free(void* ptr)
+static void record_free(void* ptr, uintptr_t callsite, uint8_t flags)
 {
     if (!tracker_initialized) {
         heap_inst_init(NULL);
     }
 
     heap_inst_record_t record = {.operation = HEAP_OP_FREE,
+                                 .tag = g_current_tag,
+                                 .site = (uint32_t)callsite,
                                  .timestamp_us = heap_inst_timestamp_us(),
                                  .arg1 = (uint32_t)(uintptr_t)ptr,
                                  .arg2 = 0,
                                  .arg3 = 0,
-                                 .padding = 0};
+                                 .flags = flags};
 
-    log_heap_operation(&record);
+    heap_inst_log_record(&record);
+    heap_inst_live_free(ptr);
 
     if (ptr != NULL) {
         heap_inst_logf("[FREE] Releasing memory at %p\n", ptr);
@@ -276,21 +360,36 @@ void heap_inst_record_free(void* ptr)
     }
 }
 
-void heap_inst_record_realloc(void* old_ptr, size_t new_size, void* result)
+static void record_realloc(void* old_ptr, size_t new_size, void* result,
+                           size_t usable_size, uintptr_t callsite,
+                           uint8_t flags)
 {
     if (!tracker_initialized) {
         heap_inst_init(NULL);
     }
 
+    if (usable_size) {
+        flags |= HEAP_RECORD_FLAG_USABLE_SIZE;
+    }
+
     heap_inst_record_t record = {
         .operation = HEAP_OP_REALLOC,
+        .tag = g_current_tag,
+        .site = (uint32_t)callsite,
         .timestamp_us = heap_inst_timestamp_us(),
         .arg1 = (uint32_t)(uintptr_t)old_ptr,
         .arg2 = (uint32_t)new_size,
         .arg3 = (uint32_t)(uintptr_t)result,
-        .padding = 0};
-
-    log_heap_operation(&record);
+        .arg4 = (uint32_t)usable_size,
+        .flags = flags};
+
+    heap_inst_log_record(&record);
+    heap_inst_live_realloc(old_ptr, result, new_size, callsite,
+                           flags & HEAP_RECORD_FLAG_SITE_ID, g_current_tag);
+    if (new_size > 0) {
+        heap_inst_topk_update(callsite, flags & HEAP_RECORD_FLAG_SITE_ID,
+                              new_size);
+    }
 
     if (old_ptr == NULL) {
         heap_inst_logf(
@@ -304,6 +403,159 @@ void heap_inst_record_realloc(void* old_ptr, size_t new_size, void* result)
     }
 }
 
+void heap_inst_record_malloc(size_t size, void* result, size_t usable_size,
+                             const void* site)
+{
+    record_malloc(size, result, usable_size, (uintptr_t)site, 0);
+}
+
+void heap_inst_record_malloc_site(size_t size, void* result,
+                                  size_t usable_size, uint32_t site_id)
+{
+    record_malloc(size, result, usable_size, site_id,
+                  HEAP_RECORD_FLAG_SITE_ID);
+}
+
+void heap_inst_record_free(void* ptr, const void* site)
+{
+    record_free(ptr, (uintptr_t)site, 0);
+}
+
+void heap_inst_record_free_site(void* ptr, uint32_t site_id)
+{
+    record_free(ptr, site_id, HEAP_RECORD_FLAG_SITE_ID);
+}
+
+void heap_inst_record_realloc(void* old_ptr, size_t new_size, void* result,
+                              size_t usable_size, const void* site)
+{
+    record_realloc(old_ptr, new_size, result, usable_size, (uintptr_t)site, 0);
+}
+
+void heap_inst_record_realloc_site(void* old_ptr, size_t new_size,
+                                   void* result, size_t usable_size,
+                                   uint32_t site_id)
+{
+    record_realloc(old_ptr, new_size, result, usable_size, site_id,
+                   HEAP_RECORD_FLAG_SITE_ID);
+}
+
+void heap_inst_record_sbrk(intptr_t increment, void* prev_break, uint32_t flags)
+{
+    if (!tracker_initialized) {
+        heap_inst_init(NULL);
+    }
+
+    uint32_t new_break = 0;
+    if (prev_break == (void*)-1) {
+        flags |= HEAP_SBRK_FLAG_FAILED;
+    } else {
+        new_break = (uint32_t)((uintptr_t)prev_break + (uintptr_t)increment);
+    }
+
+    heap_inst_record_t record = {
+        .operation = HEAP_OP_SBRK,
+        .timestamp_us = heap_inst_timestamp_us(),
+        .arg1 = (uint32_t)increment,
+        .arg2 = new_break,
+        .arg3 = flags,
+        .flags = 0};
+
+    heap_inst_log_record(&record);
+
+    if (flags & HEAP_SBRK_FLAG_FAILED) {
+        heap_inst_logf("[SBRK] %+ld bytes FAILED\n", (long)increment);
+    } else {
+        heap_inst_logf("[SBRK] %+ld bytes, break now 0x%08" PRIx32 "\n",
+                       (long)increment, new_break);
+    }
+}
+
+void heap_inst_record_resource_alloc(uint16_t heap_id, void* ptr, size_t size,
+                                     size_t alignment, const void* site)
+{
+    if (!tracker_initialized) {
+        heap_inst_init(NULL);
+    }
+
+    heap_inst_record_t record = {
+        .operation = HEAP_OP_RESOURCE_ALLOC,
+        .tag = heap_id,
+        .site = (uint32_t)(uintptr_t)site,
+        .timestamp_us = heap_inst_timestamp_us(),
+        .arg1 = (uint32_t)size,
+        .arg2 = (uint32_t)(uintptr_t)ptr,
+        .arg3 = (uint32_t)alignment,
+        .flags = 0};
+
+    heap_inst_log_record(&record);
+    heap_inst_logf("[RESOURCE %u] Allocated %zu bytes (align %zu) at %p\n",
+                   (unsigned int)heap_id, size, alignment, ptr);
+}
+
+void heap_inst_record_resource_free(uint16_t heap_id, void* ptr, size_t size,
+                                    size_t alignment, const void* site)
+{
+    if (!tracker_initialized) {
+        heap_inst_init(NULL);
+    }
+
+    heap_inst_record_t record = {
+        .operation = HEAP_OP_RESOURCE_FREE,
+        .tag = heap_id,
+        .site = (uint32_t)(uintptr_t)site,
+        .timestamp_us = heap_inst_timestamp_us(),
+        .arg1 = (uint32_t)(uintptr_t)ptr,
+        .arg2 = (uint32_t)size,
+        .arg3 = (uint32_t)alignment,
+        .flags = 0};
+
+    heap_inst_log_record(&record);
+    heap_inst_logf("[RESOURCE %u] Released %zu bytes at %p\n",
+                   (unsigned int)heap_id, size, ptr);
+}
+
+uint16_t heap_inst_set_tag(uint16_t tag)
+{
+    uint16_t previous = g_current_tag;
+    g_current_tag = tag;
+    return previous;
+}
+
+uint16_t heap_inst_get_tag(void) { return g_current_tag; }
+
+void heap_inst_mark(uint32_t marker_id)
+{
+    if (!tracker_initialized) {
+        heap_inst_init(NULL);
+    }
+
+    heap_inst_record_t record = {
+        .operation = HEAP_OP_MARKER,
+        .tag = g_current_tag,
+        .timestamp_us = heap_inst_timestamp_us(),
+        .arg1 = marker_id,
+        .flags = 0};
+
+    heap_inst_log_record(&record);
+}
+
+void heap_inst_time_sync(uint64_t reference_us)
+{
+    if (!tracker_initialized) {
+        heap_inst_init(NULL);
+    }
+
+    heap_inst_record_t record = {
+        .operation = HEAP_OP_TIME_SYNC,
+        .timestamp_us = heap_inst_timestamp_us(),
+        .arg1 = (uint32_t)reference_us,
+        .arg2 = (uint32_t)(reference_us >> 32),
+        .flags = 0};
+
+    heap_inst_log_record(&record);
+}
+
 size_t heap_inst_get_buffer_count(void) { return buffer_index; }
 
 size_t heap_inst_get_buffer_capacity(void)
@@ -329,5 +581,9 @@ void heap_inst_test_reset(void)
     buffer_index = 0;
     memset(heap_buffer, 0, sizeof(heap_buffer));
     memset(&g_platform_hooks, 0, sizeof(g_platform_hooks));
+    heap_inst_stack_reset();
+    heap_inst_topk_reset();
+    heap_inst_live_reset();
+    g_current_tag = 0;
 }
 #endif
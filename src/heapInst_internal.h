@@ -0,0 +1,73 @@
+/**
+ * @file heapInst_internal.h
+ * @brief Interfaces shared between the heapInstCore translation units.
+ *
+ * Not part of the public API. heapInst.c owns the record buffer and platform
+ * hooks; feature modules (stack sampling, ...) emit their records through
+ * heap_inst_log_record() so buffering, locking and flushing stay in one place.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include "heapInst/heapInst.h"
+#include "heapInstConfig.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Per-thread state on hosts; Pico targets run without TLS support. */
+#if defined(__arm__) || defined(__ARM_ARCH)
+#define HEAPINST_THREAD_LOCAL
+#else
+#define HEAPINST_THREAD_LOCAL _Thread_local
+#endif
+
+/* Append a record to the trace buffer, flushing first if it is full. */
+void heap_inst_log_record(const heap_inst_record_t* record);
+
+/* Buffer protection via the registered lock/unlock hooks (no-ops if unset). */
+void heapInst_lock(void);
+void heapInst_unlock(void);
+
+/* Current time from the registered timestamp hook (0 if none). */
+uint64_t heap_inst_timestamp_us(void);
+
+#if HEAPINST_CFG_DEBUG_LOG
+void heap_inst_logf(const char* fmt, ...);
+#else
+#define heap_inst_logf(...) ((void)0)
+#endif
+
+/* heapInst_stack.c */
+void heap_inst_stack_init(void);
+void heap_inst_stack_tick(void);
+void heap_inst_stack_reset(void);
+
+/*
+ * site_flags is HEAP_RECORD_FLAG_SITE_ID when site is a source-location id
+ * rather than a return address; the two never share a key.
+ */
+
+/* heapInst_topk.c */
+void heap_inst_topk_update(uintptr_t site, uint8_t site_flags, size_t size);
+
+/* heapInst_live.c */
+void heap_inst_live_alloc(void* ptr, size_t size, uintptr_t site, uint8_t site_flags, uint16_t tag);
+void heap_inst_live_realloc(void* old_ptr, void* new_ptr, size_t size, uintptr_t site, uint8_t site_flags,
+                            uint16_t tag);
+void heap_inst_live_free(void* ptr);
+void heap_inst_live_reset(void);
+
+/* heapInst_memmap.c */
+void heap_inst_memmap_emit(uint64_t timestamp_us);
+
+#ifdef __cplusplus
+}
+#endif
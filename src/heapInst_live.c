@@ -0,0 +1,285 @@
+/**
+ * @file heapInst_live.c
+ * @brief In-process live allocation table with checkpoint/diff.
+ *
+ * Keeps every live allocation (pointer, size, callsite, tag, sequence
+ * number) in a fixed-size open-addressing table so a program can ask
+ * "what did this phase leave behind?" without a trace file or host tool:
+ * heap_inst_checkpoint() captures the current sequence number and
+ * heap_inst_diff() reports the still-live allocations made after it,
+ * grouped by callsite or tag.
+ *
+ * Linear probing with backward-shift deletion keeps lookups short without
+ * tombstones. When the table is full, new allocations are not tracked and
+ * heap_inst_live_overflowed() reports that diffs may be incomplete.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInst_internal.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if HEAPINST_CFG_LIVE_TABLE
+
+#if (HEAPINST_CFG_LIVE_SLOTS & (HEAPINST_CFG_LIVE_SLOTS - 1)) != 0
+#error "HEAPINST_CFG_LIVE_SLOTS must be a power of two"
+#endif
+
+#define SLOT_MASK (HEAPINST_CFG_LIVE_SLOTS - 1u)
+
+typedef struct live_entry {
+    uintptr_t ptr;  /* 0 = empty slot */
+    uintptr_t site;
+    uint32_t size;
+    uint32_t seq;
+    uint16_t tag;
+    uint8_t site_flags;
+} live_entry_t;
+
+static live_entry_t g_table[HEAPINST_CFG_LIVE_SLOTS];
+static size_t g_live_count = 0;
+static uint32_t g_next_seq = 1;
+static bool g_overflowed = false;
+
+static size_t home_slot(uintptr_t ptr)
+{
+    /* Allocations are at least 8-byte aligned; Fibonacci hashing spreads the rest */
+    return (size_t)(((uint32_t)(ptr >> 3) * 2654435769u) >> 16) & SLOT_MASK;
+}
+
+static live_entry_t* find(uintptr_t ptr)
+{
+    for (size_t i = home_slot(ptr), probes = 0; probes < HEAPINST_CFG_LIVE_SLOTS;
+         i = (i + 1) & SLOT_MASK, probes++) {
+        if (g_table[i].ptr == ptr) {
+            return &g_table[i];
+        }
+        if (g_table[i].ptr == 0) {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+static void insert(uintptr_t ptr, uint32_t size, uintptr_t site, uint8_t site_flags, uint16_t tag,
+                   uint32_t seq)
+{
+    if (g_live_count >= HEAPINST_CFG_LIVE_SLOTS - 1) {
+        /* Keep one slot free so probing always terminates */
+        g_overflowed = true;
+        return;
+    }
+
+    size_t i = home_slot(ptr);
+    while (g_table[i].ptr != 0 && g_table[i].ptr != ptr) {
+        i = (i + 1) & SLOT_MASK;
+    }
+    if (g_table[i].ptr == 0) {
+        g_live_count++;
+    }
+    g_table[i] = (live_entry_t){
+        .ptr = ptr, .site = site, .size = size, .seq = seq, .tag = tag, .site_flags = site_flags};
+}
+
+static void erase(live_entry_t* entry)
+{
+    size_t hole = (size_t)(entry - g_table);
+    size_t i = hole;
+
+    /* Backward-shift: pull later entries of the probe run into the hole */
+    for (;;) {
+        i = (i + 1) & SLOT_MASK;
+        if (g_table[i].ptr == 0) {
+            break;
+        }
+        size_t home = home_slot(g_table[i].ptr);
+        /* Move if the hole lies cyclically within [home, i) */
+        if (((i - home) & SLOT_MASK) >= ((i - hole) & SLOT_MASK)) {
+            g_table[hole] = g_table[i];
+            hole = i;
+        }
+    }
+    memset(&g_table[hole], 0, sizeof(g_table[hole]));
+    g_live_count--;
+}
+
+void heap_inst_live_alloc(void* ptr, size_t size, uintptr_t site, uint8_t site_flags, uint16_t tag)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    heapInst_lock();
+    insert((uintptr_t)ptr, (uint32_t)size, site, site_flags, tag, g_next_seq++);
+    heapInst_unlock();
+}
+
+void heap_inst_live_realloc(void* old_ptr, void* new_ptr, size_t size, uintptr_t site, uint8_t site_flags,
+                            uint16_t tag)
+{
+    heapInst_lock();
+
+    uint32_t seq = g_next_seq;
+    live_entry_t* old_entry = (old_ptr != NULL) ? find((uintptr_t)old_ptr) : NULL;
+    if (new_ptr == NULL && size != 0) {
+        /* Failed realloc: the old block is untouched */
+        heapInst_unlock();
+        return;
+    }
+
+    if (old_entry != NULL) {
+        /* A resized block keeps its identity (and checkpoint membership) */
+        seq = old_entry->seq;
+        site = old_entry->site;
+        site_flags = old_entry->site_flags;
+        tag = old_entry->tag;
+        erase(old_entry);
+    } else {
+        g_next_seq++;
+    }
+
+    if (new_ptr != NULL) {
+        insert((uintptr_t)new_ptr, (uint32_t)size, site, site_flags, tag, seq);
+    }
+
+    heapInst_unlock();
+}
+
+void heap_inst_live_free(void* ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    heapInst_lock();
+    live_entry_t* entry = find((uintptr_t)ptr);
+    if (entry != NULL) {
+        erase(entry);
+    }
+    heapInst_unlock();
+}
+
+heap_inst_checkpoint_t heap_inst_checkpoint(void)
+{
+    heapInst_lock();
+    heap_inst_checkpoint_t checkpoint = {.seq = g_next_seq};
+    heapInst_unlock();
+    return checkpoint;
+}
+
+size_t heap_inst_diff(heap_inst_checkpoint_t checkpoint, heap_inst_diff_group_by_t group_by,
+                      heap_inst_diff_fn callback, void* ctx)
+{
+    /* Last slot collects keys that did not fit */
+    heap_inst_diff_entry_t groups[HEAPINST_CFG_DIFF_MAX_GROUPS + 1];
+    size_t group_count = 0;
+    size_t total = 0;
+    heap_inst_diff_entry_t* other = &groups[HEAPINST_CFG_DIFF_MAX_GROUPS];
+    *other = (heap_inst_diff_entry_t){.key = HEAP_INST_DIFF_KEY_OTHER};
+
+    heapInst_lock();
+    for (size_t i = 0; i < HEAPINST_CFG_LIVE_SLOTS; i++) {
+        const live_entry_t* e = &g_table[i];
+        if (e->ptr == 0 || (int32_t)(e->seq - checkpoint.seq) < 0) {
+            continue;
+        }
+        total++;
+
+        bool by_tag = group_by == HEAP_INST_DIFF_BY_TAG;
+        uintptr_t key = by_tag ? (uintptr_t)e->tag : e->site;
+        uint8_t flags = by_tag ? 0 : e->site_flags;
+        heap_inst_diff_entry_t* group = NULL;
+        for (size_t g = 0; g < group_count; g++) {
+            if (groups[g].key == key && groups[g].flags == flags) {
+                group = &groups[g];
+                break;
+            }
+        }
+        if (group == NULL) {
+            if (group_count < HEAPINST_CFG_DIFF_MAX_GROUPS) {
+                group = &groups[group_count++];
+                *group = (heap_inst_diff_entry_t){.key = key, .flags = flags};
+            } else {
+                group = other;
+            }
+        }
+        group->count++;
+        group->bytes += e->size;
+    }
+    heapInst_unlock();
+
+    if (callback != NULL) {
+        for (size_t g = 0; g < group_count; g++) {
+            callback(&groups[g], ctx);
+        }
+        if (other->count > 0) {
+            callback(other, ctx);
+        }
+    }
+    return total;
+}
+
+size_t heap_inst_live_get_count(void) { return g_live_count; }
+
+bool heap_inst_live_overflowed(void) { return g_overflowed; }
+
+void heap_inst_live_reset(void)
+{
+    heapInst_lock();
+    memset(g_table, 0, sizeof(g_table));
+    g_live_count = 0;
+    g_next_seq = 1;
+    g_overflowed = false;
+    heapInst_unlock();
+}
+
+#else /* !HEAPINST_CFG_LIVE_TABLE */
+
+void heap_inst_live_alloc(void* ptr, size_t size, uintptr_t site, uint8_t site_flags, uint16_t tag)
+{
+    (void)ptr;
+    (void)size;
+    (void)site;
+    (void)site_flags;
+    (void)tag;
+}
+
+void heap_inst_live_realloc(void* old_ptr, void* new_ptr, size_t size, uintptr_t site, uint8_t site_flags,
+                            uint16_t tag)
+{
+    (void)old_ptr;
+    (void)new_ptr;
+    (void)size;
+    (void)site;
+    (void)site_flags;
+    (void)tag;
+}
+
+void heap_inst_live_free(void* ptr) { (void)ptr; }
+
+heap_inst_checkpoint_t heap_inst_checkpoint(void)
+{
+    heap_inst_checkpoint_t checkpoint = {.seq = 0};
+    return checkpoint;
+}
+
+size_t heap_inst_diff(heap_inst_checkpoint_t checkpoint, heap_inst_diff_group_by_t group_by,
+                      heap_inst_diff_fn callback, void* ctx)
+{
+    (void)checkpoint;
+    (void)group_by;
+    (void)callback;
+    (void)ctx;
+    /* Not 0: "no leaks" would let leak checks pass with the table compiled out */
+    return HEAP_INST_DIFF_UNAVAILABLE;
+}
+
+size_t heap_inst_live_get_count(void) { return 0; }
+bool heap_inst_live_overflowed(void) { return true; }
+void heap_inst_live_reset(void) {}
+
+#endif /* HEAPINST_CFG_LIVE_TABLE */
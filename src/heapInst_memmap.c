@@ -0,0 +1,188 @@
+/**
+ * @file heapInst_memmap.c
+ * @brief Static memory map records (HEAP_OP_MEMMAP) emitted at init.
+ *
+ * The INIT record only describes the heap. To put heap usage in the context
+ * of the whole RAM budget, the sizes of the static regions are written once
+ * after INIT: from the Pico linker symbols on ARM targets, or from
+ * /proc/self/maps on Linux hosts.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInst_internal.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if HEAPINST_CFG_MEMMAP
+
+#if defined(__arm__) || defined(__ARM_ARCH)
+#define MEMMAP_SOURCE_LINKER 1
+#elif defined(__linux__)
+#define MEMMAP_SOURCE_PROC 1
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#endif
+
+#if defined(MEMMAP_SOURCE_LINKER) || defined(MEMMAP_SOURCE_PROC)
+static void emit_region(uint64_t timestamp_us, heap_inst_memmap_region_t region,
+                        uintptr_t base, uintptr_t end)
+{
+    if (end <= base) {
+        return;
+    }
+
+    heap_inst_record_t record = {
+        .operation = HEAP_OP_MEMMAP,
+        .timestamp_us = timestamp_us,
+        .arg1 = (uint32_t)region,
+        .arg2 = (uint32_t)base,
+        .arg3 = (uint32_t)(end - base),
+        .flags = 0};
+
+    heap_inst_log_record(&record);
+}
+#endif
+
+#if defined(MEMMAP_SOURCE_LINKER)
+
+/* Pico SDK memmap_default.ld */
+extern char __data_start__, __data_end__;
+extern char __bss_start__, __bss_end__;
+extern char __end__, __StackLimit;
+extern char __StackBottom, __StackTop;
+extern char __StackOneBottom, __StackOneTop;
+extern char __scratch_x_start__, __scratch_x_end__;
+extern char __scratch_y_start__, __scratch_y_end__;
+
+#define SYM(s) ((uintptr_t)&(s))
+
+void heap_inst_memmap_emit(uint64_t timestamp_us)
+{
+    emit_region(timestamp_us, HEAP_MEMMAP_DATA, SYM(__data_start__), SYM(__data_end__));
+    emit_region(timestamp_us, HEAP_MEMMAP_BSS, SYM(__bss_start__), SYM(__bss_end__));
+    emit_region(timestamp_us, HEAP_MEMMAP_HEAP, SYM(__end__), SYM(__StackLimit));
+    emit_region(timestamp_us, HEAP_MEMMAP_STACK, SYM(__StackBottom), SYM(__StackTop));
+    emit_region(timestamp_us, HEAP_MEMMAP_STACK1, SYM(__StackOneBottom), SYM(__StackOneTop));
+    emit_region(timestamp_us, HEAP_MEMMAP_SCRATCH_X, SYM(__scratch_x_start__), SYM(__scratch_x_end__));
+    emit_region(timestamp_us, HEAP_MEMMAP_SCRATCH_Y, SYM(__scratch_y_start__), SYM(__scratch_y_end__));
+}
+
+#elif defined(MEMMAP_SOURCE_PROC)
+
+/* Longest /proc/self/maps line we keep; longer pathnames are truncated. */
+#define MAPS_LINE_MAX 512
+
+typedef struct maps_state {
+    uint64_t timestamp_us;
+    char exe_path[MAPS_LINE_MAX];
+    uintptr_t data_end; /* end of the executable's rw mapping, 0 until seen */
+    bool have_data;
+    bool have_bss;
+} maps_state_t;
+
+static uintptr_t parse_hex(const char** cursor)
+{
+    uintptr_t value = 0;
+    const char* p = *cursor;
+    for (;; p++) {
+        char c = *p;
+        if (c >= '0' && c <= '9') {
+            value = (value << 4) | (uintptr_t)(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            value = (value << 4) | (uintptr_t)(c - 'a' + 10);
+        } else {
+            break;
+        }
+    }
+    *cursor = p;
+    return value;
+}
+
+/*
+ * Line format: "start-end perms offset dev inode [pathname]". The
+ * executable's rw-p mapping holds .data (and the start of .bss); the rest
+ * of .bss is the anonymous rw-p mapping directly after it.
+ */
+static void handle_maps_line(maps_state_t* state, const char* line)
+{
+    const char* p = line;
+    uintptr_t start = parse_hex(&p);
+    if (*p++ != '-') {
+        return;
+    }
+    uintptr_t end = parse_hex(&p);
+    if (*p++ != ' ') {
+        return;
+    }
+    bool writable = (p[0] != '\0' && p[1] == 'w');
+
+    /* Skip perms, offset, dev and inode to reach the pathname */
+    for (int field = 0; field < 4 && *p != '\0'; field++) {
+        while (*p != '\0' && *p != ' ') p++;
+        while (*p == ' ') p++;
+    }
+    const char* path = p;
+
+    if (strcmp(path, "[heap]") == 0) {
+        emit_region(state->timestamp_us, HEAP_MEMMAP_HEAP, start, end);
+    } else if (strcmp(path, "[stack]") == 0) {
+        emit_region(state->timestamp_us, HEAP_MEMMAP_STACK, start, end);
+    } else if (writable && !state->have_data && state->exe_path[0] != '\0' &&
+               strcmp(path, state->exe_path) == 0) {
+        emit_region(state->timestamp_us, HEAP_MEMMAP_DATA, start, end);
+        state->have_data = true;
+        state->data_end = end;
+    } else if (writable && state->have_data && !state->have_bss &&
+               path[0] == '\0' && start == state->data_end) {
+        emit_region(state->timestamp_us, HEAP_MEMMAP_BSS, start, end);
+        state->have_bss = true;
+    }
+}
+
+/* Read with open/read rather than stdio: fopen would allocate mid-init. */
+void heap_inst_memmap_emit(uint64_t timestamp_us)
+{
+    maps_state_t state = {.timestamp_us = timestamp_us};
+
+    ssize_t len = readlink("/proc/self/exe", state.exe_path, sizeof(state.exe_path) - 1);
+    state.exe_path[len > 0 ? len : 0] = '\0';
+
+    int fd = open("/proc/self/maps", O_RDONLY);
+    if (fd < 0) {
+        heap_inst_logf("[MEMMAP] /proc/self/maps unavailable\n");
+        return;
+    }
+
+    char chunk[1024];
+    char line[MAPS_LINE_MAX];
+    size_t line_len = 0;
+    ssize_t n;
+    while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            if (chunk[i] == '\n') {
+                line[line_len] = '\0';
+                handle_maps_line(&state, line);
+                line_len = 0;
+            } else if (line_len < sizeof(line) - 1) {
+                line[line_len++] = chunk[i];
+            }
+        }
+    }
+    close(fd);
+}
+
+#else
+
+void heap_inst_memmap_emit(uint64_t timestamp_us) { (void)timestamp_us; }
+
+#endif
+
+#else /* !HEAPINST_CFG_MEMMAP */
+
+void heap_inst_memmap_emit(uint64_t timestamp_us) { (void)timestamp_us; }
+
+#endif /* HEAPINST_CFG_MEMMAP */
@@ -0,0 +1,219 @@
+/**
+ * @file heapInst_rss.c
+ * @brief Resident-memory sampling (HEAP_OP_RSS) for Linux hosts.
+ *
+ * Requested live bytes and the process footprint drift apart through
+ * fragmentation and memory glibc keeps cached, so the trace alone cannot
+ * explain RSS growth. This module samples /proc/self/smaps_rollup (falling
+ * back to /proc/self/statm) and the mapping count from /proc/self/maps, on
+ * demand or from a background thread, and records them in the trace.
+ *
+ * The sampler thread records concurrently with the application, so register
+ * lock/unlock hooks (a recursive mutex, since a flush may allocate) when
+ * using heap_inst_rss_sampler_start().
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInst_internal.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#if HEAPINST_CFG_RSS_SAMPLER && defined(__linux__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static pthread_t g_sampler_thread;
+static pthread_mutex_t g_sampler_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_sampler_cond = PTHREAD_COND_INITIALIZER;
+static bool g_sampler_running = false;
+static bool g_sampler_stop = false;
+static uint32_t g_sampler_interval_ms = 0;
+
+/* Read a small /proc file into buf (NUL-terminated). Returns bytes read or -1. */
+static ssize_t read_proc_file(const char* path, char* buf, size_t size)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    size_t total = 0;
+    ssize_t n;
+    while (total < size - 1 && (n = read(fd, buf + total, size - 1 - total)) > 0) {
+        total += (size_t)n;
+    }
+    close(fd);
+    buf[total] = '\0';
+    return (ssize_t)total;
+}
+
+/* Value of a "Key:   <n> kB" line in smaps_rollup, or -1 if absent. */
+static long rollup_field_kb(const char* text, const char* key)
+{
+    size_t key_len = strlen(key);
+    for (const char* line = text; line != NULL && *line != '\0';) {
+        if (strncmp(line, key, key_len) == 0 && line[key_len] == ':') {
+            return strtol(line + key_len + 1, NULL, 10);
+        }
+        line = strchr(line, '\n');
+        if (line != NULL) {
+            line++;
+        }
+    }
+    return -1;
+}
+
+static uint32_t count_mappings(void)
+{
+    int fd = open("/proc/self/maps", O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+
+    char chunk[4096];
+    uint32_t lines = 0;
+    ssize_t n;
+    while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            lines += (chunk[i] == '\n');
+        }
+    }
+    close(fd);
+    return lines;
+}
+
+int heap_inst_rss_sample(void)
+{
+    if (!heap_inst_is_initialized()) {
+        return -1;
+    }
+
+    long rss_kb = -1;
+    long anon_kb = -1;
+    char buf[2048];
+
+    if (read_proc_file("/proc/self/smaps_rollup", buf, sizeof(buf)) > 0) {
+        rss_kb = rollup_field_kb(buf, "Rss");
+        anon_kb = rollup_field_kb(buf, "Anonymous");
+    }
+
+    if (rss_kb < 0 || anon_kb < 0) {
+        /* statm: size resident shared text lib data dt (pages) */
+        unsigned long size, resident, shared;
+        if (read_proc_file("/proc/self/statm", buf, sizeof(buf)) <= 0) {
+            return -1;
+        }
+        char* cursor = buf;
+        size = strtoul(cursor, &cursor, 10);
+        resident = strtoul(cursor, &cursor, 10);
+        shared = strtoul(cursor, &cursor, 10);
+        (void)size;
+
+        long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+        rss_kb = (long)resident * page_kb;
+        anon_kb = (long)(resident - shared) * page_kb;
+    }
+
+    heap_inst_record_t record = {
+        .operation = HEAP_OP_RSS,
+        .timestamp_us = heap_inst_timestamp_us(),
+        .arg1 = (uint32_t)rss_kb,
+        .arg2 = (uint32_t)anon_kb,
+        .arg3 = count_mappings(),
+        .flags = 0};
+
+    heap_inst_log_record(&record);
+    return 0;
+}
+
+static void* sampler_main(void* arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&g_sampler_mutex);
+    while (!g_sampler_stop) {
+        pthread_mutex_unlock(&g_sampler_mutex);
+        heap_inst_rss_sample();
+        pthread_mutex_lock(&g_sampler_mutex);
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += g_sampler_interval_ms / 1000u;
+        deadline.tv_nsec += (long)(g_sampler_interval_ms % 1000u) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        while (!g_sampler_stop &&
+               pthread_cond_timedwait(&g_sampler_cond, &g_sampler_mutex, &deadline) != ETIMEDOUT) {
+        }
+    }
+    pthread_mutex_unlock(&g_sampler_mutex);
+    return NULL;
+}
+
+int heap_inst_rss_sampler_start(uint32_t interval_ms)
+{
+    if (interval_ms == 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_sampler_mutex);
+    if (g_sampler_running) {
+        pthread_mutex_unlock(&g_sampler_mutex);
+        return -1;
+    }
+    g_sampler_interval_ms = interval_ms;
+    g_sampler_stop = false;
+    int rc = pthread_create(&g_sampler_thread, NULL, sampler_main, NULL);
+    g_sampler_running = (rc == 0);
+    pthread_mutex_unlock(&g_sampler_mutex);
+
+    if (rc != 0) {
+        heap_inst_logf("[RSS] Failed to start sampler thread (%d)\n", rc);
+        return -1;
+    }
+    heap_inst_logf("[RSS] Sampling every %u ms\n", (unsigned)interval_ms);
+    return 0;
+}
+
+void heap_inst_rss_sampler_stop(void)
+{
+    pthread_mutex_lock(&g_sampler_mutex);
+    if (!g_sampler_running) {
+        pthread_mutex_unlock(&g_sampler_mutex);
+        return;
+    }
+    g_sampler_stop = true;
+    pthread_cond_signal(&g_sampler_cond);
+    pthread_mutex_unlock(&g_sampler_mutex);
+
+    pthread_join(g_sampler_thread, NULL);
+
+    pthread_mutex_lock(&g_sampler_mutex);
+    g_sampler_running = false;
+    pthread_mutex_unlock(&g_sampler_mutex);
+}
+
+#else /* !(HEAPINST_CFG_RSS_SAMPLER && __linux__) */
+
+int heap_inst_rss_sample(void) { return -1; }
+
+int heap_inst_rss_sampler_start(uint32_t interval_ms)
+{
+    (void)interval_ms;
+    return -1;
+}
+
+void heap_inst_rss_sampler_stop(void) {}
+
+#endif /* HEAPINST_CFG_RSS_SAMPLER && __linux__ */
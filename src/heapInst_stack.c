@@ -0,0 +1,218 @@
+/**
+ * @file heapInst_stack.c
+ * @brief Stack painting and high-water-mark sampling (HEAP_OP_STACK_HWM).
+ *
+ * On RP2350 the heap grows up from __end__ toward __StackLimit while each
+ * core's stack grows down from its top, so the heap trace alone cannot say
+ * how close the two are. Registered stacks are painted with a known pattern;
+ * sampling scans up from the bottom for the first overwritten word and emits
+ * the deepest usage seen so far, timestamped like every other record.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInst_internal.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if HEAPINST_CFG_STACK_HWM
+
+/* Bytes below the current stack pointer left unpainted for the painter's own frame */
+#define STACK_PAINT_GUARD_BYTES 128
+
+typedef struct stack_region {
+    uint32_t* bottom;    /* lowest word of the stack */
+    size_t words;        /* total size in words */
+    size_t clean_words;  /* untouched words at the bottom as of the last sample */
+    bool registered;
+} stack_region_t;
+
+static stack_region_t g_stacks[HEAPINST_CFG_STACK_MAX];
+static uint32_t g_records_since_sample = 0;
+static bool g_sampling = false;
+
+/*
+ * Pico linker symbols (memmap_default.ld): core 0 runs on the SCRATCH_Y
+ * stack, core 1 (once launched via multicore_launch_core1) on SCRATCH_X,
+ * unless the application gives it a stack of its own.
+ */
+#if defined(__arm__) || defined(__ARM_ARCH)
+extern char __StackBottom;
+extern char __StackTop;
+extern char __StackOneBottom;
+extern char __StackOneTop;
+#define STACK_AUTO_DETECT_AVAILABLE 1
+#else
+#define STACK_AUTO_DETECT_AVAILABLE 0
+#endif
+
+static void paint_region(stack_region_t* region)
+{
+    uintptr_t start = (uintptr_t)region->bottom;
+    uintptr_t end = start + region->words * sizeof(uint32_t);
+    uintptr_t sp = (uintptr_t)__builtin_frame_address(0);
+
+    /* Live stack: only paint what lies safely below us */
+    if (sp > start && sp <= end) {
+        end = (sp > start + STACK_PAINT_GUARD_BYTES) ? sp - STACK_PAINT_GUARD_BYTES : start;
+        end &= ~(uintptr_t)(sizeof(uint32_t) - 1);
+    }
+
+    size_t paint_words = (end - start) / sizeof(uint32_t);
+    for (size_t i = 0; i < paint_words; i++) {
+        region->bottom[i] = HEAPINST_CFG_STACK_PAINT_PATTERN;
+    }
+    region->clean_words = paint_words;
+}
+
+/*
+ * The watermark only ever moves down, so words above the previous clean
+ * boundary are known to be dirty and need not be rescanned.
+ */
+static size_t scan_clean_words(stack_region_t* region)
+{
+    size_t clean = 0;
+    while (clean < region->clean_words &&
+           region->bottom[clean] == HEAPINST_CFG_STACK_PAINT_PATTERN) {
+        clean++;
+    }
+    region->clean_words = clean;
+    return clean;
+}
+
+int heap_inst_stack_register(uint8_t stack_id, const heap_inst_stack_info_t* info)
+{
+    if (stack_id >= HEAPINST_CFG_STACK_MAX || info == NULL ||
+        info->stack_bottom == NULL || info->stack_size < sizeof(uint32_t)) {
+        return -1;
+    }
+
+    /* Round inward to whole words */
+    uintptr_t start = ((uintptr_t)info->stack_bottom + 3u) & ~(uintptr_t)3u;
+    uintptr_t end = ((uintptr_t)info->stack_bottom + info->stack_size) & ~(uintptr_t)3u;
+    if (end <= start) {
+        return -1;
+    }
+
+    stack_region_t* region = &g_stacks[stack_id];
+    region->bottom = (uint32_t*)start;
+    region->words = (end - start) / sizeof(uint32_t);
+    paint_region(region);
+    region->registered = true;
+
+    heap_inst_logf("[STACK] Registered stack %u: 0x%08" PRIxPTR " - 0x%08" PRIxPTR
+                   " (%zu bytes painted)\n",
+                   (unsigned)stack_id, start, end,
+                   region->clean_words * sizeof(uint32_t));
+    return 0;
+}
+
+void heap_inst_stack_sample(void)
+{
+    if (!heap_inst_is_initialized() || g_sampling) {
+        return;
+    }
+
+    /* Our own records re-enter heap_inst_stack_tick() */
+    g_sampling = true;
+    g_records_since_sample = 0;
+
+    /* One timestamp for all stacks, read only if there is something to sample */
+    uint64_t now = 0;
+    bool have_now = false;
+    for (uint8_t id = 0; id < HEAPINST_CFG_STACK_MAX; id++) {
+        stack_region_t* region = &g_stacks[id];
+        if (!region->registered) {
+            continue;
+        }
+        if (!have_now) {
+            now = heap_inst_timestamp_us();
+            have_now = true;
+        }
+
+        size_t size = region->words * sizeof(uint32_t);
+        size_t hwm = size - scan_clean_words(region) * sizeof(uint32_t);
+
+        heap_inst_record_t record = {
+            .operation = HEAP_OP_STACK_HWM,
+            .timestamp_us = now,
+            .arg1 = id,
+            .arg2 = (uint32_t)hwm,
+            .arg3 = (uint32_t)size,
+            .flags = 0};
+
+        heap_inst_log_record(&record);
+    }
+
+    g_sampling = false;
+}
+
+void heap_inst_stack_init(void)
+{
+#if STACK_AUTO_DETECT_AVAILABLE
+    /*
+     * Only the stack we are running on is safe to paint: the other core may
+     * already be live on its own, and painting would corrupt it. Its stack
+     * is left to an explicit heap_inst_stack_register() before launch.
+     */
+    uintptr_t sp = (uintptr_t)__builtin_frame_address(0);
+    heap_inst_stack_info_t core0 = {
+        .stack_bottom = &__StackBottom,
+        .stack_size = (size_t)(&__StackTop - &__StackBottom),
+    };
+    heap_inst_stack_info_t core1 = {
+        .stack_bottom = &__StackOneBottom,
+        .stack_size = (size_t)(&__StackOneTop - &__StackOneBottom),
+    };
+
+    if (sp > (uintptr_t)&__StackBottom && sp <= (uintptr_t)&__StackTop) {
+        if (!g_stacks[0].registered) {
+            heap_inst_stack_register(0, &core0);
+        }
+    } else if (sp > (uintptr_t)&__StackOneBottom && sp <= (uintptr_t)&__StackOneTop) {
+        if (HEAPINST_CFG_STACK_MAX > 1 && !g_stacks[1].registered) {
+            heap_inst_stack_register(1, &core1);
+        }
+    }
+#endif
+    heap_inst_stack_sample();
+}
+
+void heap_inst_stack_tick(void)
+{
+#if HEAPINST_CFG_STACK_SAMPLE_INTERVAL > 0
+    if (g_sampling) {
+        return;
+    }
+    if (++g_records_since_sample >= HEAPINST_CFG_STACK_SAMPLE_INTERVAL) {
+        heap_inst_stack_sample();
+    }
+#endif
+}
+
+void heap_inst_stack_reset(void)
+{
+    memset(g_stacks, 0, sizeof(g_stacks));
+    g_records_since_sample = 0;
+    g_sampling = false;
+}
+
+#else /* !HEAPINST_CFG_STACK_HWM */
+
+int heap_inst_stack_register(uint8_t stack_id, const heap_inst_stack_info_t* info)
+{
+    (void)stack_id;
+    (void)info;
+    return -1;
+}
+
+void heap_inst_stack_sample(void) {}
+void heap_inst_stack_init(void) {}
+void heap_inst_stack_tick(void) {}
+void heap_inst_stack_reset(void) {}
+
+#endif /* HEAPINST_CFG_STACK_HWM */
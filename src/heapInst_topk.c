@@ -0,0 +1,161 @@
+/**
+ * @file heapInst_topk.c
+ * @brief Bounded-memory heavy-hitter callsites (HEAP_OP_TOPK).
+ *
+ * Answers "who is hammering malloc" on units that never stream a full
+ * trace. A Space-Saving sketch keeps HEAPINST_CFG_TOPK_SLOTS callsites:
+ * a known callsite is incremented in place, an unknown one takes over the
+ * slot with the smallest count and inherits that count as its error bound.
+ * Any callsite responsible for more than 1/slots of all allocations is
+ * guaranteed to hold a slot.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInst_internal.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if HEAPINST_CFG_TOPK
+
+static heap_inst_topk_entry_t g_slots[HEAPINST_CFG_TOPK_SLOTS];
+static size_t g_used = 0;
+static uint32_t g_allocs_since_dump = 0;
+
+void heap_inst_topk_update(uintptr_t site, uint8_t site_flags, size_t size)
+{
+    bool dump = false;
+
+    heapInst_lock();
+
+    heap_inst_topk_entry_t* min_slot = NULL;
+    heap_inst_topk_entry_t* slot = NULL;
+    for (size_t i = 0; i < g_used; i++) {
+        if (g_slots[i].site == site && g_slots[i].flags == site_flags) {
+            slot = &g_slots[i];
+            break;
+        }
+        if (min_slot == NULL || g_slots[i].count < min_slot->count) {
+            min_slot = &g_slots[i];
+        }
+    }
+
+    if (slot != NULL) {
+        slot->count++;
+        slot->bytes += size;
+    } else if (g_used < HEAPINST_CFG_TOPK_SLOTS) {
+        slot = &g_slots[g_used++];
+        slot->site = site;
+        slot->flags = site_flags;
+        slot->count = 1;
+        slot->error = 0;
+        slot->bytes = size;
+    } else {
+        /* Evict the lightest callsite; its count becomes our error bound */
+        min_slot->site = site;
+        min_slot->flags = site_flags;
+        min_slot->error = min_slot->count;
+        min_slot->count++;
+        min_slot->bytes += size;
+    }
+
+#if HEAPINST_CFG_TOPK_DUMP_INTERVAL > 0
+    if (++g_allocs_since_dump >= HEAPINST_CFG_TOPK_DUMP_INTERVAL) {
+        g_allocs_since_dump = 0;
+        dump = true;
+    }
+#endif
+
+    heapInst_unlock();
+
+    if (dump) {
+        heap_inst_topk_dump();
+    }
+}
+
+size_t heap_inst_topk_get(heap_inst_topk_entry_t* out, size_t max_entries)
+{
+    if (out == NULL) {
+        return 0;
+    }
+
+    heapInst_lock();
+    heap_inst_topk_entry_t snapshot[HEAPINST_CFG_TOPK_SLOTS];
+    size_t used = g_used;
+    memcpy(snapshot, g_slots, used * sizeof(snapshot[0]));
+    heapInst_unlock();
+
+    /* Insertion sort by count, heaviest first; at most a few dozen slots */
+    for (size_t i = 1; i < used; i++) {
+        heap_inst_topk_entry_t entry = snapshot[i];
+        size_t j = i;
+        while (j > 0 && snapshot[j - 1].count < entry.count) {
+            snapshot[j] = snapshot[j - 1];
+            j--;
+        }
+        snapshot[j] = entry;
+    }
+
+    size_t n = (used < max_entries) ? used : max_entries;
+    memcpy(out, snapshot, n * sizeof(out[0]));
+    return n;
+}
+
+void heap_inst_topk_dump(void)
+{
+    if (!heap_inst_is_initialized()) {
+        return;
+    }
+
+    heap_inst_topk_entry_t entries[HEAPINST_CFG_TOPK_SLOTS];
+    size_t n = heap_inst_topk_get(entries, HEAPINST_CFG_TOPK_SLOTS);
+    uint64_t now = heap_inst_timestamp_us();
+
+    for (size_t rank = 0; rank < n; rank++) {
+        const heap_inst_topk_entry_t* e = &entries[rank];
+        heap_inst_record_t record = {
+            .operation = HEAP_OP_TOPK,
+            .site = (uint32_t)e->site,
+            .timestamp_us = now,
+            .arg1 = e->count,
+            .arg2 = (e->bytes > UINT32_MAX) ? UINT32_MAX : (uint32_t)e->bytes,
+            .arg3 = e->error,
+            .arg4 = (uint32_t)rank,
+            .flags = e->flags};
+
+        heap_inst_log_record(&record);
+    }
+}
+
+void heap_inst_topk_reset(void)
+{
+    heapInst_lock();
+    memset(g_slots, 0, sizeof(g_slots));
+    g_used = 0;
+    g_allocs_since_dump = 0;
+    heapInst_unlock();
+}
+
+#else /* !HEAPINST_CFG_TOPK */
+
+void heap_inst_topk_update(uintptr_t site, uint8_t site_flags, size_t size)
+{
+    (void)site;
+    (void)site_flags;
+    (void)size;
+}
+
+size_t heap_inst_topk_get(heap_inst_topk_entry_t* out, size_t max_entries)
+{
+    (void)out;
+    (void)max_entries;
+    return 0;
+}
+
+void heap_inst_topk_dump(void) {}
+void heap_inst_topk_reset(void) {}
+
+#endif /* HEAPINST_CFG_TOPK */
@@ -25,10 +25,22 @@
  */
 
 #include "heapInst/heapInst.h"
+#include "heapInstConfig.h"
 
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 
+/* Return address into the code that called malloc/free/... */
+#define CALLSITE() __builtin_return_address(0)
+
+#if HEAPINST_CFG_RECORD_USABLE_SIZE
+#include <malloc.h> /* malloc_usable_size (glibc and newlib) */
+#define USABLE_SIZE(p) ((p) != NULL ? malloc_usable_size(p) : 0)
+#else
+#define USABLE_SIZE(p) ((size_t)0)
+#endif
+
 /*
  * The linker's --wrap=malloc option:
  * - Redirects all calls to malloc() -> __wrap_malloc()
@@ -43,6 +55,66 @@ extern void *__real_calloc(size_t nmemb, size_t size);
 extern void *__real_realloc(void *ptr, size_t size);
 extern void __real_free(void *ptr);
 
+#if HEAPINST_CFG_WRAP_SBRK
+#if HEAPINST_CFG_SBRK_UNDERSCORE
+/* newlib: --wrap=_sbrk, the hook malloc uses to grow its arena */
+extern void *__real__sbrk(ptrdiff_t incr);
+#define HEAPINST_REAL_SBRK(incr) __real__sbrk(incr)
+#define HEAPINST_POLL_BREAK      0
+#else
+/* Hosts: --wrap=sbrk. malloc itself bypasses sbrk (glibc's internal __sbrk,
+ * musl's brk), so the break is polled as well, see below. */
+extern void *__real_sbrk(intptr_t increment);
+#define HEAPINST_REAL_SBRK(incr) __real_sbrk(incr)
+#define HEAPINST_POLL_BREAK      1
+#endif
+#else
+#define HEAPINST_POLL_BREAK 0
+#endif
+
+#if HEAPINST_POLL_BREAK
+#include <stdatomic.h>
+
+/*
+ * Last program break seen by poll_break(); 0 until the first poll. Wrapped
+ * calls poll from any thread, so it is only updated by atomic exchange.
+ */
+static _Atomic uintptr_t g_last_break = 0;
+
+/**
+ * @brief Record break movement that bypassed __wrap_sbrk.
+ *
+ * sbrk(0) only reads the current break (cached by glibc), so this is cheap
+ * enough to run after every wrapped call. The thread that swaps in a new
+ * break records exactly the move from the value it swapped out, so racing
+ * polls never record the same move twice and the deltas always add up.
+ */
+static void poll_break(void)
+{
+    uintptr_t current = (uintptr_t)HEAPINST_REAL_SBRK(0);
+    if (current == (uintptr_t)-1 ||
+        current == atomic_load_explicit(&g_last_break, memory_order_relaxed)) {
+        return;
+    }
+
+    uintptr_t previous = atomic_exchange(&g_last_break, current);
+    if (previous != 0 && previous != current) {
+        heap_inst_record_sbrk((intptr_t)(current - previous), (void *)previous,
+                              HEAP_SBRK_FLAG_OBSERVED);
+    }
+}
+
+#define POLL_BREAK_BASELINE()                                                \
+    do {                                                                     \
+        if (atomic_load_explicit(&g_last_break, memory_order_relaxed) == 0) \
+            poll_break();                                                    \
+    } while (0)
+#define POLL_BREAK() poll_break()
+#else
+#define POLL_BREAK_BASELINE() ((void)0)
+#define POLL_BREAK()          ((void)0)
+#endif
+
 /**
  * @brief Wrapped malloc - intercepts all malloc calls.
  *
@@ -53,8 +125,10 @@ extern void __real_free(void *ptr);
  */
 void *__wrap_malloc(size_t size)
 {
+    POLL_BREAK_BASELINE();
     void *result = __real_malloc(size);
-    heap_inst_record_malloc(size, result);
+    POLL_BREAK();
+    heap_inst_record_malloc(size, result, USABLE_SIZE(result), CALLSITE());
     return result;
 }
 
@@ -70,9 +144,11 @@ void *__wrap_malloc(size_t size)
  */
 void *__wrap_calloc(size_t nmemb, size_t size)
 {
+    POLL_BREAK_BASELINE();
     void *result = __real_calloc(nmemb, size);
+    POLL_BREAK();
     /* Record as malloc with total size for simplicity */
-    heap_inst_record_malloc(nmemb * size, result);
+    heap_inst_record_malloc(nmemb * size, result, USABLE_SIZE(result), CALLSITE());
     return result;
 }
 
@@ -87,8 +163,10 @@ void *__wrap_calloc(size_t nmemb, size_t size)
  */
 void *__wrap_realloc(void *ptr, size_t size)
 {
+    POLL_BREAK_BASELINE();
     void *result = __real_realloc(ptr, size);
-    heap_inst_record_realloc(ptr, size, result);
+    POLL_BREAK();
+    heap_inst_record_realloc(ptr, size, result, USABLE_SIZE(result), CALLSITE());
     return result;
 }
 
@@ -101,6 +179,74 @@ void *__wrap_realloc(void *ptr, size_t size)
  */
 void __wrap_free(void *ptr)
 {
-    heap_inst_record_free(ptr);
+    heap_inst_record_free(ptr, CALLSITE());
     __real_free(ptr);
+    POLL_BREAK();
+}
+
+/*
+ * Entry points of the HEAPINST_MALLOC()/... macros (heapInstSite.h): same as
+ * the wrappers above, but the record carries the caller's source-location id.
+ */
+void *heap_inst_malloc_site(size_t size, uint32_t site_id)
+{
+    POLL_BREAK_BASELINE();
+    void *result = __real_malloc(size);
+    POLL_BREAK();
+    heap_inst_record_malloc_site(size, result, USABLE_SIZE(result), site_id);
+    return result;
+}
+
+void *heap_inst_calloc_site(size_t nmemb, size_t size, uint32_t site_id)
+{
+    POLL_BREAK_BASELINE();
+    void *result = __real_calloc(nmemb, size);
+    POLL_BREAK();
+    heap_inst_record_malloc_site(nmemb * size, result, USABLE_SIZE(result),
+                                 site_id);
+    return result;
+}
+
+void *heap_inst_realloc_site(void *ptr, size_t size, uint32_t site_id)
+{
+    POLL_BREAK_BASELINE();
+    void *result = __real_realloc(ptr, size);
+    POLL_BREAK();
+    heap_inst_record_realloc_site(ptr, size, result, USABLE_SIZE(result),
+                                  site_id);
+    return result;
+}
+
+void heap_inst_free_site(void *ptr, uint32_t site_id)
+{
+    heap_inst_record_free_site(ptr, site_id);
+    __real_free(ptr);
+    POLL_BREAK();
+}
+
+#if HEAPINST_CFG_WRAP_SBRK
+/**
+ * @brief Wrapped sbrk - intercepts program break changes.
+ *
+ * On newlib this is the _sbrk hook malloc uses to grow its arena toward
+ * __StackLimit; on hosts it catches direct sbrk callers.
+ *
+ * @param incr Number of bytes to move the break by (may be negative).
+ * @return Previous break, or (void*)-1 on failure.
+ */
+#if HEAPINST_CFG_SBRK_UNDERSCORE
+void *__wrap__sbrk(ptrdiff_t incr)
+#else
+void *__wrap_sbrk(intptr_t incr)
+#endif
+{
+    void *prev_break = HEAPINST_REAL_SBRK(incr);
+    heap_inst_record_sbrk((intptr_t)incr, prev_break, 0);
+#if HEAPINST_POLL_BREAK
+    if (prev_break != (void *)-1) {
+        g_last_break = (uintptr_t)prev_break + (uintptr_t)incr;
+    }
+#endif
+    return prev_break;
 }
+#endif /* HEAPINST_CFG_WRAP_SBRK */
@@ -18,6 +18,27 @@ extern "C" {
  */
 #define HEAPINST_CFG_STREAM_UDP_PORT 8888
 
+/**
+ * @def HEAPINST_CFG_STREAM_UDP_DEVICE_ID
+ *
+ * @brief Device id carried in every frame, so one receiver can tell
+ * several devices apart. Overridden by the HEAPINST_DEVICE_ID environment
+ * variable on hosts.
+ */
+#ifndef HEAPINST_CFG_STREAM_UDP_DEVICE_ID
+#define HEAPINST_CFG_STREAM_UDP_DEVICE_ID 0
+#endif
+
+/**
+ * @def HEAPINST_CFG_STREAM_UDP_FRAME_RECORDS
+ *
+ * @brief Records per datagram. 44 records (16 + 1408 bytes) fit a
+ * 1500-byte Ethernet MTU without IP fragmentation.
+ */
+#ifndef HEAPINST_CFG_STREAM_UDP_FRAME_RECORDS
+#define HEAPINST_CFG_STREAM_UDP_FRAME_RECORDS 44
+#endif
+
 #ifdef __cplusplus
 }
 #endif
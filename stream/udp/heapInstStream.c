@@ -0,0 +1,178 @@
+/**
+ * @file heapInstStream.c
+ * @brief UDP stream port implementation for heap instrumentation.
+ *
+ * Records are sent in frames (see heapInst/heapInstFrame.h) of up to
+ * HEAPINST_CFG_STREAM_UDP_FRAME_RECORDS records, one frame per datagram,
+ * each carrying the device id, a per-device sequence number and a CRC so
+ * the receiver (heapinst_analyze receive) can report loss. UDP never
+ * blocks the instrumented program: a datagram the network cannot take is
+ * dropped and shows up as a sequence gap on the host.
+ *
+ * This implementation uses POSIX sockets, for host builds. The destination
+ * is HEAPINST_CFG_STREAM_UDP_ADDRESS:PORT unless the HEAPINST_UDP_TARGET
+ * environment variable gives "address:port".
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstStream.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "heapInst/heapInst.h"
+#include "heapInst/heapInstFrame.h"
+#include "heapInstStreamConfig.h"
+
+_Static_assert(sizeof(heap_inst_frame_header_t) == 16, "heap_inst_frame_header_t must be 16 bytes");
+_Static_assert(HEAPINST_CFG_STREAM_UDP_FRAME_RECORDS > 0 &&
+                   HEAPINST_CFG_STREAM_UDP_FRAME_RECORDS <= HEAP_INST_FRAME_MAX_RECORDS,
+               "HEAPINST_CFG_STREAM_UDP_FRAME_RECORDS out of range");
+
+#define FRAME_PAYLOAD_MAX (HEAPINST_CFG_STREAM_UDP_FRAME_RECORDS * sizeof(heap_inst_record_t))
+
+/* Environment variables overriding the configured destination and device id */
+#ifndef HEAPINST_UDP_TARGET_ENV
+#define HEAPINST_UDP_TARGET_ENV "HEAPINST_UDP_TARGET"
+#endif
+#ifndef HEAPINST_DEVICE_ID_ENV
+#define HEAPINST_DEVICE_ID_ENV "HEAPINST_DEVICE_ID"
+#endif
+
+static int g_socket = -1;
+static uint16_t g_device_id = HEAPINST_CFG_STREAM_UDP_DEVICE_ID;
+static uint32_t g_sequence = 0;
+
+/* Frame under construction: header followed by whole records */
+static struct {
+    heap_inst_frame_header_t header;
+    uint8_t payload[FRAME_PAYLOAD_MAX];
+} g_frame;
+static size_t g_payload_len = 0;
+
+static int parse_target(struct sockaddr_in* addr)
+{
+    char host[64];
+    unsigned port = HEAPINST_CFG_STREAM_UDP_PORT;
+    const char* env = getenv(HEAPINST_UDP_TARGET_ENV);
+
+    snprintf(host, sizeof(host), "%s", HEAPINST_CFG_STREAM_UDP_ADDRESS);
+    if (env != NULL && env[0] != '\0') {
+        const char* colon = strrchr(env, ':');
+        size_t host_len = (colon != NULL) ? (size_t)(colon - env) : strlen(env);
+        if (host_len >= sizeof(host)) {
+            return -1;
+        }
+        memcpy(host, env, host_len);
+        host[host_len] = '\0';
+        if (colon != NULL) {
+            port = (unsigned)strtoul(colon + 1, NULL, 10);
+        }
+    }
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons((uint16_t)port);
+    return (port != 0 && port <= 65535 && inet_pton(AF_INET, host, &addr->sin_addr) == 1) ? 0 : -1;
+}
+
+/* Send the pending records as one frame */
+static int send_frame(void)
+{
+    if (g_payload_len == 0) {
+        return 0;
+    }
+
+    g_frame.header.magic = HEAP_INST_FRAME_MAGIC;
+    g_frame.header.device_id = g_device_id;
+    g_frame.header.record_count = (uint16_t)(g_payload_len / sizeof(heap_inst_record_t));
+    g_frame.header.sequence = g_sequence++;
+    uint32_t crc = heap_inst_crc32(0, &g_frame.header, HEAP_INST_FRAME_CRC_OFFSET);
+    g_frame.header.crc32 = heap_inst_crc32(crc, g_frame.payload, g_payload_len);
+
+    size_t len = sizeof(g_frame.header) + g_payload_len;
+    g_payload_len = 0;
+    /* A dropped datagram is reported by the receiver as a sequence gap */
+    return (send(g_socket, &g_frame, len, 0) == (ssize_t)len) ? 0 : -1;
+}
+
+int heapInstStreamPort_Init(void)
+{
+    if (g_socket >= 0) {
+        /* Already initialized */
+        return 0;
+    }
+
+    struct sockaddr_in addr;
+    if (parse_target(&addr) != 0) {
+        return -1;
+    }
+    const char* device = getenv(HEAPINST_DEVICE_ID_ENV);
+    if (device != NULL && device[0] != '\0') {
+        g_device_id = (uint16_t)strtoul(device, NULL, 0);
+    }
+
+    g_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (g_socket < 0) {
+        return -1;
+    }
+    if (connect(g_socket, (const struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(g_socket);
+        g_socket = -1;
+        return -1;
+    }
+    g_sequence = 0;
+    g_payload_len = 0;
+    return 0;
+}
+
+int heapInstStreamPort_Write(const void* data, size_t len)
+{
+    if (g_socket < 0) {
+        return -1;
+    }
+
+    /* The core writes whole records; a partial tail would be dropped */
+    const uint8_t* bytes = (const uint8_t*)data;
+    size_t whole = len - (len % sizeof(heap_inst_record_t));
+    for (size_t done = 0; done < whole;) {
+        size_t chunk = FRAME_PAYLOAD_MAX - g_payload_len;
+        if (chunk > whole - done) {
+            chunk = whole - done;
+        }
+        memcpy(g_frame.payload + g_payload_len, bytes + done, chunk);
+        g_payload_len += chunk;
+        done += chunk;
+        if (g_payload_len == FRAME_PAYLOAD_MAX) {
+            send_frame();
+        }
+    }
+
+    return (int)len;
+}
+
+int heapInstStreamPort_Flush(void)
+{
+    if (g_socket < 0) {
+        return -1;
+    }
+
+    return send_frame();
+}
+
+int heapInstStreamPort_Close(void)
+{
+    if (g_socket >= 0) {
+        send_frame();
+        close(g_socket);
+        g_socket = -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,1294 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "heapInstAnalyzer/address_index.hpp"
+#include "heapInstAnalyzer/arena.hpp"
+#include "heapInstAnalyzer/banks.hpp"
+#include "heapInstAnalyzer/external_sort.hpp"
+#include "heapInstAnalyzer/fleet.hpp"
+#include "heapInstAnalyzer/folded.hpp"
+#include "heapInstAnalyzer/fragmentation.hpp"
+#include "heapInstAnalyzer/heaptrack.hpp"
+#include "heapInstAnalyzer/live.hpp"
+#include "heapInstAnalyzer/massif.hpp"
+#include "heapInstAnalyzer/merge.hpp"
+#include "heapInstAnalyzer/minheap.hpp"
+#include "heapInstAnalyzer/peak.hpp"
+#include "heapInstAnalyzer/pprof.hpp"
+#include "heapInstAnalyzer/profile.hpp"
+#include "heapInstAnalyzer/realloc_chains.hpp"
+#include "heapInstAnalyzer/receiver.hpp"
+#include "heapInstAnalyzer/replay.hpp"
+#include "heapInstAnalyzer/sketch.hpp"
+#include "heapInstAnalyzer/symbols.hpp"
+#include "heapInstAnalyzer/thinning.hpp"
+#include "heapInstAnalyzer/trace.hpp"
+
+#ifdef HEAPINST_TEST_UDP_PORT
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <heapInstStream.h>
+#endif
+
+using namespace heapinst::analyzer;
+
+namespace
+{
+
+/* Builds synthetic traces with monotonically increasing timestamps */
+class TraceBuilder
+{
+   public:
+    TraceBuilder& Init(uint32_t heap_base = 0, uint32_t heap_size = 0)
+    {
+        record r{};
+        r.operation = HEAP_OP_INIT;
+        r.arg1 = heap_base;
+        r.arg2 = heap_size;
+        r.arg3 = heap_size ? HEAP_INIT_FLAG_HEAP_INFO_VALID : 0;
+        return Push(r);
+    }
+
+    TraceBuilder& Malloc(uint32_t size, uint32_t ptr, uint32_t site = 0x1000, uint16_t tag = 0)
+    {
+        record r{};
+        r.operation = HEAP_OP_MALLOC;
+        r.arg1 = size;
+        r.arg2 = ptr;
+        r.site = site;
+        r.tag = tag;
+        return Push(r);
+    }
+
+    TraceBuilder& Free(uint32_t ptr, uint32_t site = 0x1000)
+    {
+        record r{};
+        r.operation = HEAP_OP_FREE;
+        r.arg1 = ptr;
+        r.site = site;
+        return Push(r);
+    }
+
+    TraceBuilder& Realloc(uint32_t old_ptr, uint32_t size, uint32_t new_ptr, uint32_t site = 0x1000)
+    {
+        record r{};
+        r.operation = HEAP_OP_REALLOC;
+        r.arg1 = old_ptr;
+        r.arg2 = size;
+        r.arg3 = new_ptr;
+        r.site = site;
+        return Push(r);
+    }
+
+    TraceBuilder& Mark(uint32_t id)
+    {
+        record r{};
+        r.operation = HEAP_OP_MARKER;
+        r.arg1 = id;
+        return Push(r);
+    }
+
+    TraceBuilder& Sbrk(int32_t increment, uint32_t new_break, uint32_t flags = 0)
+    {
+        record r{};
+        r.operation = HEAP_OP_SBRK;
+        r.arg1 = static_cast<uint32_t>(increment);
+        r.arg2 = new_break;
+        r.arg3 = flags;
+        return Push(r);
+    }
+
+    TraceBuilder& Memmap(uint32_t region, uint32_t base, uint32_t size)
+    {
+        record r{};
+        r.operation = HEAP_OP_MEMMAP;
+        r.arg1 = region;
+        r.arg2 = base;
+        r.arg3 = size;
+        return Push(r);
+    }
+
+    TraceBuilder& Rss(uint32_t rss_kb, uint32_t anon_kb, uint32_t mappings = 0)
+    {
+        record r{};
+        r.operation = HEAP_OP_RSS;
+        r.arg1 = rss_kb;
+        r.arg2 = anon_kb;
+        r.arg3 = mappings;
+        return Push(r);
+    }
+
+    TraceBuilder& StackHwm(uint32_t stack_id, uint32_t hwm, uint32_t size)
+    {
+        record r{};
+        r.operation = HEAP_OP_STACK_HWM;
+        r.arg1 = stack_id;
+        r.arg2 = hwm;
+        r.arg3 = size;
+        return Push(r);
+    }
+
+    TraceBuilder& Sync(uint64_t reference_us)
+    {
+        record r{};
+        r.operation = HEAP_OP_TIME_SYNC;
+        r.arg1 = static_cast<uint32_t>(reference_us);
+        r.arg2 = static_cast<uint32_t>(reference_us >> 32);
+        return Push(r);
+    }
+
+    TraceBuilder& At(uint64_t time_us)
+    {
+        time_ = time_us;
+        return *this;
+    }
+
+    /* Usable size of the last MALLOC/REALLOC (HEAPINST_CFG_RECORD_USABLE_SIZE) */
+    TraceBuilder& Usable(uint32_t usable)
+    {
+        records_.back().flags |= HEAP_RECORD_FLAG_USABLE_SIZE;
+        records_.back().arg4 = usable;
+        return *this;
+    }
+
+    std::vector<record> Records() const { return records_; }
+    memory_source Source() const { return memory_source(records_); }
+    source_factory Factory() const
+    {
+        return [records = records_]() -> std::unique_ptr<record_source> {
+            return std::make_unique<memory_source>(records);
+        };
+    }
+
+   private:
+    TraceBuilder& Push(record r)
+    {
+        r.timestamp_us = time_;
+        time_ += 10;
+        records_.push_back(r);
+        return *this;
+    }
+
+    std::vector<record> records_;
+    uint64_t time_ = 100;
+};
+
+}  // namespace
+
+TEST(HeapInstAnalyzerTest, ReplayTracksLiveSetAndPeak)
+{
+    auto source = TraceBuilder()
+                      .Init()
+                      .Malloc(100, 0x2000)
+                      .Malloc(50, 0x3000)
+                      .Realloc(0x2000, 200, 0x4000)
+                      .Free(0x3000)
+                      .Free(0x9999)
+                      .Source();
+
+    heap_replay replay;
+    record rec;
+    while (source.next(rec)) {
+        replay.apply(rec);
+    }
+
+    EXPECT_EQ(replay.live_objects(), 1u);
+    EXPECT_EQ(replay.live_bytes(), 200u);
+    EXPECT_EQ(replay.peak_bytes(), 250u);
+    EXPECT_EQ(replay.peak_index(), 3u);
+    EXPECT_EQ(replay.total_allocs(), 3u);
+    EXPECT_EQ(replay.unmatched_frees(), 1u);
+}
+
+TEST(HeapInstAnalyzerTest, ProfileStopsAtMarker)
+{
+    auto source = TraceBuilder()
+                      .Init()
+                      .Malloc(64, 0x2000, 0xA001, 7)
+                      .Malloc(32, 0x3000, 0xB001)
+                      .Free(0x3000)
+                      .Mark(1)
+                      .Malloc(16, 0x4000, 0xB001)
+                      .Source();
+
+    heap_profile profile = build_heap_profile(source, trace_point::parse("marker:1"));
+
+    ASSERT_EQ(profile.entries.size(), 2u);
+    EXPECT_EQ(profile.entries[0].site.site, 0xA001u);
+    EXPECT_EQ(profile.entries[0].tag, 7u);
+    EXPECT_EQ(profile.entries[0].inuse_space, 64u);
+    EXPECT_EQ(profile.entries[1].site.site, 0xB001u);
+    EXPECT_EQ(profile.entries[1].alloc_objects, 1u);
+    EXPECT_EQ(profile.entries[1].alloc_space, 32u);
+    EXPECT_EQ(profile.entries[1].inuse_objects, 0u);
+}
+
+TEST(HeapInstAnalyzerTest, SymbolizerResolvesAddressesAndSiteIds)
+{
+    symbolizer symbols;
+    symbols.add_symbol(0x10000100, 0x40, "parse_packet");
+    symbols.add_symbol(0x10000200, 0, "main");
+    symbols.add_file(0x1234, "src/net.c");
+
+    EXPECT_EQ(symbols.name({0x10000121, false}), "parse_packet");  // Thumb return address
+    EXPECT_EQ(symbols.name({0x10000150, false}), "0x10000150");    // past the symbol size
+    EXPECT_EQ(symbols.name({0x10000300, false}), "main");
+    EXPECT_EQ(symbols.name({0x1234002A, true}), "src/net.c:42");
+}
+
+TEST(HeapInstAnalyzerTest, PprofEncodesSampleTypesAndFunctions)
+{
+    auto source = TraceBuilder().Init().Malloc(64, 0x2000, 0x10000121).Source();
+    heap_profile profile = build_heap_profile(source);
+
+    symbolizer symbols;
+    symbols.add_symbol(0x10000100, 0x40, "parse_packet");
+    std::ostringstream out;
+    write_pprof(profile, symbols, out);
+    std::string pb = out.str();
+
+    ASSERT_FALSE(pb.empty());
+    EXPECT_EQ(static_cast<uint8_t>(pb[0]), (1u << 3) | 2u);  // sample_type, length-delimited
+    for (const char* s : {"alloc_objects", "alloc_space", "inuse_objects", "inuse_space", "parse_packet"}) {
+        EXPECT_NE(pb.find(s), std::string::npos) << s;
+    }
+}
+
+TEST(HeapInstAnalyzerTest, MassifSnapshotsAreBoundedAndIncludePeak)
+{
+    TraceBuilder trace;
+    trace.Init();
+    for (uint32_t i = 0; i < 1000; ++i) {
+        trace.Malloc(100, 0x2000 + i * 0x100, 0xA001 + (i % 2) * 0x10);
+    }
+    for (uint32_t i = 0; i < 1000; ++i) {
+        trace.Free(0x2000 + i * 0x100);
+    }
+    auto source = trace.Source();
+
+    massif_options options;
+    options.time_unit = "i";
+    options.max_snapshots = 20;
+    std::ostringstream out;
+    write_massif(source, symbolizer(), options, out);
+    std::string text = out.str();
+
+    size_t snapshots = 0;
+    for (size_t pos = 0; (pos = text.find("\nsnapshot=", pos)) != std::string::npos; ++pos) {
+        snapshots++;
+    }
+    EXPECT_LE(snapshots, 21u);  // bounded table plus the peak
+    EXPECT_GE(snapshots, 10u);
+    EXPECT_NE(text.find("time_unit: i\n"), std::string::npos);
+    EXPECT_NE(text.find("heap_tree=peak\nn2: 100000 (heap allocation functions)"), std::string::npos);
+    EXPECT_NE(text.find(" n0: 50000 0xA001: 0x0000a001\n"), std::string::npos);
+}
+
+TEST(HeapInstAnalyzerTest, HeaptrackInternsFramesAndAllocationInfos)
+{
+    auto source = TraceBuilder()
+                      .Init()
+                      .Malloc(0x20, 0x2000, 0xA001)
+                      .At(2000)
+                      .Malloc(0x20, 0x3000, 0xA001)
+                      .Free(0x2000)
+                      .Realloc(0x3000, 0x40, 0x4000, 0xB001)
+                      .Source();
+
+    std::ostringstream out;
+    write_heaptrack(source, symbolizer(), heaptrack_options(), out);
+
+    EXPECT_EQ(out.str(),
+              "v 10200 2\n"
+              "X heapInst trace\n"
+              "I 1000 0\n"
+              "s firmware\n"
+              "s 0x0000a001\n"
+              "i a001 1 2\n"
+              "t 1 0\n"
+              "a 20 1\n"
+              "+ 0\n"
+              "c 2\n"
+              "+ 0\n"
+              "- 0\n"
+              "- 0\n"
+              "s 0x0000b001\n"
+              "i b001 1 3\n"
+              "t 2 0\n"
+              "a 40 2\n"
+              "+ 1\n");
+}
+
+TEST(HeapInstAnalyzerTest, FoldedStacksWeighByBytesCountOrLive)
+{
+    auto source = TraceBuilder()
+                      .Init()
+                      .Malloc(100, 0x2000, 0x10000121, 3)
+                      .Malloc(10, 0x3000, 0xA001)
+                      .Malloc(10, 0x4000, 0xA001)
+                      .Free(0x2000)
+                      .Source();
+    heap_profile profile = build_heap_profile(source);
+
+    symbolizer symbols;
+    symbols.add_symbol(0x10000100, 0x40, "ns::f(int; char)");
+
+    auto fold = [&](folded_weight weight, bool tags) {
+        std::ostringstream out;
+        write_folded(profile, symbols, folded_options{weight, tags}, out);
+        return out.str();
+    };
+    EXPECT_EQ(fold(folded_weight::bytes, false), "ns::f(int: char) 100\n0x0000a001 20\n");
+    EXPECT_EQ(fold(folded_weight::count, false), "0x0000a001 2\nns::f(int: char) 1\n");
+    EXPECT_EQ(fold(folded_weight::live_bytes, false), "0x0000a001 20\n");
+    EXPECT_EQ(fold(folded_weight::bytes, true), "tag:3;ns::f(int: char) 100\n0x0000a001 20\n");
+}
+
+TEST(HeapInstAnalyzerTest, PeakBreakdownGlobalAndWithinMarkerRange)
+{
+    auto trace = TraceBuilder()
+                     .Init()
+                     .Malloc(1000, 0x2000, 0xA001, 1)
+                     .Free(0x2000)
+                     .Mark(1)
+                     .Malloc(300, 0x3000, 0xB001, 2)
+                     .At(5000)
+                     .Malloc(20, 0x4000, 0xC001, 2)
+                     .Free(0x3000)
+                     .Mark(2);
+
+    peak_report global = analyze_peak(trace.Factory());
+    ASSERT_TRUE(global.found);
+    EXPECT_EQ(global.bytes, 1000u);
+    EXPECT_EQ(global.index, 1u);
+
+    peak_report phase = analyze_peak(trace.Factory(), {trace_point::parse("marker:1"), trace_point::parse("marker:2")});
+    ASSERT_TRUE(phase.found);
+    EXPECT_EQ(phase.bytes, 320u);
+    EXPECT_EQ(phase.objects, 2u);
+    EXPECT_EQ(phase.index, 5u);
+    EXPECT_EQ(phase.range_first, 3u);
+    EXPECT_EQ(phase.range_last, 7u);
+
+    ASSERT_EQ(phase.by_site.size(), 2u);
+    EXPECT_EQ(phase.by_site[0].key, (callsite{0xB001, false}.key()));
+    ASSERT_EQ(phase.by_tag.size(), 1u);
+    EXPECT_EQ(phase.by_tag[0].key, 2u);
+    EXPECT_EQ(phase.by_tag[0].count, 2u);
+    ASSERT_EQ(phase.by_size.size(), 2u);
+    EXPECT_EQ(phase.by_size[0].key, 16u);
+    EXPECT_EQ(phase.by_size[1].key, 256u);
+    // The 300-byte block is ~4.9 ms old at the peak, the 20-byte one brand new
+    ASSERT_EQ(phase.by_age.size(), 2u);
+    EXPECT_EQ(phase.by_age[0].bytes, 20u);
+    EXPECT_EQ(phase.by_age[1].key, 10000u);
+}
+
+TEST(HeapInstAnalyzerTest, PeakReportsSlackPerSizeClass)
+{
+    auto trace = TraceBuilder()
+                     .Init()
+                     .Malloc(20, 0x1000).Usable(24)
+                     .Malloc(17, 0x1020).Usable(32)
+                     .Malloc(100, 0x1040).Usable(104)
+                     .Malloc(8, 0x10c0);
+
+    peak_report report = analyze_peak(trace.Factory());
+    ASSERT_TRUE(report.found);
+    EXPECT_TRUE(report.usable_known);
+    ASSERT_EQ(report.by_size.size(), 3u);
+    EXPECT_EQ(report.by_size[0].key, 8u); /* no usable size: no slack */
+    EXPECT_EQ(report.by_size[0].slack(), 0u);
+    EXPECT_EQ(report.by_size[1].key, 16u);
+    EXPECT_EQ(report.by_size[1].bytes, 37u);
+    EXPECT_EQ(report.by_size[1].usable, 56u);
+    EXPECT_EQ(report.by_size[1].slack(), 19u);
+    EXPECT_EQ(report.by_size[2].slack(), 4u);
+
+    std::ostringstream out;
+    write_peak_report(report, symbolizer(), 10, out);
+    EXPECT_NE(out.str().find("by size class (requested, usable, slack)"), std::string::npos) << out.str();
+    EXPECT_NE(out.str().find("56 B        19 B  33.9%"), std::string::npos) << out.str();
+    EXPECT_NE(out.str().find("slack at peak: 23 B of 168 B usable"), std::string::npos) << out.str();
+}
+
+TEST(HeapInstAnalyzerTest, MinHeapAccountsForFragmentation)
+{
+    // Free every other 24-byte block, then ask for 48 bytes: without
+    // coalescable neighbours the hole pattern forces the region to grow.
+    TraceBuilder trace;
+    trace.Init(0x20000000, 4096);
+    for (uint32_t i = 0; i < 8; ++i) {
+        trace.Malloc(24, 0x1000 + i * 0x100);
+    }
+    for (uint32_t i = 0; i < 8; i += 2) {
+        trace.Free(0x1000 + i * 0x100);
+    }
+    trace.Malloc(48, 0x8000);
+    auto source = trace.Source();
+    heap_workload workload = heap_workload::from(source);
+    EXPECT_EQ(workload.heap_size(), 4096u);
+    EXPECT_EQ(workload.peak_requested(), 192u);
+
+    allocator_model model;  // 8-byte header, 8-byte alignment: 24 -> 32, 48 -> 56
+    EXPECT_EQ(model.chunk_size(24), 32u);
+    EXPECT_EQ(min_heap_lower_bound(workload, model), 256u);
+
+    uint64_t needed = min_heap_size(workload, model);
+    EXPECT_EQ(needed, 256u + 56u);
+    EXPECT_TRUE(workload_fits(workload, model, needed));
+    EXPECT_FALSE(workload_fits(workload, model, needed - model.align));
+}
+
+TEST(HeapInstAnalyzerTest, MinHeapGrowsReallocInPlace)
+{
+    auto source = TraceBuilder().Init().Malloc(24, 0x1000).Realloc(0x1000, 100, 0x1000).Source();
+    heap_workload workload = heap_workload::from(source);
+
+    allocator_model model;
+    // In place: only the grown chunk is needed, not old + new during a copy
+    EXPECT_EQ(min_heap_size(workload, model), model.chunk_size(100));
+}
+
+TEST(HeapInstAnalyzerTest, SpilledProfileMatchesInMemory)
+{
+    // Pseudo-random churn over a small pointer space, with a restart midway
+    TraceBuilder trace;
+    trace.Init();
+    uint32_t state = 12345;
+    auto next = [&state]() { return state = state * 1103515245u + 12345u; };
+    for (int i = 0; i < 5000; ++i) {
+        uint32_t r = next();
+        uint32_t ptr = 0x1000 + ((r >> 8) % 200) * 0x40;
+        uint32_t site = 0xA000 + ((r >> 20) % 37) * 0x10;
+        switch ((r >> 4) % 4) {
+            case 0:
+            case 1:
+                trace.Malloc(1 + (r >> 16) % 500, ptr, site, static_cast<uint16_t>(r % 3));
+                break;
+            case 2:
+                trace.Free(ptr);
+                break;
+            default:
+                trace.Realloc(ptr, (r >> 16) % 300, 0x1000 + ((r >> 12) % 200) * 0x40, site);
+                break;
+        }
+        if (i == 2500) {
+            trace.Init();
+        }
+    }
+
+    auto a = trace.Source();
+    heap_profile expected = build_heap_profile(a, trace_point::parse("45000"));
+    auto b = trace.Source();
+    heap_profile spilled = build_heap_profile_spilled(b, trace_point::parse("45000"), spill_options{4096, {}});
+
+    EXPECT_EQ(spilled.records, expected.records);
+    EXPECT_EQ(spilled.start_us, expected.start_us);
+    EXPECT_EQ(spilled.end_us, expected.end_us);
+    ASSERT_EQ(spilled.entries.size(), expected.entries.size());
+    for (size_t i = 0; i < expected.entries.size(); ++i) {
+        const profile_entry& x = expected.entries[i];
+        const profile_entry& y = spilled.entries[i];
+        EXPECT_EQ(y.site, x.site) << i;
+        EXPECT_EQ(y.tag, x.tag) << i;
+        EXPECT_EQ(y.alloc_objects, x.alloc_objects) << i;
+        EXPECT_EQ(y.alloc_space, x.alloc_space) << i;
+        EXPECT_EQ(y.inuse_objects, x.inuse_objects) << i;
+        EXPECT_EQ(y.inuse_space, x.inuse_space) << i;
+    }
+}
+
+TEST(HeapInstAnalyzerTest, ExternalSorterMergesManyRuns)
+{
+    external_sorter<uint32_t> sorter(16, {}, 4);
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        uint32_t v = (i * 7919u) % 1009u;
+        sorter.add(v);
+        expected.push_back(v);
+    }
+    std::sort(expected.begin(), expected.end());
+
+    std::vector<uint32_t> merged;
+    sorter.merge([&](uint32_t v) { merged.push_back(v); });
+    EXPECT_GT(sorter.runs_written(), 4u);
+    EXPECT_EQ(merged, expected);
+}
+
+TEST(HeapInstAnalyzerTest, AddressIndexAnswersOwnerBeforeAndAfter)
+{
+    TraceBuilder trace;
+    trace.Init()
+        .Malloc(32, 0x2000)
+        .Malloc(16, 0x2040)
+        .Free(0x2000)
+        .Mark(1)
+        .Malloc(48, 0x1ff0, 0x1100)
+        .Realloc(0x2040, 32, 0x2040);
+    memory_source source = trace.Source();
+    address_index index = address_index::build(source);
+
+    ASSERT_EQ(index.blocks().size(), 4u);
+    EXPECT_EQ(index.positions(), 7u);
+    EXPECT_EQ(index.position_of(trace_point::parse("marker:1")), 5u);
+    EXPECT_EQ(index.position_of(trace_point::parse("125")), 3u);
+    EXPECT_FALSE(index.position_of(trace_point::parse("marker:9")).has_value());
+
+    auto owner = index.owner_at(0x2010, 3);
+    ASSERT_TRUE(owner.has_value());
+    EXPECT_EQ(owner->address, 0x2000u);
+    EXPECT_EQ(owner->until, 4u);
+
+    /* Freed gap: the block before and the one reusing the address after */
+    EXPECT_FALSE(index.owner_at(0x2010, 4).has_value());
+    auto before = index.previous_owner(0x2010, 4);
+    auto after = index.next_owner(0x2010, 4);
+    ASSERT_TRUE(before.has_value() && after.has_value());
+    EXPECT_EQ(before->address, 0x2000u);
+    EXPECT_EQ(after->address, 0x1ff0u);
+    EXPECT_EQ(after->since, 6u);
+    EXPECT_EQ(after->site.site, 0x1100u);
+    EXPECT_EQ(index.owner_at(0x2010, 7)->address, 0x1ff0u);
+
+    /* In-place realloc: the grown block starts at the realloc record */
+    EXPECT_FALSE(index.owner_at(0x2050, 6).has_value());
+    EXPECT_EQ(index.owner_at(0x2044, 6)->size, 16u);
+    EXPECT_EQ(index.owner_at(0x2050, 7)->size, 32u);
+    EXPECT_EQ(index.owner_at(0x2050, 7)->until, block_lifetime::kLive);
+
+    EXPECT_EQ(index.query(0x2000, 0x2050, 0, 7).size(), 4u);
+    EXPECT_TRUE(index.query(0x2000, 0x2020, 4, 5).empty());
+    EXPECT_EQ(index.query(0x1f00, 0x3000, 4, 4).size(), 1u);
+    EXPECT_FALSE(index.owner_at(0x1000, 7).has_value());
+}
+
+TEST(HeapInstAnalyzerTest, AddressIndexEndsStaleBlocksOnOverlap)
+{
+    /* The frees of both 0x3000 blocks were lost; 0x2ff8 overlaps them */
+    TraceBuilder trace;
+    trace.Init().Malloc(32, 0x3000).Malloc(32, 0x3020).Malloc(64, 0x2ff8).Malloc(8, 0x3040);
+    memory_source source = trace.Source();
+    address_index index = address_index::build(source);
+
+    ASSERT_EQ(index.blocks().size(), 4u);
+    EXPECT_EQ(index.blocks()[0].until, 4u);
+    EXPECT_EQ(index.blocks()[1].until, 4u);
+    EXPECT_EQ(index.blocks()[3].until, block_lifetime::kLive);
+
+    EXPECT_EQ(index.owner_at(0x3010, 3)->address, 0x3000u);
+    EXPECT_EQ(index.owner_at(0x3010, 4)->address, 0x2ff8u);
+    EXPECT_EQ(index.owner_at(0x3030, 5)->address, 0x2ff8u);
+    EXPECT_EQ(index.owner_at(0x3040, 5)->address, 0x3040u);
+    EXPECT_EQ(index.previous_owner(0x3030, 5)->address, 0x3020u);
+    EXPECT_EQ(index.previous_owner(0x3010, 5)->address, 0x3000u);
+    EXPECT_EQ(index.query(0x3000, 0x3040, 4, 5).size(), 1u);
+}
+
+TEST(HeapInstAnalyzerTest, ReallocChainsFollowMovesToFinalSize)
+{
+    TraceBuilder trace;
+    trace.Init()
+        .Malloc(16, 0x100, 0x1000)
+        .Realloc(0x100, 32, 0x200, 0x1010)
+        .Realloc(0x200, 64, 0x200, 0x1010) /* in place: no copy */
+        .Realloc(0x200, 128, 0x400, 0x1010)
+        .Malloc(8, 0x800, 0x2000)
+        .Realloc(0x800, 16, 0x900, 0x2010)
+        .Free(0x900)
+        .Malloc(8, 0xa00, 0x3000) /* never grows */
+        .Realloc(0, 24, 0xb00, 0x2000)
+        .Realloc(0xb00, 48, 0xc00, 0x2010);
+    memory_source source = trace.Source();
+    chain_report report = analyze_realloc_chains(source);
+
+    EXPECT_EQ(report.chains, 3u);
+    EXPECT_EQ(report.reallocs, 5u);
+    EXPECT_EQ(report.moves, 4u);
+    EXPECT_EQ(report.copied_bytes, 16u + 64u + 8u + 24u);
+
+    ASSERT_EQ(report.top.size(), 3u);
+    const realloc_chain& worst = report.top[0];
+    EXPECT_EQ(worst.origin.site, 0x1000u);
+    EXPECT_EQ(worst.grow_site.site, 0x1010u);
+    EXPECT_EQ(worst.reallocs, 3u);
+    EXPECT_EQ(worst.moves, 2u);
+    EXPECT_EQ(worst.copied_bytes, 80u);
+    EXPECT_EQ(worst.initial_size, 16u);
+    EXPECT_EQ(worst.final_size, 128u);
+    EXPECT_EQ(worst.final_ptr, 0x400u);
+    EXPECT_TRUE(worst.live);
+
+    ASSERT_EQ(report.by_site.size(), 2u);
+    EXPECT_EQ(report.by_site[0].origin.site, 0x1000u);
+    EXPECT_EQ(report.by_site[1].origin.site, 0x2000u);
+    EXPECT_EQ(report.by_site[1].chains, 2u);
+    EXPECT_EQ(report.by_site[1].max_final_size, 48u);
+
+    chain_options options;
+    options.top = 1;
+    options.min_reallocs = 2;
+    memory_source again = trace.Source();
+    chain_report filtered = analyze_realloc_chains(again, options);
+    EXPECT_EQ(filtered.chains, 1u);
+    EXPECT_EQ(filtered.top.size(), 1u);
+}
+
+TEST(HeapInstAnalyzerTest, ThinnedSeriesStaysBoundedAndEvenlySpaced)
+{
+    thinned_series<int> series(4);
+    for (int event = 0; event < 100; event++) {
+        series.add(event);
+    }
+    /* 5 samples at interval 16 overflowed to 3 at interval 32, then 96 arrived */
+    EXPECT_EQ(series.samples(), (std::vector<int>{0, 32, 64, 96}));
+
+    thinned_series<int> unbounded;
+    for (int event = 0; event < 10; event++) {
+        unbounded.add(event);
+    }
+    EXPECT_EQ(unbounded.take().size(), 10u);
+}
+
+TEST(HeapInstAnalyzerTest, FreeSpaceSplitsAndMergesGaps)
+{
+    free_space space;
+    space.reset(0, 100);
+    space.occupy(10, 20);
+    space.occupy(50, 60);
+    EXPECT_EQ(space.gaps(), 3u);
+    EXPECT_EQ(space.total_free(), 80u);
+    EXPECT_EQ(space.largest_free(), 40u);
+    EXPECT_DOUBLE_EQ(space.fragmentation(), 0.5);
+
+    space.occupy(0, 10); /* exactly fills the first gap */
+    EXPECT_EQ(space.gaps(), 2u);
+    space.release(50, 60);
+    EXPECT_EQ(space.gaps(), 1u);
+    EXPECT_EQ(space.largest_free(), 80u);
+    space.release(0, 20);
+    EXPECT_EQ(space.gaps(), 1u);
+    EXPECT_EQ(space.total_free(), 100u);
+    EXPECT_DOUBLE_EQ(space.fragmentation(), 0.0);
+
+    space.occupy(90, 200); /* clipped to the region */
+    EXPECT_EQ(space.total_free(), 90u);
+}
+
+TEST(HeapInstAnalyzerTest, FragmentationTimelineTracksLargestGap)
+{
+    TraceBuilder trace;
+    trace.Init(0x1000, 0x100)
+        .Malloc(0x40, 0x1000)
+        .Malloc(0x40, 0x1040)
+        .Malloc(0x40, 0x1080)
+        .Free(0x1000)
+        .Free(0x1080) /* merges with the tail gap */
+        .Malloc(0x20, 0x1080)
+        .Free(0x1040);
+    fragmentation_report report = analyze_fragmentation(trace.Factory());
+
+    EXPECT_EQ(report.heap_base, 0x1000u);
+    EXPECT_EQ(report.heap_size, 0x100u);
+    EXPECT_FALSE(report.region_from_extent);
+    ASSERT_EQ(report.timeline.size(), 8u);
+
+    /* After the third malloc: one 0x40 gap at the end */
+    EXPECT_EQ(report.timeline[3].largest_free, 0x40u);
+    EXPECT_EQ(report.timeline[3].gaps, 1u);
+    EXPECT_EQ(report.min_largest_free.largest_free, 0x40u);
+    EXPECT_EQ(report.min_largest_free.index, 3u);
+
+    /* 0x40 free at the front, 0x40 at the back: half of the free space unusable */
+    EXPECT_EQ(report.timeline[4].gaps, 2u);
+    EXPECT_DOUBLE_EQ(report.timeline[4].fragmentation, 0.5);
+    EXPECT_EQ(report.timeline[5].largest_free, 0x80u);
+
+    /* 0x80 free below the block at 0x1080, 0x60 above it */
+    EXPECT_EQ(report.final.gaps, 2u);
+    EXPECT_EQ(report.final.total_free, 0xe0u);
+    EXPECT_EQ(report.final.largest_free, 0x80u);
+    EXPECT_EQ(report.final.used, 0x20u);
+
+    /* Without INIT heap info the region is the allocation extent */
+    TraceBuilder bare;
+    bare.Malloc(0x10, 0x2000).Malloc(0x10, 0x2030);
+    fragmentation_options options;
+    options.max_samples = 1;
+    fragmentation_report extent = analyze_fragmentation(bare.Factory(), options);
+    EXPECT_TRUE(extent.region_from_extent);
+    EXPECT_EQ(extent.heap_base, 0x2000u);
+    EXPECT_EQ(extent.heap_size, 0x40u);
+    EXPECT_EQ(extent.final.largest_free, 0x20u);
+    EXPECT_LE(extent.timeline.size(), 1u);
+}
+
+TEST(HeapInstAnalyzerTest, ArenaTracksBreakAgainstLiveBytesAndStack)
+{
+    TraceBuilder trace;
+    trace.Init(0x20000000, 0x1000)
+        .Memmap(HEAP_MEMMAP_STACK, 0x20001000, 0x800)
+        .Sbrk(0x400, 0x20000400)
+        .Malloc(0x100, 0x20000010)
+        .StackHwm(0, 0x200, 0x800)
+        .Sbrk(0x800, 0x20000c00)
+        .Sbrk(0x800, 0, HEAP_SBRK_FLAG_FAILED)
+        .Sbrk(-0x400, 0x20000800, HEAP_SBRK_FLAG_OBSERVED);
+    memory_source source = trace.Source();
+    arena_report report = analyze_arena(source);
+
+    EXPECT_EQ(report.sbrk_calls, 4u);
+    EXPECT_EQ(report.failed, 1u);
+    EXPECT_EQ(report.observed, 1u);
+    EXPECT_EQ(report.arena_base, 0x20000000u);
+    EXPECT_EQ(report.peak_break.brk, 0x20000c00u);
+    EXPECT_EQ(report.peak_break.arena, 0xc00u);
+    EXPECT_EQ(report.peak_break.live, 0x100u);
+    ASSERT_TRUE(report.has_headroom);
+    EXPECT_EQ(report.min_headroom.headroom, 0x400);
+    ASSERT_TRUE(report.has_stack_gap);
+    EXPECT_EQ(report.min_stack_gap.stack_gap, 0x20001600 - 0x20000c00);
+    EXPECT_EQ(report.final.brk, 0x20000800u);
+    EXPECT_EQ(report.final.headroom, 0x800);
+
+    std::ostringstream csv;
+    write_arena_csv(report, csv);
+    EXPECT_NE(csv.str().find(",3072,256,1024,2560,,\n"), std::string::npos) << csv.str();
+}
+
+TEST(HeapInstAnalyzerTest, ArenaPairsLiveBytesWithRss)
+{
+    TraceBuilder trace;
+    trace.Init()
+        .Malloc(0x1000, 0x5000)
+        .Rss(2048, 512, 40)
+        .Malloc(0x3000, 0x7000)
+        .Rss(4096, 1024, 42)
+        .Free(0x7000)
+        .Rss(3072, 768, 42);
+    memory_source source = trace.Source();
+    arena_report report = analyze_arena(source);
+
+    EXPECT_EQ(report.sbrk_calls, 0u);
+    EXPECT_EQ(report.rss_samples, 3u);
+    EXPECT_EQ(report.peak_rss.rss_kb, 4096u);
+    EXPECT_EQ(report.peak_rss.anon_kb, 1024u);
+    EXPECT_EQ(report.peak_rss.live, 0x4000u);
+    EXPECT_EQ(report.final.live, 0x1000u);
+    EXPECT_EQ(report.final.rss_kb, 3072u);
+
+    std::ostringstream csv;
+    write_arena_csv(report, csv);
+    EXPECT_NE(csv.str().find("\n110,1,0,0,4096,,,,\n"), std::string::npos) << csv.str();
+    EXPECT_NE(csv.str().find(",0,0,16384,,,4096,1024\n"), std::string::npos) << csv.str();
+
+    std::ostringstream text;
+    write_arena_report(report, text);
+    EXPECT_NE(text.str().find("peak 4096 KiB (anon 1024 KiB)"), std::string::npos) << text.str();
+    EXPECT_NE(text.str().find("live at peak RSS: 1.6% of anonymous memory"), std::string::npos) << text.str();
+}
+
+TEST(HeapInstAnalyzerTest, BanksSplitStripedBlocksAndTrackOccupancy)
+{
+    memory_map map = memory_map::rp2350();
+    ASSERT_EQ(map.banks().size(), 10u);
+    EXPECT_EQ(map.banks()[0].capacity, 0x10000u);
+    EXPECT_EQ(map.banks()[8].name, "SRAM8");
+
+    /* 10 bytes from 0x20000002: 2 in SRAM0, 4 in SRAM1, 4 in SRAM2 */
+    std::vector<uint64_t> bytes(10, 0);
+    uint64_t unmapped = map.split(0x20000002, 0x2000000c, [&](size_t bank, uint64_t n) { bytes[bank] += n; });
+    EXPECT_EQ(unmapped, 0u);
+    EXPECT_EQ(bytes[0], 2u);
+    EXPECT_EQ(bytes[1], 4u);
+    EXPECT_EQ(bytes[2], 4u);
+    EXPECT_EQ(map.split(0x20081ff0, 0x20082010, [](size_t, uint64_t) {}), 0x10u);
+
+    std::istringstream text("# two banks\nbank A 0x100 0x100\nstriped 0x200 0x20 8 B C  # tail\n");
+    memory_map custom = memory_map::parse(text);
+    ASSERT_EQ(custom.banks().size(), 3u);
+    EXPECT_EQ(custom.banks()[2].capacity, 0x10u);
+    std::istringstream bad("bank A 0x100\n");
+    EXPECT_THROW(memory_map::parse(bad), std::invalid_argument);
+
+    TraceBuilder trace;
+    trace.Init(0x20000000, 0x20000)
+        .Malloc(16, 0x20000000, 0x1000) /* 4 bytes in each of SRAM0-3 */
+        .Malloc(64, 0x20080000, 0x2000) /* scratch X only */
+        .At(1100)
+        .Free(0x20080000)
+        .At(2100)
+        .Malloc(8, 0x10000000, 0x3000); /* flash: no bank */
+    memory_source source = trace.Source();
+    bank_report report = analyze_banks(source, map);
+
+    ASSERT_EQ(report.usage.size(), 10u);
+    EXPECT_EQ(report.usage[0].heap_capacity, 0x8000u);
+    EXPECT_EQ(report.usage[0].peak_bytes, 4u);
+    EXPECT_EQ(report.usage[3].live_bytes, 4u);
+    EXPECT_EQ(report.usage[8].peak_bytes, 64u);
+    EXPECT_EQ(report.usage[8].live_bytes, 0u);
+    EXPECT_EQ(report.unmapped_blocks, 1u);
+    ASSERT_EQ(report.usage[8].hot.size(), 1u);
+    EXPECT_EQ(report.usage[8].hot[0].site.site, 0x2000u);
+    EXPECT_DOUBLE_EQ(report.usage[8].hot[0].byte_us, 64.0 * (1100 - 120));
+    EXPECT_EQ(report.timeline.back().bytes.back(), 8u);
+}
+
+TEST(HeapInstAnalyzerTest, BanksSumTheRamBudget)
+{
+    memory_map map = memory_map::rp2350();
+    TraceBuilder trace;
+    trace.Init(0x20001000, 0x1000)
+        .Memmap(HEAP_MEMMAP_DATA, 0x20000000, 0x100)
+        .Memmap(HEAP_MEMMAP_BSS, 0x20000100, 0x300)
+        .Memmap(HEAP_MEMMAP_HEAP, 0x20001000, 0x7e000)
+        .Memmap(HEAP_MEMMAP_STACK, 0x20081000, 0x800)
+        .Memmap(HEAP_MEMMAP_STACK1, 0x20080000, 0x800)
+        .Memmap(HEAP_MEMMAP_SCRATCH_Y, 0x20081800, 0x100)
+        .Memmap(HEAP_MEMMAP_DATA, 0x10000000, 0x40) /* flash: not SRAM */
+        .Malloc(0x2000, 0x20002000)
+        .Malloc(0x1000, 0x20004000)
+        .Free(0x20002000)
+        .Malloc(0x800, 0x20006000);
+    memory_source source = trace.Source();
+    bank_report report = analyze_banks(source, map);
+
+    const ram_budget& b = report.budget;
+    EXPECT_EQ(b.sram, 0x82000u);
+    EXPECT_EQ(b.data, 0x100u);
+    EXPECT_EQ(b.bss, 0x300u);
+    EXPECT_EQ(b.stacks, 0x1000u);
+    EXPECT_EQ(b.scratch, 0x100u);
+    EXPECT_EQ(b.static_bytes(), 0x1500u);
+    EXPECT_EQ(b.heap_region, 0x7e000u);
+    EXPECT_EQ(b.heap_peak, 0x3000u);
+    EXPECT_EQ(b.heap_peak_time_us, 190u);
+
+    std::ostringstream text;
+    write_bank_report(report, symbolizer(), text);
+    EXPECT_NE(text.str().find("RAM budget (532480 B of SRAM)"), std::string::npos) << text.str();
+    EXPECT_NE(text.str().find("suggestion: 503808 B of the heap region are never used"), std::string::npos)
+        << text.str();
+}
+
+TEST(HeapInstAnalyzerTest, DdSketchQuantilesWithinAccuracyAndMerge)
+{
+    dd_sketch low(0.01), high(0.01), all(0.01);
+    for (int v = 1; v <= 1000; v++) {
+        (v <= 500 ? low : high).add(v);
+        all.add(v);
+    }
+    low.merge(high);
+    EXPECT_EQ(low.count(), 1000u);
+    for (double q : {0.1, 0.5, 0.9, 0.99}) {
+        double exact = std::floor(q * 999) + 1;
+        EXPECT_NEAR(low.quantile(q), exact, exact * 0.01 + 1e-9) << q;
+        EXPECT_DOUBLE_EQ(low.quantile(q), all.quantile(q));
+    }
+    EXPECT_DOUBLE_EQ(low.quantile(1.0), 1000.0);
+    EXPECT_THROW(low.merge(dd_sketch(0.05)), std::invalid_argument);
+
+    dd_sketch bounded(0.01, 8);
+    for (int v = 1; v <= 100000; v *= 2) {
+        bounded.add(v);
+    }
+    EXPECT_EQ(bounded.count(), 17u);
+    EXPECT_NEAR(bounded.quantile(1.0), 65536.0, 1e-9);
+}
+
+TEST(HeapInstAnalyzerTest, FleetMergesTracesAndFlagsOutliers)
+{
+    std::vector<std::string> files;
+    for (int device = 0; device < 8; device++) {
+        TraceBuilder trace;
+        trace.Init().Malloc(100, 0x100, 0x1000).Malloc(24, 0x200, 0x2000).Free(0x100);
+        if (device == 5) {
+            /* The leaky one */
+            trace.Malloc(50000, 0x1000, 0x3000);
+        }
+        std::string path = ::testing::TempDir() + "fleet_" + std::to_string(device) + ".bin";
+        write_trace(path, trace.Records());
+        files.push_back(path);
+    }
+    files.push_back(::testing::TempDir() + "fleet_missing.bin");
+
+    fleet_options options;
+    options.jobs = 3;
+    fleet_report report = analyze_fleet(files, options);
+
+    EXPECT_EQ(report.total.traces, 8u);
+    EXPECT_EQ(report.failed_files, 1u);
+    EXPECT_FALSE(report.devices.back().error.empty());
+    EXPECT_EQ(report.total.allocs, 17u);
+    EXPECT_EQ(report.total.frees, 8u);
+    EXPECT_EQ(report.total.final_live, 8u * 24 + 50000);
+    EXPECT_EQ(report.total.lifetime_us.count(), 8u);
+    EXPECT_EQ(report.total.sizes.buckets[7], 8u); /* 100 in [64, 128) */
+    ASSERT_EQ(report.total.sites.count(0x2000), 1u);
+    EXPECT_EQ(report.total.sites[0x2000].traces, 8u);
+    EXPECT_EQ(report.total.sites[0x2000].live_bytes, 8u * 24);
+
+    ASSERT_FALSE(report.outliers.empty());
+    for (const fleet_outlier& o : report.outliers) {
+        EXPECT_EQ(o.device, 5u) << o.metric;
+    }
+
+    std::ostringstream out;
+    write_fleet_report(report, symbolizer(), 10, true, out);
+    EXPECT_NE(out.str().find("fleet_5.bin"), std::string::npos);
+
+    for (const std::string& path : files) {
+        std::remove(path.c_str());
+    }
+}
+
+TEST(HeapInstAnalyzerTest, FleetTreatsReceiveDirectoriesAsOneDevice)
+{
+    namespace fs = std::filesystem;
+    fs::path root = fs::path(::testing::TempDir()) / "fleet_receive";
+    fs::remove_all(root);
+    fs::create_directories(root / "dev0001");
+    fs::create_directories(root / "plain");
+
+    TraceBuilder first;
+    first.Init().Malloc(100, 0x100).Malloc(24, 0x200);
+    TraceBuilder second;
+    second.At(500).Free(0x100).Malloc(8, 0x300);
+    write_trace((root / "dev0001" / "000001.bin").string(), first.Records());
+    write_trace((root / "dev0001" / "000002.bin").string(), second.Records());
+    std::ofstream(root / "dev0001" / "index.csv") << "segment,first_seq,last_seq,frames,bytes,lost\n";
+    write_trace((root / "plain" / "trace.bin").string(), first.Records());
+    std::ofstream(root / "plain" / "notes.txt") << "not a trace\n";
+
+    std::vector<std::string> files = collect_trace_files({root.string()});
+    ASSERT_EQ(files.size(), 2u);
+    EXPECT_EQ(fs::path(files[0]).filename(), "dev0001");
+    EXPECT_EQ(fs::path(files[1]).filename(), "trace.bin");
+    EXPECT_EQ(collect_trace_files({(root / "dev0001").string() + "/"}).size(), 1u);
+
+    fleet_report report = analyze_fleet(files);
+    EXPECT_EQ(report.failed_files, 0u);
+    ASSERT_EQ(report.devices.size(), 2u);
+    EXPECT_EQ(report.devices[0].records, 5u);
+    EXPECT_EQ(report.devices[0].allocs, 3u);
+    EXPECT_EQ(report.devices[0].final_live, 32u);
+    EXPECT_EQ(report.devices[1].records, 3u);
+
+    fs::remove_all(root);
+}
+
+TEST(HeapInstAnalyzerTest, LiveStateSendsFullSnapshotThenDeltas)
+{
+    TraceBuilder trace;
+    trace.Init(0x1000, 0x100).Malloc(0x40, 0x1000, 0x1000).Malloc(0x20, 0x1080, 0x2000);
+    live_state state;
+    for (const record& rec : trace.Records()) {
+        state.apply(rec);
+    }
+    symbolizer symbols;
+    symbols.add_symbol(0x0ff0, 0x20, "make_\"frame\"");
+
+    live_view early, late;
+    std::string full = live_delta_json(state.sample(), early, symbols);
+    EXPECT_NE(full.find("\"full\":true"), std::string::npos);
+    EXPECT_NE(full.find("\"live_bytes\":96"), std::string::npos);
+    EXPECT_NE(full.find("\"largest_free\":96"), std::string::npos);
+    EXPECT_NE(full.find("make_\\\"frame\\\""), std::string::npos);
+    EXPECT_EQ(live_delta_json(state.sample(), early, symbols), "");
+
+    TraceBuilder more;
+    more.At(500).Free(0x1000);
+    state.apply(more.Records()[0]);
+    std::string delta = live_delta_json(state.sample(), early, symbols);
+    EXPECT_NE(delta.find("\"full\":false"), std::string::npos);
+    EXPECT_NE(delta.find("\"live_bytes\":32"), std::string::npos);
+    EXPECT_EQ(delta.find("\"peak_bytes\""), std::string::npos); /* unchanged */
+    EXPECT_NE(delta.find("\"order\":[\"s0000000000002000\"]"), std::string::npos);
+
+    /* A late subscriber starts from a full snapshot of the current state */
+    std::string joined = live_delta_json(state.sample(), late, symbols);
+    EXPECT_NE(joined.find("\"peak_bytes\":96"), std::string::npos);
+    EXPECT_EQ(state.space().gaps(), 2u);
+
+    state.reset();
+    EXPECT_EQ(state.replay().records(), 0u);
+}
+
+TEST(HeapInstAnalyzerTest, LiveStateStartsOverOnRestart)
+{
+    TraceBuilder trace;
+    trace.Init(0x1000, 0x100).At(5000000).Malloc(0x40, 0x1000).Malloc(0x40, 0x1040).Malloc(0x40, 0x1080);
+    /* Rebooted: the clock starts over and this INIT carries no heap info */
+    trace.At(100).Init().Malloc(0x10, 0x2000);
+    live_state state;
+    for (const record& rec : trace.Records()) {
+        state.apply(rec);
+    }
+
+    live_sample sample = state.sample();
+    auto value = [&](const char* name) -> std::optional<double> {
+        for (const auto& [key, v] : sample.values) {
+            if (std::strcmp(key, name) == 0) {
+                return v;
+            }
+        }
+        return std::nullopt;
+    };
+    EXPECT_EQ(value("live_bytes"), 16.0);
+    EXPECT_EQ(value("alloc_rate"), 1.0); /* per second over the 1 s window */
+    EXPECT_EQ(value("byte_rate"), 16.0);
+    EXPECT_FALSE(state.region_known());
+    EXPECT_FALSE(value("heap_size").has_value());
+}
+
+TEST(HeapInstAnalyzerTest, ReceiverDecodesFramesAndCountsLoss)
+{
+    TraceBuilder trace;
+    trace.Init(0x1000, 0x100);
+    for (int i = 0; i < 6; i++) {
+        trace.Malloc(0x10, 0x1000 + 0x10 * i, 0x2000);
+    }
+    const std::vector<record>& records = trace.Records();
+
+    std::vector<std::pair<uint16_t, uint32_t>> seen;
+    frame_decoder decoder([&](const heap_inst_frame_header_t& header, const record*, size_t count) {
+        seen.emplace_back(header.device_id, header.sequence);
+        EXPECT_EQ(count, 2u);
+    });
+
+    /* Stream: garbage, a frame, a corrupted frame, a frame split across reads */
+    std::vector<uint8_t> stream = {0x00, 0x48, 0x50};
+    std::vector<uint8_t> good = encode_frame(7, 0, records.data(), 2);
+    std::vector<uint8_t> bad = encode_frame(7, 1, records.data() + 2, 2);
+    bad.back() ^= 0x01;
+    std::vector<uint8_t> last = encode_frame(7, 2, records.data() + 4, 2);
+    stream.insert(stream.end(), good.begin(), good.end());
+    stream.insert(stream.end(), bad.begin(), bad.end());
+    stream.insert(stream.end(), last.begin(), last.end());
+    decoder.feed_stream(stream.data(), stream.size() - 5);
+    decoder.feed_stream(stream.data() + stream.size() - 5, 5);
+    ASSERT_EQ(seen.size(), 2u);
+    EXPECT_EQ(seen[1].second, 2u);
+    EXPECT_EQ(decoder.counters().crc_errors, 1u);
+    EXPECT_EQ(decoder.counters().resync_bytes, 3u + bad.size());
+
+    /* Datagrams must hold exactly one frame */
+    decoder.feed_datagram(good.data(), good.size() - 1);
+    decoder.feed_datagram(good.data(), good.size());
+    EXPECT_EQ(decoder.counters().malformed, 1u);
+    EXPECT_EQ(seen.size(), 3u);
+
+    std::filesystem::path dir = std::filesystem::path(::testing::TempDir()) / "receiver";
+    std::filesystem::remove_all(dir);
+    receiver_options options;
+    options.directory = dir.string();
+    options.segment_bytes = 4 * sizeof(record);
+    options.reorder_frames = 1;
+    {
+        trace_receiver receiver(options);
+        auto send = [&](uint16_t device, uint32_t seq, size_t first) {
+            std::vector<uint8_t> frame = encode_frame(device, seq, records.data() + first, 2);
+            heap_inst_frame_header_t header;
+            std::memcpy(&header, frame.data(), sizeof(header));
+            receiver.on_frame(header, records.data() + first, 2);
+        };
+        send(1, 10, 0);
+        send(1, 12, 2);
+        send(1, 11, 4); /* reordered pair: both written in sequence */
+        send(1, 15, 1);
+        send(1, 16, 3); /* buffer full: 13 and 14 lost */
+        EXPECT_EQ(receiver.counters()[1].lost_frames, 2u);
+        send(1, 14, 5); /* late after all: dropped, no longer lost */
+        send(1, 14, 5); /* duplicates */
+        send(1, 16, 3);
+        send(1, 1, 2); /* device rebooted and frame 0 was lost */
+        send(1, 2, 4);
+        send(2, 0, 0);
+        send(2, 1, 2);
+        send(2, 5, 0); /* INIT-led: rebooted into sequence 5, nothing lost */
+        send(2, 6, 4);
+        send(2, 7, 2);
+
+        auto counters = receiver.counters();
+        EXPECT_EQ(counters[1].frames, 7u);
+        EXPECT_EQ(counters[1].records, 14u);
+        EXPECT_EQ(counters[1].lost_frames, 2u);
+        EXPECT_EQ(counters[1].late_frames, 3u);
+        EXPECT_EQ(counters[1].restarts, 1u);
+        EXPECT_EQ(counters[1].segments, 4u);
+        EXPECT_EQ(counters[2].frames, 5u);
+        EXPECT_EQ(counters[2].restarts, 1u);
+        EXPECT_EQ(counters[2].lost_frames, 0u);
+
+        std::ostringstream metrics;
+        receiver.write_metrics(metrics, {{"udp:test", decoder.counters()}});
+        EXPECT_NE(metrics.str().find("heapinst_receiver_lost_frames_total{device=\"0001\"} 2"), std::string::npos);
+        EXPECT_NE(metrics.str().find("heapinst_receiver_crc_errors_total{source=\"udp:test\"} 1"),
+                  std::string::npos);
+    }
+
+    /* Segments hold the raw records; the index has one row per segment */
+    EXPECT_EQ(std::filesystem::file_size(dir / "dev0001" / "000001.bin"), 4 * sizeof(record));
+    EXPECT_EQ(std::filesystem::file_size(dir / "dev0001" / "000002.bin"), 4 * sizeof(record));
+    std::vector<record> first_segment = read_trace((dir / "dev0001" / "000001.bin").string());
+    EXPECT_EQ(first_segment[2].arg2, records[4].arg2); /* frame 11 */
+    std::ifstream index(dir / "dev0001" / "index.csv");
+    std::string header, first, second, third;
+    std::getline(index, header);
+    std::getline(index, first);
+    std::getline(index, second);
+    std::getline(index, third);
+    EXPECT_EQ(first.rfind("000001.bin,10,11,4,128,", 0), 0u) << first;
+    EXPECT_EQ(first.substr(first.rfind(',') + 1), "0");
+    EXPECT_EQ(second.rfind("000002.bin,12,15,4,128,", 0), 0u) << second;
+    EXPECT_EQ(second.substr(second.rfind(',') + 1), "2");
+    EXPECT_EQ(third.rfind("000003.bin,16,1,4,128,", 0), 0u) << third;
+    EXPECT_EQ(third.substr(third.rfind(',') + 1), "1");
+
+    /* A new run continues the numbering */
+    {
+        trace_receiver receiver(options);
+        heap_inst_frame_header_t frame{HEAP_INST_FRAME_MAGIC, 1, 2, 0, 0};
+        receiver.on_frame(frame, records.data(), 2);
+    }
+    EXPECT_TRUE(std::filesystem::exists(dir / "dev0001" / "000005.bin"));
+    std::filesystem::remove_all(dir);
+}
+
+#ifdef HEAPINST_TEST_UDP_PORT
+TEST(HeapInstAnalyzerTest, UdpStreamPortFramesDecodeOnLoopback)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(sock, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    ASSERT_EQ(bind(sock, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(getsockname(sock, reinterpret_cast<sockaddr*>(&addr), &addr_len), 0);
+    std::string target = "127.0.0.1:" + std::to_string(ntohs(addr.sin_port));
+    setenv("HEAPINST_UDP_TARGET", target.c_str(), 1);
+    setenv("HEAPINST_DEVICE_ID", "0x42", 1);
+
+    /* More than one frame's worth, written in uneven pieces */
+    TraceBuilder trace;
+    trace.Init();
+    for (int i = 0; i < 100; i++) {
+        trace.Malloc(0x10, 0x1000 + 0x10 * i);
+    }
+    const std::vector<record>& records = trace.Records();
+    ASSERT_EQ(heapInstStreamPort_Init(), 0);
+    size_t written = 0;
+    for (size_t piece : {1u, 40u, 3u}) {
+        ASSERT_EQ(heapInstStreamPort_Write(records.data() + written, piece * sizeof(record)),
+                  static_cast<int>(piece * sizeof(record)));
+        written += piece;
+    }
+    ASSERT_EQ(heapInstStreamPort_Write(records.data() + written, (records.size() - written) * sizeof(record)),
+              static_cast<int>((records.size() - written) * sizeof(record)));
+    ASSERT_EQ(heapInstStreamPort_Flush(), 0);
+    ASSERT_EQ(heapInstStreamPort_Close(), 0);
+    unsetenv("HEAPINST_UDP_TARGET");
+    unsetenv("HEAPINST_DEVICE_ID");
+
+    std::vector<record> received;
+    std::vector<uint32_t> sequences;
+    frame_decoder decoder([&](const heap_inst_frame_header_t& header, const record* frame, size_t count) {
+        EXPECT_EQ(header.device_id, 0x42);
+        sequences.push_back(header.sequence);
+        received.insert(received.end(), frame, frame + count);
+    });
+    std::vector<uint8_t> datagram(65536);
+    for (;;) {
+        ssize_t n = recv(sock, datagram.data(), datagram.size(), MSG_DONTWAIT);
+        if (n <= 0) {
+            break;
+        }
+        decoder.feed_datagram(datagram.data(), static_cast<size_t>(n));
+    }
+    close(sock);
+
+    EXPECT_EQ(decoder.counters().crc_errors, 0u);
+    EXPECT_EQ(decoder.counters().malformed, 0u);
+    ASSERT_EQ(sequences.size(), 3u);
+    EXPECT_EQ(sequences, (std::vector<uint32_t>{0, 1, 2}));
+    ASSERT_EQ(received.size(), records.size());
+    EXPECT_EQ(std::memcmp(received.data(), records.data(), records.size() * sizeof(record)), 0);
+}
+#endif
+
+TEST(HeapInstAnalyzerTest, MergeOrdersSourcesOnSyncedClock)
+{
+    /* Core 0 and core 1 with unrelated clocks, synced to one reference */
+    TraceBuilder core0, core1, device;
+    core0.At(1000).Sync(5000).Malloc(0x10, 0xa0).Malloc(0x10, 0xa1).Mark(1);
+    core1.At(200).Sync(5000).At(215).Malloc(0x10, 0xb1).At(205).Malloc(0x10, 0xb0).At(240).Free(0xb0);
+    device.At(5125).Malloc(0x10, 0xc0); /* no sync: fixed offset */
+
+    auto run = [&](uint64_t window, std::vector<record>& out) {
+        std::vector<std::unique_ptr<record_source>> inputs;
+        for (const TraceBuilder* t : {&core0, &core1, &device}) {
+            inputs.push_back(std::make_unique<memory_source>(t->Records()));
+        }
+        merge_options options;
+        options.window_us = window;
+        options.offsets_us = {0, 0, -100};
+        merge_source merged(std::move(inputs), options);
+        for (record rec; merged.next(rec);) {
+            out.push_back(rec);
+        }
+        return merged.stats();
+    };
+
+    std::vector<record> merged;
+    auto stats = run(20, merged);
+    const std::vector<std::pair<uint64_t, uint32_t>> expected = {
+        {5000, 0}, {5000, 0}, {5005, 0xb0}, {5010, 0xa0}, {5015, 0xb1},
+        {5020, 0xa1}, {5025, 0xc0}, {5030, 1}, {5040, 0xb0},
+    };
+    ASSERT_EQ(merged.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        EXPECT_EQ(merged[i].timestamp_us, expected[i].first) << i;
+        uint32_t id = merged[i].operation == HEAP_OP_MALLOC ? merged[i].arg2 : merged[i].arg1;
+        if (merged[i].operation != HEAP_OP_TIME_SYNC) {
+            EXPECT_EQ(id, expected[i].second) << i;
+        }
+    }
+    EXPECT_EQ(merged[0].operation, HEAP_OP_TIME_SYNC);
+    EXPECT_EQ(stats[0].offset_us, 4000);
+    EXPECT_EQ(stats[1].offset_us, 4800);
+    EXPECT_EQ(stats[1].syncs, 1u);
+    EXPECT_EQ(stats[1].late, 0u);
+
+    /* Without a window the out-of-order record is late: clamped, still ordered */
+    std::vector<record> strict;
+    stats = run(0, strict);
+    ASSERT_EQ(strict.size(), expected.size());
+    EXPECT_EQ(stats[1].late, 1u);
+    EXPECT_TRUE(std::is_sorted(strict.begin(), strict.end(),
+                               [](const record& a, const record& b) { return a.timestamp_us < b.timestamp_us; }));
+
+    /* The merged trace replays like any other */
+    memory_source source(merged);
+    heap_replay replay;
+    for (record rec; source.next(rec);) {
+        replay.apply(rec);
+    }
+    EXPECT_EQ(replay.live_objects(), 4u);
+}
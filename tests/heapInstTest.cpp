@@ -1,10 +1,18 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cstring>
 #include <cstdint>
+#include <map>
+#include <memory_resource>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "heapInst/heapInstAllocator.hpp"
+#include "heapInst/heapInstResource.hpp"
+#include "heapInst/heapInstSite.h"
+
 extern "C" {
 #include "heapInst/heapInst.h"
 #include "heapInstStream.h"
@@ -69,8 +77,10 @@ class HeapInstTest : public ::testing::Test
         test_reset_stream_buffer();
     }
 
-    // Helper to get records from the stream buffer
-    std::vector<heap_inst_record_t> GetStreamRecords()
+    // Helper to get records from the stream buffer. MEMMAP records follow
+    // every INIT (HEAPINST_CFG_MEMMAP) and are dropped unless asked for, so
+    // tests can count records from INIT.
+    std::vector<heap_inst_record_t> GetStreamRecords(bool with_memmap = false)
     {
         const uint8_t* buf = test_get_stream_buffer();
         size_t size = test_get_stream_buffer_size();
@@ -80,6 +90,11 @@ class HeapInstTest : public ::testing::Test
         if (num_records > 0) {
             std::memcpy(records.data(), buf, num_records * sizeof(heap_inst_record_t));
         }
+        if (!with_memmap) {
+            records.erase(std::remove_if(records.begin(), records.end(),
+                                         [](const heap_inst_record_t& r) { return r.operation == HEAP_OP_MEMMAP; }),
+                          records.end());
+        }
         return records;
     }
 };
@@ -90,16 +105,40 @@ TEST_F(HeapInstTest, InitAddsSingleRecord)
 {
     heap_inst_init(nullptr);
     EXPECT_TRUE(heap_inst_is_initialized());
-    EXPECT_EQ(heap_inst_get_buffer_count(), 1u);
+    size_t buffered = heap_inst_get_buffer_count();
 
     heap_inst_flush();
 
+    // Besides INIT only the memory map is recorded
+    EXPECT_EQ(buffered, GetStreamRecords(true).size());
     auto records = GetStreamRecords();
     ASSERT_EQ(records.size(), 1u);
     EXPECT_EQ(records[0].operation, HEAP_OP_INIT);
     EXPECT_EQ(records[0].timestamp_us, 100u);
 }
 
+TEST_F(HeapInstTest, MemmapRecordsFollowInit)
+{
+    heap_inst_init(nullptr);
+    heap_inst_flush();
+
+    auto records = GetStreamRecords(true);
+    ASSERT_GE(records.size(), 4u);
+    EXPECT_EQ(records[0].operation, HEAP_OP_INIT);
+
+    std::map<uint32_t, const heap_inst_record_t*> regions;
+    for (size_t i = 1; i < records.size(); i++) {
+        ASSERT_EQ(records[i].operation, HEAP_OP_MEMMAP) << i;
+        EXPECT_EQ(records[i].timestamp_us, records[0].timestamp_us);
+        regions[records[i].arg1] = &records[i];
+    }
+    for (uint32_t region : {HEAP_MEMMAP_HEAP, HEAP_MEMMAP_STACK, HEAP_MEMMAP_DATA}) {
+        ASSERT_EQ(regions.count(region), 1u) << "region " << region;
+        EXPECT_NE(regions[region]->arg2, 0u) << "region " << region;
+        EXPECT_NE(regions[region]->arg3, 0u) << "region " << region;
+    }
+}
+
 TEST_F(HeapInstTest, RecordsMallocAndFree)
 {
     heap_inst_init(nullptr);
@@ -147,6 +186,7 @@ TEST_F(HeapInstTest, FallsBackToTextWhenStreamportFails)
     heap_inst_init(nullptr);
     void* ptr = malloc(8);
     (void)ptr;
+    heap_inst_time_sync(0x123456789ull);
     heap_inst_flush();
 
     // Stream buffer should be empty (all writes failed)
@@ -159,6 +199,8 @@ TEST_F(HeapInstTest, FallsBackToTextWhenStreamportFails)
     ASSERT_NE(log_.buffer.find("OP:1"), std::string::npos)  // HEAP_OP_MALLOC
         << "log buffer:\n"
         << log_.buffer;
+    // The reference clock survives the fallback
+    EXPECT_NE(log_.buffer.find(",REF:4886718345"), std::string::npos) << log_.buffer;
     EXPECT_EQ(heap_inst_get_buffer_count(), 0u);
 }
 
@@ -202,3 +244,452 @@ TEST_F(HeapInstTest, TimestampsIncrement)
     EXPECT_EQ(records[1].timestamp_us, 101u);
     EXPECT_EQ(records[2].timestamp_us, 102u);
 }
+
+TEST_F(HeapInstTest, RecordsSbrk)
+{
+    heap_inst_init(nullptr);
+    heap_inst_record_sbrk(4096, reinterpret_cast<void*>(0x20001000), 0);
+    heap_inst_record_sbrk(-1024, reinterpret_cast<void*>(0x20002000), HEAP_SBRK_FLAG_OBSERVED);
+    heap_inst_record_sbrk(8192, reinterpret_cast<void*>(-1), 0);
+    heap_inst_flush();
+
+    auto records = GetStreamRecords();
+    ASSERT_EQ(records.size(), 4u);
+
+    EXPECT_EQ(records[1].operation, HEAP_OP_SBRK);
+    EXPECT_EQ(static_cast<int32_t>(records[1].arg1), 4096);
+    EXPECT_EQ(records[1].arg2, 0x20002000u);
+    EXPECT_EQ(records[1].arg3, 0u);
+
+    EXPECT_EQ(static_cast<int32_t>(records[2].arg1), -1024);
+    EXPECT_EQ(records[2].arg2, 0x20001C00u);
+    EXPECT_EQ(records[2].arg3, static_cast<uint32_t>(HEAP_SBRK_FLAG_OBSERVED));
+
+    EXPECT_EQ(records[3].arg2, 0u);
+    EXPECT_EQ(records[3].arg3, static_cast<uint32_t>(HEAP_SBRK_FLAG_FAILED));
+}
+
+TEST_F(HeapInstTest, StackHighWaterMark)
+{
+    static uint32_t fake_stack[64];
+    heap_inst_stack_info_t info = {fake_stack, sizeof(fake_stack)};
+    ASSERT_EQ(heap_inst_stack_register(1, &info), 0);
+    EXPECT_EQ(fake_stack[0], 0xA5A5A5A5u);
+    EXPECT_EQ(fake_stack[63], 0xA5A5A5A5u);
+
+    heap_inst_init(nullptr);
+
+    // Simulate 40 bytes of stack use growing down from the top
+    for (size_t i = 54; i < 64; ++i) {
+        fake_stack[i] = 0;
+    }
+    heap_inst_stack_sample();
+    heap_inst_flush();
+
+    auto records = GetStreamRecords();
+    ASSERT_EQ(records.size(), 3u);
+
+    // Initial sample emitted by heap_inst_init()
+    EXPECT_EQ(records[1].operation, HEAP_OP_STACK_HWM);
+    EXPECT_EQ(records[1].arg1, 1u);
+    EXPECT_EQ(records[1].arg2, 0u);
+    EXPECT_EQ(records[1].arg3, sizeof(fake_stack));
+    EXPECT_EQ(records[1].timestamp_us, 101u);
+
+    EXPECT_EQ(records[2].operation, HEAP_OP_STACK_HWM);
+    EXPECT_EQ(records[2].arg2, 40u);
+    EXPECT_EQ(records[2].timestamp_us, 102u);
+}
+
+TEST_F(HeapInstTest, StackRegisterRejectsInvalidId)
+{
+    static uint32_t fake_stack[16];
+    heap_inst_stack_info_t info = {fake_stack, sizeof(fake_stack)};
+    EXPECT_EQ(heap_inst_stack_register(200, &info), -1);
+    EXPECT_EQ(heap_inst_stack_register(0, nullptr), -1);
+}
+
+TEST_F(HeapInstTest, RecordsUsableSize)
+{
+    heap_inst_init(nullptr);
+    void* ptr = malloc(13);
+    ASSERT_NE(ptr, nullptr);
+    void* grown = realloc(ptr, 100);
+    ASSERT_NE(grown, nullptr);
+    free(grown);
+    heap_inst_flush();
+
+    auto records = GetStreamRecords();
+    ASSERT_EQ(records.size(), 4u);
+
+    EXPECT_EQ(records[1].operation, HEAP_OP_MALLOC);
+    EXPECT_TRUE(records[1].flags & HEAP_RECORD_FLAG_USABLE_SIZE);
+    EXPECT_GE(records[1].arg4, 13u);
+
+    EXPECT_EQ(records[2].operation, HEAP_OP_REALLOC);
+    EXPECT_TRUE(records[2].flags & HEAP_RECORD_FLAG_USABLE_SIZE);
+    EXPECT_GE(records[2].arg4, 100u);
+
+    EXPECT_EQ(records[3].flags, 0u);
+}
+
+TEST_F(HeapInstTest, RecordsRssSample)
+{
+    EXPECT_EQ(heap_inst_rss_sample(), -1);  // not initialized yet
+
+    heap_inst_init(nullptr);
+    ASSERT_EQ(heap_inst_rss_sample(), 0);
+    heap_inst_flush();
+
+    auto records = GetStreamRecords();
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[1].operation, HEAP_OP_RSS);
+    EXPECT_GT(records[1].arg1, 0u);
+    EXPECT_LE(records[1].arg2, records[1].arg1);
+    EXPECT_GT(records[1].arg3, 0u);
+}
+
+TEST_F(HeapInstTest, RssSamplerStartStop)
+{
+    heap_inst_init(nullptr);
+    EXPECT_EQ(heap_inst_rss_sampler_start(0), -1);
+    ASSERT_EQ(heap_inst_rss_sampler_start(1000), 0);
+    EXPECT_EQ(heap_inst_rss_sampler_start(1000), -1);  // already running
+    heap_inst_rss_sampler_stop();
+    heap_inst_rss_sampler_stop();  // no-op
+}
+
+TEST_F(HeapInstTest, RecordsCallsite)
+{
+    heap_inst_init(nullptr);
+    void* ptr = malloc(8);
+    free(ptr);
+    heap_inst_flush();
+
+    auto records = GetStreamRecords();
+    ASSERT_EQ(records.size(), 3u);
+    EXPECT_EQ(records[0].site, 0u);
+    EXPECT_NE(records[1].site, 0u);
+    EXPECT_NE(records[2].site, 0u);
+    EXPECT_NE(records[1].site, records[2].site);
+}
+
+TEST_F(HeapInstTest, RecordsSourceSiteIds)
+{
+    heap_inst_init(nullptr);
+    const uint32_t malloc_site = HEAPINST_SITE_ID; void* ptr = HEAPINST_MALLOC(16);
+    const uint32_t free_site = HEAPINST_SITE_ID; HEAPINST_FREE(ptr);
+    void* plain = malloc(8);
+    free(plain);
+    heap_inst_flush();
+
+    auto records = GetStreamRecords();
+    ASSERT_EQ(records.size(), 5u);
+    EXPECT_NE(HEAPINST_FILE_ID, 0);
+    EXPECT_EQ(HEAPINST_SITE_FILE(malloc_site), HEAPINST_FILE_ID);
+    EXPECT_EQ(records[1].operation, HEAP_OP_MALLOC);
+    EXPECT_EQ(records[1].site, malloc_site);
+    EXPECT_TRUE(records[1].flags & HEAP_RECORD_FLAG_SITE_ID);
+    EXPECT_EQ(records[2].operation, HEAP_OP_FREE);
+    EXPECT_EQ(records[2].site, free_site);
+    EXPECT_TRUE(records[2].flags & HEAP_RECORD_FLAG_SITE_ID);
+    // Plain calls keep recording return addresses
+    EXPECT_FALSE(records[3].flags & HEAP_RECORD_FLAG_SITE_ID);
+    EXPECT_FALSE(records[4].flags & HEAP_RECORD_FLAG_SITE_ID);
+}
+
+TEST_F(HeapInstTest, RecordsMarker)
+{
+    heap_inst_init(nullptr);
+    heap_inst_mark(42);
+    heap_inst_flush();
+
+    auto records = GetStreamRecords();
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[1].operation, HEAP_OP_MARKER);
+    EXPECT_EQ(records[1].arg1, 42u);
+    EXPECT_EQ(records[1].timestamp_us, 101u);
+}
+
+TEST_F(HeapInstTest, RecordsTimeSync)
+{
+    heap_inst_init(nullptr);
+    heap_inst_time_sync(0x123456789ull);
+    heap_inst_flush();
+
+    auto records = GetStreamRecords();
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[1].operation, HEAP_OP_TIME_SYNC);
+    EXPECT_EQ(records[1].timestamp_us, 101u);
+    EXPECT_EQ(records[1].arg1, 0x23456789u);
+    EXPECT_EQ(records[1].arg2, 0x1u);
+}
+
+TEST_F(HeapInstTest, TopKTracksHeaviestCallsite)
+{
+    heap_inst_init(nullptr);
+    heap_inst_topk_reset();
+
+    // One hot callsite plus a spread of one-off callsites exceeding the slot count
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 50; ++i) {
+        ptrs.push_back(malloc(10));
+    }
+    for (uintptr_t i = 1; i <= 10; ++i) {
+        heap_inst_record_malloc(4, nullptr, 0, reinterpret_cast<void*>(0x1000 * i));
+    }
+
+    heap_inst_topk_entry_t entries[8];
+    size_t n = heap_inst_topk_get(entries, 8);
+    ASSERT_EQ(n, 4u);
+    EXPECT_GE(entries[0].count, 50u);
+    EXPECT_GE(entries[0].bytes, 500u);
+    EXPECT_EQ(entries[0].error, 0u);
+    for (size_t i = 1; i < n; ++i) {
+        EXPECT_LE(entries[i].count, entries[i - 1].count);
+    }
+    uintptr_t hot_site = entries[0].site;
+
+    for (void* p : ptrs) {
+        free(p);
+    }
+    heap_inst_flush();
+    test_reset_stream_buffer();
+
+    heap_inst_topk_dump();
+    heap_inst_flush();
+    auto records = GetStreamRecords();
+    ASSERT_EQ(records.size(), 4u);
+    EXPECT_EQ(records[0].operation, HEAP_OP_TOPK);
+    EXPECT_EQ(records[0].site, static_cast<uint32_t>(hot_site));
+    EXPECT_EQ(records[0].arg4, 0u);
+    EXPECT_EQ(records[3].arg4, 3u);
+}
+
+TEST_F(HeapInstTest, TopKKeepsSiteIdsApartFromReturnAddresses)
+{
+    heap_inst_init(nullptr);
+    heap_inst_topk_reset();
+
+    // A source-location id numerically equal to a return address
+    void* a = heap_inst_malloc_site(8, 0x1234);
+    void* b = heap_inst_malloc_site(8, 0x1234);
+    heap_inst_record_malloc(16, nullptr, 0, reinterpret_cast<void*>(0x1234));
+
+    heap_inst_topk_entry_t entries[8];
+    ASSERT_EQ(heap_inst_topk_get(entries, 8), 2u);
+    EXPECT_EQ(entries[0].site, 0x1234u);
+    EXPECT_EQ(entries[0].count, 2u);
+    EXPECT_EQ(entries[0].flags, HEAP_RECORD_FLAG_SITE_ID);
+    EXPECT_EQ(entries[1].site, 0x1234u);
+    EXPECT_EQ(entries[1].count, 1u);
+    EXPECT_EQ(entries[1].flags, 0u);
+
+    heap_inst_flush();
+    test_reset_stream_buffer();
+    heap_inst_topk_dump();
+    heap_inst_flush();
+    auto records = GetStreamRecords();
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].operation, HEAP_OP_TOPK);
+    EXPECT_TRUE(records[0].flags & HEAP_RECORD_FLAG_SITE_ID);
+    EXPECT_FALSE(records[1].flags & HEAP_RECORD_FLAG_SITE_ID);
+
+    heap_inst_free_site(a, 0x1234);
+    heap_inst_free_site(b, 0x1234);
+}
+
+namespace
+{
+
+struct DiffCollector {
+    std::vector<heap_inst_diff_entry_t> entries;
+    static void Collect(const heap_inst_diff_entry_t* entry, void* ctx)
+    {
+        static_cast<DiffCollector*>(ctx)->entries.push_back(*entry);
+    }
+};
+
+}  // namespace
+
+TEST_F(HeapInstTest, DiffReportsOnlyLeaksSinceCheckpoint)
+{
+    heap_inst_init(nullptr);
+    void* before = malloc(64);
+    void* resized = malloc(8);
+
+    heap_inst_checkpoint_t cp = heap_inst_checkpoint();
+    EXPECT_EQ(heap_inst_diff(cp, HEAP_INST_DIFF_BY_SITE, nullptr, nullptr), 0u);
+
+    void* temporary = malloc(32);
+    void* leaked = malloc(48);
+    resized = realloc(resized, 128);  // pre-checkpoint block, not a new leak
+    free(temporary);
+
+    DiffCollector collector;
+    EXPECT_EQ(heap_inst_diff(cp, HEAP_INST_DIFF_BY_SITE, &DiffCollector::Collect, &collector), 1u);
+    ASSERT_EQ(collector.entries.size(), 1u);
+    EXPECT_EQ(collector.entries[0].count, 1u);
+    EXPECT_EQ(collector.entries[0].bytes, 48u);
+    EXPECT_NE(collector.entries[0].key, 0u);
+
+    free(leaked);
+    EXPECT_EQ(heap_inst_diff(cp, HEAP_INST_DIFF_BY_SITE, nullptr, nullptr), 0u);
+    EXPECT_FALSE(heap_inst_live_overflowed());
+
+    free(resized);
+    free(before);
+}
+
+TEST_F(HeapInstTest, DiffKeepsSiteIdsApartFromReturnAddresses)
+{
+    heap_inst_init(nullptr);
+    heap_inst_checkpoint_t cp = heap_inst_checkpoint();
+
+    void* by_id = heap_inst_malloc_site(8, 0x1234);
+    void* fake = reinterpret_cast<void*>(0x5000);
+    heap_inst_record_malloc(16, fake, 0, reinterpret_cast<void*>(0x1234));
+
+    DiffCollector collector;
+    EXPECT_EQ(heap_inst_diff(cp, HEAP_INST_DIFF_BY_SITE, &DiffCollector::Collect, &collector), 2u);
+    ASSERT_EQ(collector.entries.size(), 2u);
+    EXPECT_EQ(collector.entries[0].key, collector.entries[1].key);
+    EXPECT_NE(collector.entries[0].flags, collector.entries[1].flags);
+
+    heap_inst_record_free(fake, nullptr);
+    heap_inst_free_site(by_id, 0x1234);
+}
+
+TEST_F(HeapInstTest, DiffGroupsByTag)
+{
+    heap_inst_init(nullptr);
+    heap_inst_checkpoint_t cp = heap_inst_checkpoint();
+
+    std::vector<void*> ptrs;
+    for (uint16_t tag = 1; tag <= 3; ++tag) {
+        uint16_t previous = heap_inst_set_tag(tag);
+        ptrs.push_back(malloc(10u * tag));
+        ptrs.push_back(malloc(10u * tag));
+        heap_inst_set_tag(previous);
+    }
+    EXPECT_EQ(heap_inst_get_tag(), 0u);
+
+    DiffCollector collector;
+    EXPECT_EQ(heap_inst_diff(cp, HEAP_INST_DIFF_BY_TAG, &DiffCollector::Collect, &collector), 6u);
+
+    // HEAPINST_CFG_DIFF_MAX_GROUPS=2 in tests: the third tag folds into OTHER
+    ASSERT_EQ(collector.entries.size(), 3u);
+    size_t bytes = 0;
+    for (const auto& e : collector.entries) {
+        EXPECT_EQ(e.count, 2u);
+        bytes += e.bytes;
+    }
+    EXPECT_EQ(bytes, 120u);
+    EXPECT_EQ(collector.entries[2].key, HEAP_INST_DIFF_KEY_OTHER);
+
+    for (void* p : ptrs) {
+        free(p);
+    }
+}
+
+TEST_F(HeapInstTest, LiveTableSurvivesChurn)
+{
+    heap_inst_init(nullptr);
+    size_t baseline = heap_inst_live_get_count();
+
+    // Interleaved alloc/free exercises probing and backward-shift deletion
+    void* ptrs[40] = {};
+    size_t live = 0;
+    for (int round = 0; round < 20; ++round) {
+        for (size_t i = 0; i < 40; ++i) {
+            if (ptrs[i] == nullptr) {
+                ptrs[i] = malloc(16);
+                live++;
+            }
+        }
+        for (size_t i = round % 3; i < 40; i += 3) {
+            free(ptrs[i]);
+            ptrs[i] = nullptr;
+            live--;
+        }
+        ASSERT_EQ(heap_inst_live_get_count(), baseline + live);
+    }
+    for (void* p : ptrs) {
+        free(p);
+    }
+    EXPECT_EQ(heap_inst_live_get_count(), baseline);
+    EXPECT_FALSE(heap_inst_live_overflowed());
+}
+
+TEST_F(HeapInstTest, TrackingAllocatorTagsContainerAllocations)
+{
+    heap_inst_init(nullptr);
+    heap_inst_checkpoint_t cp = heap_inst_checkpoint();
+    {
+        std::vector<uint32_t, heapinst::tracking_allocator<uint32_t, 7>> vec;
+        for (uint32_t i = 0; i < 5; ++i) {
+            vec.push_back(i);
+        }
+
+        std::map<int, int, std::less<int>,
+                 heapinst::tracking_allocator<std::pair<const int, int>, 8>> map;
+        map[1] = 1;
+        map[2] = 2;
+
+        std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+                           heapinst::tracking_allocator<std::pair<const int, int>, 9>> umap;
+        umap[1] = 1;
+
+        DiffCollector collector;
+        EXPECT_GT(heap_inst_diff(cp, HEAP_INST_DIFF_BY_TAG, &DiffCollector::Collect, &collector), 0u);
+        // Only tagged container storage is live (third tag folds into OTHER in tests)
+        for (const auto& e : collector.entries) {
+            EXPECT_TRUE(e.key == 7 || e.key == 8 || e.key == 9 || e.key == HEAP_INST_DIFF_KEY_OTHER)
+                << "key " << e.key;
+        }
+    }
+    EXPECT_EQ(heap_inst_get_tag(), 0u);
+    EXPECT_EQ(heap_inst_diff(cp, HEAP_INST_DIFF_BY_TAG, nullptr, nullptr), 0u);
+
+    heap_inst_flush();
+    auto records = GetStreamRecords();
+    size_t vector_allocs = 0;
+    for (const auto& rec : records) {
+        if (rec.tag == 7 && rec.operation == HEAP_OP_MALLOC) {
+            vector_allocs++;
+        }
+    }
+    // Growth 1 -> 2 -> 4 -> 8 elements
+    EXPECT_EQ(vector_allocs, 4u);
+}
+
+TEST_F(HeapInstTest, TracedResourceRecordsPmrAllocations)
+{
+    heap_inst_init(nullptr);
+
+    alignas(std::max_align_t) static unsigned char arena_buffer[1024];
+    std::pmr::monotonic_buffer_resource arena(arena_buffer, sizeof(arena_buffer),
+                                              std::pmr::null_memory_resource());
+    heapinst::traced_resource traced(3, &arena);
+    {
+        std::pmr::vector<uint64_t> values(&traced);
+        values.reserve(4);
+        values.push_back(1);
+    }
+    heap_inst_flush();
+
+    auto records = GetStreamRecords();
+    ASSERT_EQ(records.size(), 3u);
+
+    EXPECT_EQ(records[1].operation, HEAP_OP_RESOURCE_ALLOC);
+    EXPECT_EQ(records[1].tag, 3u);
+    EXPECT_EQ(records[1].arg1, 4 * sizeof(uint64_t));
+    EXPECT_EQ(records[1].arg3, alignof(uint64_t));
+    uintptr_t ptr = static_cast<uint32_t>(records[1].arg2);
+    EXPECT_EQ(ptr, static_cast<uint32_t>(reinterpret_cast<uintptr_t>(arena_buffer)));
+
+    EXPECT_EQ(records[2].operation, HEAP_OP_RESOURCE_FREE);
+    EXPECT_EQ(records[2].tag, 3u);
+    EXPECT_EQ(records[2].arg1, records[1].arg2);
+    EXPECT_EQ(records[2].arg2, records[1].arg1);
+}
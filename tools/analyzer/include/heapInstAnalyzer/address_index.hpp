@@ -0,0 +1,104 @@
+/**
+ * @file address_index.hpp
+ * @brief "What was at address X at time T": an index over
+ * (address range x lifetime) of every heap block in a trace.
+ *
+ * Time is measured in trace positions: position p is the state after the
+ * first p records, so a block allocated by record i and freed by record j
+ * is live for positions i+1 .. j. trace_points (timestamps, markers) map
+ * onto positions with position_of().
+ *
+ * The index is a segment tree over the compressed block boundaries. Each
+ * block is stored in the O(log n) nodes that exactly cover its range, and
+ * blocks sharing a node share addresses, so they can never be live
+ * together (a block whose free was lost ends when an overlapping block is
+ * allocated). Each node's blocks are therefore sorted by lifetime, and owner,
+ * previous and next owner queries are a binary search per node on one
+ * root-to-leaf path: O(log^2 n). Range queries additionally visit the nodes
+ * inside the address range. Memory is O(n log n) block ids.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "heapInstAnalyzer/replay.hpp"
+#include "heapInstAnalyzer/trace.hpp"
+
+namespace heapinst::analyzer
+{
+
+struct block_lifetime {
+    static constexpr uint64_t kLive = UINT64_MAX;
+
+    uint32_t address = 0;
+    uint32_t size = 0;
+    uint64_t since = 0; /* first position the block is live at */
+    uint64_t until = 0; /* first position it is no longer live at, or kLive */
+    uint64_t alloc_us = 0;
+    uint64_t free_us = 0;
+    callsite site;
+    uint16_t tag = 0;
+
+    uint64_t end() const noexcept { return static_cast<uint64_t>(address) + (size ? size : 1); }
+    bool contains(uint64_t addr) const noexcept { return addr >= address && addr < end(); }
+    bool live_at(uint64_t position) const noexcept { return since <= position && position < until; }
+};
+
+class address_index
+{
+   public:
+    static address_index build(record_source& source);
+
+    const std::vector<block_lifetime>& blocks() const noexcept { return blocks_; }
+    uint64_t positions() const noexcept { return positions_; }
+
+    /** @brief Position at a trace point (end, timestamp or marker). */
+    std::optional<uint64_t> position_of(const trace_point& point) const;
+
+    /** @brief Block covering addr at position, if any. */
+    std::optional<block_lifetime> owner_at(uint32_t addr, uint64_t position) const;
+
+    /** @brief Last block covering addr that was freed at or before position. */
+    std::optional<block_lifetime> previous_owner(uint32_t addr, uint64_t position) const;
+
+    /** @brief First block covering addr allocated after position. */
+    std::optional<block_lifetime> next_owner(uint32_t addr, uint64_t position) const;
+
+    /**
+     * @brief Blocks intersecting [addr_lo, addr_hi) that are live at any
+     * position in [from, to], ordered by allocation.
+     */
+    std::vector<block_lifetime> query(uint64_t addr_lo, uint64_t addr_hi, uint64_t from, uint64_t to) const;
+
+   private:
+    /* Leaf index of the elementary interval containing addr */
+    std::optional<size_t> leaf_of(uint64_t addr) const;
+
+    template <class Fn>
+    void for_path(size_t leaf, Fn&& fn) const;
+
+    /* Blocks stored at node (sorted by lifetime) */
+    std::pair<const uint32_t*, const uint32_t*> node_blocks(size_t node) const
+    {
+        return {ids_.data() + offsets_[node], ids_.data() + offsets_[node + 1]};
+    }
+
+    void insert(size_t node, size_t lo, size_t hi, uint64_t a, uint64_t b, uint32_t id, bool count_only);
+
+    std::vector<block_lifetime> blocks_;
+    std::vector<uint64_t> bounds_;  /* sorted unique block boundaries */
+    std::vector<uint64_t> offsets_; /* CSR: node -> range in ids_ */
+    std::vector<uint32_t> ids_;
+    std::vector<uint64_t> cursor_; /* build scratch */
+    std::vector<std::pair<uint64_t, uint64_t>> times_; /* (timestamp, position) of state changes */
+    std::vector<std::pair<uint32_t, uint64_t>> markers_;
+    uint64_t positions_ = 0;
+};
+
+}  // namespace heapinst::analyzer
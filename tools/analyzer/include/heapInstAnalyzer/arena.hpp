@@ -0,0 +1,83 @@
+/**
+ * @file arena.hpp
+ * @brief Allocator arena top against live bytes and stack headroom.
+ *
+ * HEAP_OP_SBRK records (HEAPINST_WRAP_SBRK) give the program break, the top
+ * of the arena the allocator has claimed. analyze_arena() follows it next
+ * to the live bytes requested through malloc, so the gap between them
+ * (allocator overhead and free chunks the arena cannot return) is visible,
+ * and reports the headroom that remains:
+ *
+ *   - to the end of the heap region (INIT heap info or the HEAP MEMMAP
+ *     record; __StackLimit on Pico), where _sbrk starts failing;
+ *   - to the deepest point the core 0 stack has reached (STACK MEMMAP
+ *     region and STACK_HWM records), where the two would collide.
+ *
+ * HEAP_OP_RSS records (Linux hosts, HEAPINST_CFG_RSS_SAMPLER) add the real
+ * footprint next to the requested live bytes: each sample carries the last
+ * resident and anonymous KiB seen, so a trace without SBRK records still
+ * gets a timeline.
+ *
+ * Minimums are taken over every record, not only the kept samples.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "heapInstAnalyzer/trace.hpp"
+
+namespace heapinst::analyzer
+{
+
+struct arena_options {
+    size_t max_samples = 200;
+};
+
+struct arena_sample {
+    uint64_t time_us = 0;
+    uint64_t index = 0;     /* record index */
+    uint64_t brk = 0;       /* program break, 0 before the first SBRK */
+    uint64_t arena = 0;     /* break - arena base */
+    uint64_t live = 0;      /* live bytes requested */
+    int64_t headroom = 0;   /* region end - break, if the region is known */
+    int64_t stack_gap = 0;  /* deepest stack point - break, if known */
+    uint64_t rss_kb = 0;    /* last RSS sample, 0 before the first */
+    uint64_t anon_kb = 0;   /* resident anonymous memory of that sample */
+};
+
+struct arena_report {
+    uint64_t sbrk_calls = 0;
+    uint64_t failed = 0;   /* HEAP_SBRK_FLAG_FAILED */
+    uint64_t observed = 0; /* HEAP_SBRK_FLAG_OBSERVED: polled, not intercepted */
+    uint64_t arena_base = 0;
+    uint64_t region_end = 0; /* 0 = unknown */
+    uint64_t stack_base = 0; /* core 0 stack region, 0 = unknown */
+    uint64_t stack_top = 0;
+    uint64_t stack_hwm = 0;
+    uint64_t rss_samples = 0; /* HEAP_OP_RSS records */
+
+    bool has_headroom = false;
+    bool has_stack_gap = false;
+    arena_sample peak_break;
+    arena_sample min_headroom;
+    arena_sample min_stack_gap;
+    arena_sample peak_rss;
+    arena_sample final;
+
+    /* At most max_samples, evenly thinned */
+    std::vector<arena_sample> timeline;
+};
+
+arena_report analyze_arena(record_source& source, const arena_options& options = {});
+
+void write_arena_report(const arena_report& report, std::ostream& out);
+
+/** @brief Timeline as CSV with a header row; unknown headrooms and RSS are empty. */
+void write_arena_csv(const arena_report& report, std::ostream& out);
+
+}  // namespace heapinst::analyzer
@@ -0,0 +1,146 @@
+/**
+ * @file banks.hpp
+ * @brief SRAM bank occupancy: which banks the heap actually lives in.
+ *
+ * On the RP2350, SRAM0-3 and SRAM4-7 are word-striped across four banks
+ * each, while SRAM8/9 (scratch X/Y) are separate 4 KiB banks. Bank
+ * conflicts with DMA or the other core depend on where blocks land, so
+ * analyze_banks() splits every live block over the banks it touches and
+ * reports per-bank occupancy over time, plus the callsites holding the
+ * most byte-time in each bank. Static regions from MEMMAP records are
+ * counted separately.
+ *
+ * The same records give the RAM budget: .data, .bss, stacks, scratch X/Y
+ * and the heap region as shares of the mapped SRAM, next to the most heap
+ * bytes live at once, with a hint when the heap region is nearly full or
+ * mostly idle.
+ *
+ * A memory map is a text file, one region per line ('#' starts a comment):
+ *
+ *   bank    <name> <base> <size>                 contiguous bank
+ *   striped <base> <size> <stride> <name>...     interleaved every stride bytes
+ *
+ * Regions naming the same bank add up. memory_map::load() also accepts the
+ * built-in maps "pico2" / "rp2350".
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "heapInstAnalyzer/replay.hpp"
+#include "heapInstAnalyzer/symbols.hpp"
+#include "heapInstAnalyzer/trace.hpp"
+
+namespace heapinst::analyzer
+{
+
+struct memory_bank {
+    std::string name;
+    uint64_t capacity = 0;
+};
+
+class memory_map
+{
+   public:
+    /** @throws std::invalid_argument naming the offending line. */
+    static memory_map parse(std::istream& in);
+
+    /** @brief Built-in map by name, else a map file. @throws std::runtime_error */
+    static memory_map load(const std::string& name_or_path);
+
+    /** @brief RP2350 SRAM0-9 (pico2). */
+    static memory_map rp2350();
+
+    void add_bank(const std::string& name, uint64_t base, uint64_t size);
+    void add_striped(uint64_t base, uint64_t size, uint64_t stride, const std::vector<std::string>& names);
+
+    const std::vector<memory_bank>& banks() const noexcept { return banks_; }
+
+    /**
+     * @brief Calls visit(bank, bytes) for every bank [begin, end) touches.
+     * @return Bytes not covered by any bank.
+     */
+    uint64_t split(uint64_t begin, uint64_t end, const std::function<void(size_t, uint64_t)>& visit) const;
+
+   private:
+    struct region {
+        uint64_t base = 0;
+        uint64_t size = 0;
+        uint64_t stride = 0; /* 0 = one contiguous bank */
+        std::vector<size_t> banks;
+    };
+
+    size_t bank_index(const std::string& name);
+    void add_region(region r);
+
+    std::vector<memory_bank> banks_;
+    std::vector<region> regions_; /* sorted by base, non-overlapping */
+};
+
+struct bank_options {
+    size_t top = 5;           /* hot callsites per bank */
+    size_t max_samples = 200; /* timeline length */
+    bool usable_size = true;
+};
+
+struct bank_site {
+    callsite site;
+    double byte_us = 0.0; /* bytes held in the bank x microseconds */
+    uint64_t peak_bytes = 0;
+};
+
+struct bank_usage {
+    uint64_t static_bytes = 0;  /* non-heap MEMMAP regions */
+    uint64_t heap_capacity = 0; /* part of the INIT heap region in this bank */
+    uint64_t live_bytes = 0;    /* at the end of the trace */
+    uint64_t peak_bytes = 0;
+    uint64_t peak_time_us = 0;
+    double mean_bytes = 0.0; /* time-weighted */
+    std::vector<bank_site> hot; /* most byte-time first */
+};
+
+struct bank_sample {
+    uint64_t time_us = 0;
+    std::vector<uint64_t> bytes; /* per bank, then unmapped */
+};
+
+/* Bytes of each MEMMAP region inside the map's banks */
+struct ram_budget {
+    uint64_t sram = 0; /* sum of bank capacities */
+    uint64_t data = 0;
+    uint64_t bss = 0;
+    uint64_t stacks = 0;      /* core 0 and core 1 */
+    uint64_t scratch = 0;     /* .scratch_x and .scratch_y */
+    uint64_t heap_region = 0; /* HEAP memmap, else INIT heap info */
+    uint64_t heap_peak = 0;   /* most heap bytes live at once */
+    uint64_t heap_peak_time_us = 0;
+
+    uint64_t static_bytes() const noexcept { return data + bss + stacks + scratch; }
+};
+
+struct bank_report {
+    std::vector<memory_bank> banks;
+    std::vector<bank_usage> usage;
+    ram_budget budget;
+    uint64_t unmapped_blocks = 0; /* allocations (partly) outside every bank */
+    uint64_t start_us = 0;
+    uint64_t end_us = 0;
+    std::vector<bank_sample> timeline;
+};
+
+bank_report analyze_banks(record_source& source, const memory_map& map, const bank_options& options = {});
+
+void write_bank_report(const bank_report& report, const symbolizer& symbols, std::ostream& out);
+
+/** @brief Timeline as CSV: time_us, one column per bank, unmapped. */
+void write_bank_csv(const bank_report& report, std::ostream& out);
+
+}  // namespace heapinst::analyzer
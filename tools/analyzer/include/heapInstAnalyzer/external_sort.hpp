@@ -0,0 +1,209 @@
+/**
+ * @file external_sort.hpp
+ * @brief Disk-backed sort of fixed-size records for bounded-memory analyses.
+ *
+ * external_sorter<T> buffers up to a fixed number of items, writes each
+ * full buffer as a sorted run to an anonymous temporary file, and replays
+ * everything in order with a k-way merge. Fan-in is capped: with more runs
+ * than max_fan_in, runs are first merged into larger runs. T must be
+ * trivially copyable; runs are raw arrays of T.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <unistd.h>
+
+namespace heapinst::analyzer
+{
+
+using temp_file = std::unique_ptr<std::FILE, int (*)(std::FILE*)>;
+
+/**
+ * @brief Anonymous read/write temporary file in dir (system default if
+ * empty); it disappears when closed.
+ * @throws std::runtime_error
+ */
+inline temp_file open_temp_file(const std::string& dir)
+{
+    std::FILE* file = nullptr;
+    if (dir.empty()) {
+        file = std::tmpfile();
+    } else {
+        std::string pattern = dir + "/heapinst-run-XXXXXX";
+        int fd = ::mkstemp(pattern.data());
+        if (fd >= 0) {
+            ::unlink(pattern.c_str());
+            file = ::fdopen(fd, "w+b");
+            if (file == nullptr) {
+                ::close(fd);
+            }
+        }
+    }
+    if (file == nullptr) {
+        throw std::runtime_error("cannot create temporary file in " + (dir.empty() ? std::string("default temp dir") : dir));
+    }
+    return temp_file(file, &std::fclose);
+}
+
+template <class T, class Compare = std::less<T>>
+class external_sorter
+{
+    static_assert(std::is_trivially_copyable_v<T>, "runs are written as raw bytes");
+
+   public:
+    explicit external_sorter(size_t buffer_items, std::string temp_dir = {}, size_t max_fan_in = 64,
+                             Compare compare = Compare())
+        : buffer_items_(std::max<size_t>(buffer_items, 1)),
+          max_fan_in_(std::max<size_t>(max_fan_in, 2)),
+          temp_dir_(std::move(temp_dir)),
+          compare_(compare)
+    {
+        buffer_.reserve(buffer_items_);
+    }
+
+    void add(const T& item)
+    {
+        buffer_.push_back(item);
+        if (buffer_.size() >= buffer_items_) {
+            spill();
+        }
+    }
+
+    /** @brief Number of runs written to disk so far. */
+    size_t runs_written() const noexcept { return runs_written_; }
+
+    /**
+     * @brief Visit all items in sorted order, then reset the sorter.
+     */
+    template <class Fn>
+    void merge(Fn&& visit)
+    {
+        if (runs_.empty()) {
+            /* Everything fit in memory */
+            std::sort(buffer_.begin(), buffer_.end(), compare_);
+            for (const T& item : buffer_) {
+                visit(item);
+            }
+            buffer_.clear();
+            return;
+        }
+
+        spill();
+        while (runs_.size() > max_fan_in_) {
+            std::vector<temp_file> group;
+            for (size_t i = 0; i < max_fan_in_; i++) {
+                group.push_back(std::move(runs_[i]));
+            }
+            runs_.erase(runs_.begin(), runs_.begin() + static_cast<std::ptrdiff_t>(max_fan_in_));
+            temp_file merged = open_temp_file(temp_dir_);
+            merge_runs(group, [&](const T& item) { write_items(merged.get(), &item, 1); });
+            runs_.push_back(std::move(merged));
+        }
+
+        std::vector<temp_file> runs = std::move(runs_);
+        runs_.clear();
+        merge_runs(runs, visit);
+    }
+
+   private:
+    /* Buffered cursor over one run */
+    struct run_cursor {
+        std::FILE* file;
+        std::vector<T> block;
+        size_t pos = 0;
+        size_t end = 0;
+
+        bool next()
+        {
+            if (++pos < end) {
+                return true;
+            }
+            end = std::fread(block.data(), sizeof(T), block.size(), file);
+            pos = 0;
+            return end > 0;
+        }
+        const T& current() const { return block[pos]; }
+    };
+
+    static void write_items(std::FILE* file, const T* items, size_t count)
+    {
+        if (std::fwrite(items, sizeof(T), count, file) != count) {
+            throw std::runtime_error("cannot write temporary run");
+        }
+    }
+
+    void spill()
+    {
+        if (buffer_.empty()) {
+            return;
+        }
+        std::sort(buffer_.begin(), buffer_.end(), compare_);
+        temp_file run = open_temp_file(temp_dir_);
+        write_items(run.get(), buffer_.data(), buffer_.size());
+        runs_.push_back(std::move(run));
+        runs_written_++;
+        buffer_.clear();
+    }
+
+    template <class Fn>
+    void merge_runs(std::vector<temp_file>& runs, Fn&& visit)
+    {
+        /* Split the buffer budget between the cursors */
+        size_t block_items = std::max<size_t>(buffer_items_ / runs.size(), 64);
+        std::vector<run_cursor> cursors;
+        cursors.reserve(runs.size());
+        for (temp_file& run : runs) {
+            std::fflush(run.get());
+            std::rewind(run.get());
+            run_cursor& c = cursors.emplace_back(run_cursor{run.get(), std::vector<T>(block_items)});
+            c.end = std::fread(c.block.data(), sizeof(T), c.block.size(), c.file);
+        }
+
+        auto greater = [this, &cursors](size_t a, size_t b) {
+            /* Ties broken by run order keeps the merge stable */
+            const T& ta = cursors[a].current();
+            const T& tb = cursors[b].current();
+            if (compare_(tb, ta)) {
+                return true;
+            }
+            return !compare_(ta, tb) && b < a;
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(greater);
+        for (size_t i = 0; i < cursors.size(); i++) {
+            if (cursors[i].end > 0) {
+                heap.push(i);
+            }
+        }
+        while (!heap.empty()) {
+            size_t i = heap.top();
+            heap.pop();
+            visit(cursors[i].current());
+            if (cursors[i].next()) {
+                heap.push(i);
+            }
+        }
+    }
+
+    size_t buffer_items_;
+    size_t max_fan_in_;
+    std::string temp_dir_;
+    Compare compare_;
+    std::vector<T> buffer_;
+    std::vector<temp_file> runs_;
+    size_t runs_written_ = 0;
+};
+
+}  // namespace heapinst::analyzer
@@ -0,0 +1,121 @@
+/**
+ * @file fleet.hpp
+ * @brief Fleet report: many traces reduced in parallel to one summary.
+ *
+ * Each trace file is reduced on its own to a trace_summary of mergeable
+ * parts: a log2 size histogram, a DDSketch of block lifetimes, and
+ * per-callsite counts. Workers (one per core by default) take files from
+ * a shared counter, merge their summaries into a private partial and the
+ * partials are merged at the end, so there is no locking on the hot path
+ * and memory is bounded by the number of distinct callsites, not files.
+ *
+ * A compact device_stats row per file is kept to flag outliers: devices
+ * whose peak, leftover, failure count, allocation rate or p99 lifetime is
+ * far above the fleet median by the modified z-score (median absolute
+ * deviation, Iglewicz & Hoaglin).
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "heapInstAnalyzer/sketch.hpp"
+#include "heapInstAnalyzer/symbols.hpp"
+#include "heapInstAnalyzer/trace.hpp"
+
+namespace heapinst::analyzer
+{
+
+struct site_totals {
+    uint64_t allocs = 0;
+    uint64_t bytes = 0;
+    uint64_t live_bytes = 0; /* left allocated at the end of the trace */
+    uint64_t traces = 0;     /* traces the callsite appears in */
+};
+
+/**
+ * @brief Mergeable reduction of one or more traces. merge() adds counts
+ * and sketches; peak_live keeps the largest single-trace peak.
+ */
+struct trace_summary {
+    explicit trace_summary(double alpha = 0.01) : lifetime_us(alpha) {}
+
+    uint64_t traces = 0;
+    uint64_t records = 0;
+    uint64_t allocs = 0;
+    uint64_t frees = 0;
+    uint64_t failed_allocs = 0;
+    uint64_t bytes_allocated = 0;
+    uint64_t peak_live = 0;
+    uint64_t final_live = 0;
+    uint64_t final_objects = 0;
+    uint64_t duration_us = 0;
+
+    log2_histogram sizes;
+    dd_sketch lifetime_us; /* freed blocks only */
+    std::unordered_map<uint64_t, site_totals> sites; /* by callsite key */
+
+    void merge(const trace_summary& other);
+};
+
+trace_summary summarize_trace(record_source& source, double alpha = 0.01);
+
+struct device_stats {
+    std::string name;
+    std::string error; /* set when the file could not be read */
+    bool truncated = false;
+    uint64_t records = 0;
+    uint64_t allocs = 0;
+    uint64_t failed_allocs = 0;
+    uint64_t peak_live = 0;
+    uint64_t final_live = 0;
+    uint64_t duration_us = 0;
+    double alloc_rate = 0.0; /* allocations per second */
+    double lifetime_p50_us = 0.0;
+    double lifetime_p99_us = 0.0;
+};
+
+struct fleet_outlier {
+    size_t device = 0;
+    const char* metric = "";
+    double value = 0.0;
+    double median = 0.0;
+    double score = 0.0; /* modified z-score */
+};
+
+struct fleet_options {
+    unsigned jobs = 0;      /* 0 = hardware concurrency */
+    double threshold = 3.5; /* modified z-score above which a device is flagged */
+    double alpha = 0.01;    /* sketch relative accuracy */
+};
+
+struct fleet_report {
+    trace_summary total;
+    std::vector<device_stats> devices; /* in input order */
+    std::vector<fleet_outlier> outliers; /* highest score first */
+    size_t failed_files = 0;
+};
+
+/**
+ * @brief Traces named directly, plus the .bin files below directories,
+ * sorted. A dev* directory (receive output) is one trace made of its
+ * segments, as is a dev* directory named directly.
+ */
+std::vector<std::string> collect_trace_files(const std::vector<std::string>& paths);
+
+/** @brief Each entry is a file or a segment directory (trace_segments()). */
+fleet_report analyze_fleet(const std::vector<std::string>& files, const fleet_options& options = {});
+
+/** @brief Outliers against the fleet median; called by analyze_fleet(). */
+std::vector<fleet_outlier> find_outliers(const std::vector<device_stats>& devices, double threshold);
+
+void write_fleet_report(const fleet_report& report, const symbolizer& symbols, size_t top, bool per_device,
+                        std::ostream& out);
+
+}  // namespace heapinst::analyzer
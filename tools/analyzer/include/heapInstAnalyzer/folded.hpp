@@ -0,0 +1,42 @@
+/**
+ * @file folded.hpp
+ * @brief Folded-stack ("a;b;c weight") export for flamegraph.pl and
+ * speedscope.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <ostream>
+#include <string>
+
+#include "heapInstAnalyzer/profile.hpp"
+#include "heapInstAnalyzer/symbols.hpp"
+
+namespace heapinst::analyzer
+{
+
+enum class folded_weight {
+    bytes,      /* bytes allocated up to the point */
+    count,      /* allocations up to the point */
+    live_bytes, /* bytes still live at the point */
+};
+
+/** @throws std::invalid_argument unless "bytes", "count" or "live". */
+folded_weight parse_folded_weight(const std::string& text);
+
+struct folded_options {
+    folded_weight weight = folded_weight::bytes;
+    /** Prefix each stack with a "tag:<n>" frame for tagged allocations. */
+    bool tag_frames = false;
+};
+
+/**
+ * @brief One line per distinct stack, heaviest first; zero weights are
+ * omitted.
+ */
+void write_folded(const heap_profile& profile, const symbolizer& symbols, const folded_options& options,
+                  std::ostream& out);
+
+}  // namespace heapinst::analyzer
@@ -0,0 +1,112 @@
+/**
+ * @file fragmentation.hpp
+ * @brief External fragmentation of the heap region over time.
+ *
+ * free_space tracks the free gaps of [heap_base, heap_base + heap_size)
+ * from the real block addresses: occupying and releasing a range are
+ * O(log n) map updates, with gap lengths kept in a multiset so the largest
+ * gap is always at hand. analyze_fragmentation() replays a trace through it
+ * and samples, after every heap event, the largest free gap, the number of
+ * gaps and external fragmentation = 1 - largest_free / total_free. A
+ * malloc fails when no gap fits, so a low largest gap predicts OOM better
+ * than free bytes do.
+ *
+ * Blocks cover their usable size when the record carries one. Allocator
+ * headers are invisible to the trace, so gaps are upper bounds. The region
+ * comes from the INIT record, from the options, or failing both from the
+ * extent of the allocations seen.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <set>
+#include <vector>
+
+#include "heapInstAnalyzer/trace.hpp"
+
+namespace heapinst::analyzer
+{
+
+/**
+ * @brief Free gaps of an address region.
+ */
+class free_space
+{
+   public:
+    /** @brief Region [begin, end), all free. */
+    void reset(uint64_t begin, uint64_t end);
+
+    /** @brief Mark [begin, end) in use; clipped to the region. */
+    void occupy(uint64_t begin, uint64_t end);
+
+    /** @brief Mark [begin, end) free, merging with neighbouring gaps. */
+    void release(uint64_t begin, uint64_t end);
+
+    uint64_t region_size() const noexcept { return end_ - begin_; }
+    uint64_t total_free() const noexcept { return total_free_; }
+    uint64_t largest_free() const noexcept { return lengths_.empty() ? 0 : *lengths_.rbegin(); }
+    uint64_t gaps() const noexcept { return gaps_.size(); }
+
+    /** @brief 1 - largest/total free, 0 when nothing is free. */
+    double fragmentation() const noexcept
+    {
+        return total_free_ ? 1.0 - static_cast<double>(largest_free()) / static_cast<double>(total_free_) : 0.0;
+    }
+
+   private:
+    void add_gap(uint64_t begin, uint64_t end);
+    std::map<uint64_t, uint64_t>::iterator remove_gap(std::map<uint64_t, uint64_t>::iterator it);
+
+    uint64_t begin_ = 0;
+    uint64_t end_ = 0;
+    uint64_t total_free_ = 0;
+    std::map<uint64_t, uint64_t> gaps_; /* begin -> end */
+    std::multiset<uint64_t> lengths_;
+};
+
+struct fragmentation_options {
+    uint64_t heap_base = 0;
+    uint64_t heap_size = 0; /* 0 = from INIT, else from the allocation extent */
+    size_t max_samples = 200;
+    bool usable_size = true; /* blocks cover their usable size when known */
+};
+
+struct fragmentation_sample {
+    uint64_t time_us = 0;
+    uint64_t index = 0; /* record index */
+    uint64_t used = 0;
+    uint64_t total_free = 0;
+    uint64_t largest_free = 0;
+    uint64_t gaps = 0;
+    double fragmentation = 0.0;
+};
+
+struct fragmentation_report {
+    uint64_t heap_base = 0;
+    uint64_t heap_size = 0;
+    bool region_from_extent = false;
+    uint64_t outside_blocks = 0; /* allocations not within the region */
+
+    /* Worst points over the whole trace, not just the kept samples */
+    fragmentation_sample min_largest_free;
+    fragmentation_sample max_fragmentation;
+    fragmentation_sample final;
+
+    /* At most max_samples, evenly thinned as massif does */
+    std::vector<fragmentation_sample> timeline;
+};
+
+/** @brief Replays the trace; reopens it once when the region must be inferred. */
+fragmentation_report analyze_fragmentation(const source_factory& open, const fragmentation_options& options = {});
+
+void write_fragmentation_report(const fragmentation_report& report, std::ostream& out);
+
+/** @brief Timeline as CSV with a header row. */
+void write_fragmentation_csv(const fragmentation_report& report, std::ostream& out);
+
+}  // namespace heapinst::analyzer
@@ -0,0 +1,36 @@
+/**
+ * @file heaptrack.hpp
+ * @brief heaptrack data file export for heaptrack_gui / heaptrack_print.
+ *
+ * Writes the interpreted heaptrack format (file format version 2): interned
+ * strings, instruction pointers and trace nodes, deduplicated allocation
+ * infos, and +/- events in trace order with c (elapsed ms) and R (RSS)
+ * lines, so consumption over time, temporary allocations and flame graphs
+ * work as for a heaptrack recording. Each callsite is a one-frame trace.
+ *
+ * The output is written uncompressed; heaptrack_gui picks the decoder from
+ * the file extension, so do not name it *.gz unless compressing it.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <ostream>
+#include <string>
+
+#include "heapInstAnalyzer/symbols.hpp"
+#include "heapInstAnalyzer/trace.hpp"
+
+namespace heapinst::analyzer
+{
+
+struct heaptrack_options {
+    std::string cmd = "heapInst trace";
+    std::string module = "firmware"; /* module name shown for every frame */
+};
+
+void write_heaptrack(record_source& source, const symbolizer& symbols, const heaptrack_options& options,
+                     std::ostream& out);
+
+}  // namespace heapinst::analyzer
@@ -0,0 +1,110 @@
+/**
+ * @file live.hpp
+ * @brief Incremental analyzer state for live views of a running target.
+ *
+ * live_state consumes records as they arrive and keeps the live set, a
+ * sliding allocation rate, live bytes per callsite and, when the heap
+ * region is known, the free gaps of the heap (see free_space). Every
+ * update is O(log n), so it keeps up with a streaming target.
+ *
+ * Views are published as JSON deltas: sample() captures the current values
+ * once per publishing tick and live_delta_json() encodes, per subscriber,
+ * only what changed since that subscriber's previous delta. A fresh
+ * live_view gets everything, so a client joining late starts from a full
+ * snapshot. Scalars are absolute values, not increments, and each delta
+ * carries the current top-callsite order, so dropped deltas never leave a
+ * client inconsistent.
+ *
+ *   {"seq":3,"full":false,"values":{"live_bytes":1024,...},
+ *    "top":{"order":["s0000000010001000",...],"set":[{"key":...,"name":...,"bytes":...,"count":...}]}}
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "heapInstAnalyzer/fragmentation.hpp"
+#include "heapInstAnalyzer/replay.hpp"
+#include "heapInstAnalyzer/symbols.hpp"
+
+namespace heapinst::analyzer
+{
+
+struct live_options {
+    size_t top = 10;
+    uint64_t heap_base = 0;
+    uint64_t heap_size = 0;             /* 0 = from INIT */
+    uint64_t rate_window_us = 1000000;  /* allocation rate window (trace time) */
+};
+
+struct live_site {
+    uint64_t key = 0; /* callsite key */
+    uint64_t bytes = 0;
+    uint64_t count = 0;
+};
+
+struct live_sample {
+    std::vector<std::pair<const char*, double>> values;
+    std::vector<live_site> top; /* most live bytes first */
+};
+
+/** @brief What one subscriber has been sent so far. */
+struct live_view {
+    uint64_t seq = 0;
+    std::unordered_map<std::string, double> values;
+    std::unordered_map<uint64_t, std::pair<uint64_t, uint64_t>> top; /* key -> bytes, count */
+    std::vector<uint64_t> order;
+};
+
+class live_state
+{
+   public:
+    explicit live_state(const live_options& options = {});
+
+    void apply(const record& rec);
+
+    /** @brief Forget everything, e.g. when a followed file was truncated. */
+    void reset();
+
+    live_sample sample() const;
+
+    const heap_replay& replay() const noexcept { return replay_; }
+    bool region_known() const noexcept { return region_known_; }
+    const free_space& space() const noexcept { return space_; }
+
+   private:
+    struct rate_bucket {
+        uint64_t slot = 0;
+        uint64_t count = 0;
+        uint64_t bytes = 0;
+    };
+
+    void allocated(const allocation& a);
+    void released(const allocation& a);
+    uint64_t block_end(const allocation& a) const;
+
+    live_options options_;
+    heap_replay replay_;
+    free_space space_;
+    bool region_known_ = false;
+    std::unordered_map<uint64_t, live_site> sites_;
+    std::deque<rate_bucket> rate_; /* 10 slots spanning the rate window */
+};
+
+/**
+ * @brief Encode the changes since view and advance view; "" when nothing
+ * changed (a fresh view always gets a full snapshot).
+ */
+std::string live_delta_json(const live_sample& sample, live_view& view, const symbolizer& symbols);
+
+/** @brief JSON string literal with quotes and escapes. */
+std::string json_string(const std::string& text);
+
+}  // namespace heapinst::analyzer
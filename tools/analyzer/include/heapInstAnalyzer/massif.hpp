@@ -0,0 +1,45 @@
+/**
+ * @file massif.hpp
+ * @brief Valgrind massif.out export, readable by ms_print and
+ * massif-visualizer.
+ *
+ * The trace is consumed one record at a time and at most max_snapshots
+ * snapshots are kept: when the table fills up, every other snapshot is
+ * dropped and the snapshot interval doubles, as massif itself does. Output
+ * size is therefore bounded regardless of trace length. Every
+ * detailed_freq-th snapshot carries an allocation tree, and one extra
+ * detailed snapshot is taken at the heap peak.
+ *
+ * mem_heap_extra_B is the allocator slack from HEAP_RECORD_FLAG_USABLE_SIZE
+ * records and mem_stacks_B the sum of the latest STACK_HWM per stack.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+#include "heapInstAnalyzer/symbols.hpp"
+#include "heapInstAnalyzer/trace.hpp"
+
+namespace heapinst::analyzer
+{
+
+struct massif_options {
+    /** "ms" (trace time), "B" (bytes allocated and freed) or "i" (records). */
+    std::string time_unit = "ms";
+    size_t max_snapshots = 100;
+    size_t detailed_freq = 10;
+    /** Callsites below this share of the heap (percent) are lumped together. */
+    double threshold = 1.0;
+    std::string cmd = "heapInst trace";
+};
+
+/** @throws std::invalid_argument on an unknown time unit. */
+void write_massif(record_source& source, const symbolizer& symbols, const massif_options& options,
+                  std::ostream& out);
+
+}  // namespace heapinst::analyzer
@@ -0,0 +1,86 @@
+/**
+ * @file merge.hpp
+ * @brief Streaming k-way merge of per-source traces by timestamp.
+ *
+ * merge_source combines the record streams of several sources (cores,
+ * threads with their own buffers, devices) into one trace in time order,
+ * itself a record_source so every analysis runs on the merged result.
+ *
+ * Each source is shifted onto a common clock by (reference - local) from
+ * its latest HEAP_OP_TIME_SYNC record, or by a fixed offset until the
+ * first one. A source may be out of order by up to window_us (records
+ * flushed per buffer, offset steps); each keeps a small reorder heap and
+ * releases a record once the source has reached window_us past it. With a
+ * zero window the merge is a plain k-way merge holding one record per
+ * source, and runs of records from the same source skip the heap.
+ *
+ * Records later than the window allows are clamped to the last emitted
+ * time, so the output is always ordered, and counted as late.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "heapInstAnalyzer/trace.hpp"
+
+namespace heapinst::analyzer
+{
+
+struct merge_options {
+    uint64_t window_us = 0;          /* tolerated disorder within one source */
+    size_t max_pending = 1u << 16;   /* per-source reorder bound, in records */
+    std::vector<int64_t> offsets_us; /* per source, until its first sync */
+};
+
+struct merge_input_stats {
+    uint64_t records = 0;
+    uint64_t syncs = 0;
+    uint64_t late = 0;  /* clamped to keep the output ordered */
+    int64_t offset_us = 0; /* latest offset applied */
+};
+
+class merge_source : public record_source
+{
+   public:
+    merge_source(std::vector<std::unique_ptr<record_source>> inputs, merge_options options = {});
+
+    /** @brief Next record on the common clock (timestamp rewritten). */
+    bool next(record& out) override;
+
+    const std::vector<merge_input_stats>& stats() const noexcept { return stats_; }
+
+   private:
+    struct entry {
+        uint64_t time;
+        uint64_t seq; /* arrival order within the source, for stability */
+        record rec;
+    };
+    struct input {
+        std::unique_ptr<record_source> source;
+        std::vector<entry> pending; /* min-heap on (time, seq) */
+        uint64_t high = 0;          /* latest time read */
+        uint64_t seq = 0;
+        int64_t offset = 0;
+        bool done = false;
+    };
+
+    /* Read from input i until its earliest pending record is final */
+    void fill(size_t i);
+    bool ready(const input& in) const;
+    bool before(size_t a, size_t b) const;
+
+    merge_options options_;
+    std::vector<input> inputs_;
+    std::vector<merge_input_stats> stats_;
+    std::vector<size_t> heap_; /* inputs with a final record, min-heap */
+    size_t current_;           /* input emitted last, not in heap_ */
+    uint64_t last_out_ = 0;
+};
+
+}  // namespace heapinst::analyzer
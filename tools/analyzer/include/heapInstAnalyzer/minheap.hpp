@@ -0,0 +1,90 @@
+/**
+ * @file minheap.hpp
+ * @brief Smallest heap region a trace fits in, by replay.
+ *
+ * The allocation sequence of a trace is replayed against a model of a
+ * free-list allocator (newlib/dlmalloc style: per-chunk header overhead,
+ * chunk alignment, a minimum chunk size, address-ordered coalescing free
+ * list, first- or best-fit) inside a fixed region, and the region size is
+ * binary-searched for the smallest one where no allocation fails. Compared
+ * with the heap_size of the INIT record this is the real headroom.
+ *
+ * REALLOC is modeled as in-place resize when the chunk (plus a free
+ * successor) is large enough, otherwise allocate-copy-free with both blocks
+ * live during the copy. Fit is not strictly monotonic in region size under
+ * first-fit; the search result is re-verified, and a few bytes of slack on
+ * top are advisable.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "heapInstAnalyzer/trace.hpp"
+
+namespace heapinst::analyzer
+{
+
+struct allocator_model {
+    enum class fit { first, best };
+
+    uint32_t align = 8;     /* chunk alignment (power of two) */
+    uint32_t overhead = 8;  /* header bytes per chunk */
+    uint32_t min_chunk = 16;
+    fit policy = fit::first;
+
+    uint64_t chunk_size(uint32_t request) const noexcept
+    {
+        uint64_t need = static_cast<uint64_t>(request) + overhead;
+        need = (need + align - 1) & ~static_cast<uint64_t>(align - 1);
+        return need < min_chunk ? min_chunk : need;
+    }
+};
+
+/**
+ * @brief The allocation sequence of a trace, reduced to dense block ids.
+ */
+class heap_workload
+{
+   public:
+    enum class op : uint8_t { alloc, free, realloc };
+
+    struct event {
+        op kind;
+        uint32_t block; /* dense id; realloc: the new block */
+        uint32_t size;  /* alloc/realloc: requested size */
+        uint32_t old_block;
+    };
+
+    static heap_workload from(record_source& source);
+
+    const std::vector<event>& events() const noexcept { return events_; }
+    uint32_t blocks() const noexcept { return blocks_; }
+    uint64_t peak_requested() const noexcept { return peak_requested_; }
+    uint32_t heap_base() const noexcept { return heap_base_; }
+    uint32_t heap_size() const noexcept { return heap_size_; }
+
+   private:
+    std::vector<event> events_;
+    uint32_t blocks_ = 0;
+    uint64_t peak_requested_ = 0;
+    uint32_t heap_base_ = 0;
+    uint32_t heap_size_ = 0;
+};
+
+/** @brief Peak of the sum of chunk sizes: no region smaller than this can fit. */
+uint64_t min_heap_lower_bound(const heap_workload& workload, const allocator_model& model);
+
+/**
+ * @brief Replay in a region of region_size bytes.
+ * @return true if every allocation succeeded.
+ */
+bool workload_fits(const heap_workload& workload, const allocator_model& model, uint64_t region_size);
+
+/** @brief Smallest region size that fits (0 for an empty workload). */
+uint64_t min_heap_size(const heap_workload& workload, const allocator_model& model);
+
+}  // namespace heapinst::analyzer
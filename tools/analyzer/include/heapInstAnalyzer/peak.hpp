@@ -0,0 +1,69 @@
+/**
+ * @file peak.hpp
+ * @brief What was live at the moment of peak heap usage.
+ *
+ * The peak sets the SRAM budget. analyze_peak() finds the global peak, or
+ * the peak inside a range delimited by trace points, rebuilds the exact
+ * live set at that record and breaks it down by callsite, tag, size class
+ * and age. Traces with usable sizes (HEAPINST_CFG_RECORD_USABLE_SIZE) also
+ * get the allocator slack per size class: the internal fragmentation that
+ * shows which sizes to round up or move into pools. It streams the trace twice (find the peak, then rebuild), so
+ * memory stays proportional to the live set.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "heapInstAnalyzer/replay.hpp"
+#include "heapInstAnalyzer/symbols.hpp"
+#include "heapInstAnalyzer/trace.hpp"
+
+namespace heapinst::analyzer
+{
+
+struct peak_options {
+    trace_point from; /* end = start of trace; otherwise analysis starts after it */
+    trace_point to;   /* end = end of trace */
+};
+
+/**
+ * @brief Bytes and blocks sharing a key. The key is a callsite key, a tag,
+ * the lower bound of a power-of-two size class, or the upper bound of an
+ * age bucket in microseconds (UINT64_MAX for the last bucket).
+ */
+struct peak_group {
+    uint64_t key = 0;
+    uint64_t bytes = 0;  /* requested */
+    uint64_t count = 0;
+    uint64_t usable = 0; /* allocator block bytes; requested where unknown */
+
+    uint64_t slack() const noexcept { return usable > bytes ? usable - bytes : 0; }
+};
+
+struct peak_report {
+    bool found = false;
+    uint64_t bytes = 0;
+    uint64_t objects = 0;
+    uint64_t time_us = 0;
+    uint64_t index = 0;        /* record index of the peak */
+    uint64_t range_first = 0;  /* record indices of the analyzed range */
+    uint64_t range_last = 0;
+    bool usable_known = false; /* some live block at the peak has a usable size */
+
+    std::vector<peak_group> by_site; /* heaviest first */
+    std::vector<peak_group> by_tag;  /* heaviest first */
+    std::vector<peak_group> by_size; /* ascending size class */
+    std::vector<peak_group> by_age;  /* ascending age */
+};
+
+peak_report analyze_peak(const source_factory& open, const peak_options& options = {});
+
+/** @brief Human-readable report; top limits the callsite table. */
+void write_peak_report(const peak_report& report, const symbolizer& symbols, size_t top, std::ostream& out);
+
+}  // namespace heapinst::analyzer
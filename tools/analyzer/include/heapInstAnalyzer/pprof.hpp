@@ -0,0 +1,30 @@
+/**
+ * @file pprof.hpp
+ * @brief pprof (profile.proto) export.
+ *
+ * Writes a heap profile with the sample types of Go heap profiles
+ * (alloc_objects, alloc_space, inuse_objects, inuse_space; inuse_space is
+ * the default), so `pprof -http=: trace.pb` shows flame graphs and
+ * `pprof -diff_base=a.pb b.pb` compares two points. Each callsite becomes
+ * one location; the allocation tag is attached as the numeric label "tag"
+ * (use -tagfocus / -tagignore to slice by it).
+ *
+ * The output is an uncompressed protobuf, which pprof reads as is; gzip it
+ * for storage if desired.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <ostream>
+
+#include "heapInstAnalyzer/profile.hpp"
+#include "heapInstAnalyzer/symbols.hpp"
+
+namespace heapinst::analyzer
+{
+
+void write_pprof(const heap_profile& profile, const symbolizer& symbols, std::ostream& out);
+
+}  // namespace heapinst::analyzer
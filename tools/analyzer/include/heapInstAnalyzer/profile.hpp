@@ -0,0 +1,66 @@
+/**
+ * @file profile.hpp
+ * @brief Per-callsite heap profile at a point in a trace.
+ *
+ * The common input of the profile exporters (pprof, folded stacks): for
+ * every (callsite, tag) pair, the allocations made up to the point and the
+ * part of them still live there.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "heapInstAnalyzer/replay.hpp"
+
+namespace heapinst::analyzer
+{
+
+struct profile_entry {
+    callsite site;
+    uint16_t tag = 0;
+    uint64_t alloc_objects = 0;
+    uint64_t alloc_space = 0;
+    uint64_t inuse_objects = 0;
+    uint64_t inuse_space = 0;
+};
+
+struct heap_profile {
+    std::vector<profile_entry> entries; /* sorted by inuse_space, then alloc_space */
+    uint64_t start_us = 0;              /* first record */
+    uint64_t end_us = 0;                /* last record included */
+    uint64_t records = 0;
+};
+
+/**
+ * @brief Replay source up to point and aggregate by (callsite, tag).
+ */
+heap_profile build_heap_profile(record_source& source, const trace_point& point = {});
+
+/**
+ * @brief Memory budget for build_heap_profile_spilled().
+ */
+struct spill_options {
+    size_t memory_bytes = 64u << 20;
+    std::string temp_dir; /* empty = system default */
+};
+
+/**
+ * @brief Out-of-core variant of build_heap_profile() for traces whose live
+ * set or callsite table does not fit in memory.
+ *
+ * Per-callsite totals are combined in a bounded table that spills sorted
+ * runs to disk. The live set is not kept at all: every pointer event is
+ * written to an external sort keyed by (pointer, sequence) and an
+ * allocation is live at the point iff it is the last event of its pointer
+ * and no INIT followed it. Produces the same profile as the in-memory mode.
+ */
+heap_profile build_heap_profile_spilled(record_source& source, const trace_point& point = {},
+                                        const spill_options& options = {});
+
+}  // namespace heapinst::analyzer
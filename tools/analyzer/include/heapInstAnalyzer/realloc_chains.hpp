@@ -0,0 +1,79 @@
+/**
+ * @file realloc_chains.hpp
+ * @brief Growth chains: one logical buffer followed through its reallocs.
+ *
+ * Code that grows a buffer by repeated realloc (vector-style append) shows
+ * up as a run of REALLOC records, each taking the previous one's result
+ * as its old pointer. analyze_realloc_chains() follows old_ptr -> new_ptr
+ * from the creating MALLOC to the final FREE (or the end of the trace) and
+ * ranks the chains by the bytes realloc had to copy. The origin callsites
+ * at the top are where a reserve() up front would pay off.
+ *
+ * A realloc is a move when its result differs from the old pointer; a
+ * move copies min(old size, new size) bytes. Memory is proportional to
+ * the live set plus the kept top chains.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "heapInstAnalyzer/replay.hpp"
+#include "heapInstAnalyzer/symbols.hpp"
+#include "heapInstAnalyzer/trace.hpp"
+
+namespace heapinst::analyzer
+{
+
+struct realloc_chain {
+    callsite origin;      /* site creating the buffer */
+    callsite grow_site;   /* site of the last realloc */
+    uint16_t tag = 0;
+    uint32_t first_ptr = 0;
+    uint32_t final_ptr = 0;
+    uint32_t initial_size = 0;
+    uint32_t final_size = 0;
+    uint32_t max_size = 0;
+    uint64_t reallocs = 0;
+    uint64_t moves = 0;
+    uint64_t copied_bytes = 0;
+    uint64_t start_us = 0;
+    uint64_t end_us = 0;
+    bool live = false; /* still allocated at the end of the trace */
+};
+
+/** @brief Chains with at least min_reallocs reallocs, by origin callsite. */
+struct chain_site_summary {
+    callsite origin;
+    uint64_t chains = 0;
+    uint64_t reallocs = 0;
+    uint64_t moves = 0;
+    uint64_t copied_bytes = 0;
+    uint32_t max_final_size = 0; /* the reserve() that would have avoided them all */
+};
+
+struct chain_options {
+    size_t top = 20;           /* individual chains kept */
+    uint64_t min_reallocs = 1; /* shorter chains are ignored */
+};
+
+struct chain_report {
+    uint64_t chains = 0;       /* chains with at least min_reallocs reallocs */
+    uint64_t reallocs = 0;
+    uint64_t moves = 0;
+    uint64_t copied_bytes = 0;
+
+    std::vector<realloc_chain> top;          /* most copied first */
+    std::vector<chain_site_summary> by_site; /* most copied first */
+};
+
+chain_report analyze_realloc_chains(record_source& source, const chain_options& options = {});
+
+/** @brief Human-readable report; top limits both tables. */
+void write_chain_report(const chain_report& report, const symbolizer& symbols, size_t top, std::ostream& out);
+
+}  // namespace heapinst::analyzer
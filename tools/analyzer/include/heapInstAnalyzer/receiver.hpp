@@ -0,0 +1,169 @@
+/**
+ * @file receiver.hpp
+ * @brief Receiving framed traces: deframing, loss accounting, storage.
+ *
+ * frame_decoder turns UDP datagrams or a serial byte stream into frames
+ * (heapInst/heapInstFrame.h), verifying the CRC and, on byte streams,
+ * resynchronizing on the magic after corruption. trace_receiver tracks the
+ * sequence numbers of each device and appends its records to rotated
+ * segment files:
+ *
+ *   <dir>/dev<id>/000001.bin ...    raw records, readable by every command
+ *   <dir>/dev<id>/index.csv         one row per closed segment
+ *
+ * A few frames per device are held back so that reordered ones are written
+ * in sequence; a gap still open when that buffer overflows counts as lost.
+ * A frame of such a gap arriving later is dropped rather than written out
+ * of order, and no longer counted as lost. A frame behind the sequence that
+ * is neither a late one nor a duplicate (same CRC as the frame received
+ * with that number) starts a new run, as do sequence 0 and a frame opening
+ * with an INIT record: the device restarted. Counters are exported in the
+ * Prometheus text format.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "heapInst/heapInstFrame.h"
+#include "heapInstAnalyzer/trace.hpp"
+
+namespace heapinst::analyzer
+{
+
+/** @brief Link-level counters of one input (socket or serial port). */
+struct source_counters {
+    uint64_t bytes = 0;
+    uint64_t frames = 0;
+    uint64_t crc_errors = 0;
+    uint64_t malformed = 0;    /* datagrams that are not one whole frame */
+    uint64_t resync_bytes = 0; /* stream bytes skipped looking for a frame */
+};
+
+class frame_decoder
+{
+   public:
+    using frame_fn = std::function<void(const heap_inst_frame_header_t&, const record*, size_t)>;
+
+    explicit frame_decoder(frame_fn on_frame) : on_frame_(std::move(on_frame)) {}
+
+    /** @brief One datagram holding exactly one frame. */
+    void feed_datagram(const void* data, size_t len);
+
+    /** @brief Bytes of a stream (serial, TCP); frames may span calls. */
+    void feed_stream(const void* data, size_t len);
+
+    const source_counters& counters() const noexcept { return counters_; }
+
+   private:
+    /* Validates and delivers a complete frame at data */
+    bool deliver(const uint8_t* data, size_t len);
+
+    frame_fn on_frame_;
+    source_counters counters_;
+    std::vector<uint8_t> pending_;
+    std::vector<record> records_;
+};
+
+/** @brief Frame with header and CRC filled in, as a sender builds it. */
+std::vector<uint8_t> encode_frame(uint16_t device_id, uint32_t sequence, const record* records, size_t count);
+
+struct receiver_options {
+    std::string directory = ".";
+    uint64_t segment_bytes = 64ull << 20; /* rotate at this size */
+    uint64_t segment_seconds = 0;         /* and/or this age; 0 = size only */
+    uint32_t reorder_frames = 8;          /* frames held back per device for reordering */
+    uint32_t history_frames = 1024;       /* frames remembered to spot late ones and duplicates */
+};
+
+struct device_counters {
+    uint64_t frames = 0;
+    uint64_t records = 0;
+    uint64_t bytes = 0;
+    uint64_t lost_frames = 0;
+    uint64_t late_frames = 0; /* late (after being counted lost) or duplicate, dropped */
+    uint64_t restarts = 0;
+    uint64_t segments = 0;
+};
+
+class trace_receiver
+{
+   public:
+    explicit trace_receiver(receiver_options options);
+    ~trace_receiver();
+
+    trace_receiver(const trace_receiver&) = delete;
+    trace_receiver& operator=(const trace_receiver&) = delete;
+
+    /** @throws std::runtime_error when a segment cannot be written. */
+    void on_frame(const heap_inst_frame_header_t& header, const record* records, size_t count);
+
+    /** @brief Rotate segments older than segment_seconds; now in seconds. */
+    void rotate_aged(uint64_t now_s);
+
+    /** @brief Close every open segment and write its index row. */
+    void close_all();
+
+    std::map<uint16_t, device_counters> counters() const;
+
+    /** @brief Prometheus text exposition of devices and sources. */
+    void write_metrics(std::ostream& out, const std::vector<std::pair<std::string, source_counters>>& sources) const;
+
+   private:
+    struct held_frame {
+        uint32_t sequence = 0;
+        uint32_t crc = 0;
+        std::vector<record> records;
+    };
+
+    struct seen_frame {
+        uint32_t sequence = 0;
+        uint32_t crc = 0;
+        bool valid = false;
+    };
+
+    struct device {
+        uint16_t id = 0;
+        std::string directory;
+        device_counters counters;
+        bool seen = false;
+        uint32_t expected = 0;
+        std::vector<held_frame> held;   /* ahead of expected, unordered */
+        std::vector<seen_frame> history; /* by sequence % history_frames */
+        std::set<uint32_t> missing;     /* counted lost, may still arrive */
+
+        /* Open segment */
+        std::FILE* file = nullptr;
+        uint64_t number = 0;
+        uint64_t opened_s = 0;
+        uint64_t seg_bytes = 0;
+        uint64_t seg_records = 0;
+        uint32_t first_seq = 0;
+        uint32_t last_seq = 0;
+        uint64_t first_us = 0;
+        uint64_t last_us = 0;
+        uint64_t seg_lost = 0;
+    };
+
+    device& device_for(uint16_t id);
+    seen_frame& history_slot(device& d, uint32_t sequence);
+    /* Write held frames in sequence; past the buffer size (or to drain) skip gaps */
+    void release(device& d, bool drain);
+    void write_frame(device& d, const held_frame& frame, uint64_t lost);
+    void open_segment(device& d);
+    void close_segment(device& d);
+
+    receiver_options options_;
+    std::map<uint16_t, device> devices_;
+};
+
+}  // namespace heapinst::analyzer
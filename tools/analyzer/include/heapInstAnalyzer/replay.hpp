@@ -0,0 +1,160 @@
+/**
+ * @file replay.hpp
+ * @brief Rebuilding the live heap from a trace.
+ *
+ * heap_replay applies MALLOC/REALLOC/FREE records one at a time and keeps
+ * the set of live allocations with running totals and the peak. Every
+ * analysis that needs "what was live when" is built on top of it.
+ *
+ * Resource records (HEAP_OP_RESOURCE_*) are not replayed: their blocks
+ * usually live inside malloc'd arenas that the trace already accounts for.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <compare>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "heapInstAnalyzer/trace.hpp"
+
+namespace heapinst::analyzer
+{
+
+/**
+ * @brief Where an allocation came from: a return address or, with
+ * HEAP_RECORD_FLAG_SITE_ID, a source-location id.
+ */
+struct callsite {
+    uint32_t site = 0;
+    bool is_site_id = false;
+
+    /** @brief Unique 64-bit key for hashing and sorting. */
+    uint64_t key() const noexcept { return (static_cast<uint64_t>(is_site_id) << 32) | site; }
+    static callsite from_key(uint64_t key) noexcept
+    {
+        return {static_cast<uint32_t>(key), (key >> 32) != 0};
+    }
+
+    auto operator<=>(const callsite&) const = default;
+};
+
+inline callsite callsite_of(const record& rec) noexcept
+{
+    return {rec.site, (rec.flags & HEAP_RECORD_FLAG_SITE_ID) != 0};
+}
+
+/**
+ * @brief One live heap block.
+ */
+struct allocation {
+    uint32_t ptr = 0;
+    uint32_t size = 0;
+    uint32_t usable = 0; /* allocator usable size (HEAP_RECORD_FLAG_USABLE_SIZE), 0 if unknown */
+    callsite site;
+    uint16_t tag = 0;
+    uint64_t time_us = 0; /* timestamp of the allocating record */
+    uint64_t index = 0;   /* position of the allocating record in the trace */
+};
+
+/**
+ * @brief Effect of one record on the live set.
+ *
+ * A moving or resizing REALLOC reports both the released and the new block
+ * with is_realloc set; a plain MALLOC or FREE reports one of them.
+ */
+struct replay_step {
+    std::optional<allocation> freed;
+    std::optional<allocation> allocated;
+    bool is_realloc = false;
+};
+
+/**
+ * @brief Incremental live-set reconstruction.
+ */
+class heap_replay
+{
+   public:
+    using live_map = std::unordered_map<uint32_t, allocation>;
+
+    /** @brief Apply the next record of the trace. */
+    replay_step apply(const record& rec);
+
+    const live_map& live() const noexcept { return live_; }
+    uint64_t live_bytes() const noexcept { return live_bytes_; }
+    uint64_t live_objects() const noexcept { return live_.size(); }
+    /** @brief Allocator slack of live blocks (usable - requested), where recorded. */
+    uint64_t live_extra_bytes() const noexcept { return live_extra_; }
+
+    uint64_t peak_bytes() const noexcept { return peak_bytes_; }
+    uint64_t peak_time_us() const noexcept { return peak_time_us_; }
+    uint64_t peak_index() const noexcept { return peak_index_; }
+
+    uint64_t total_allocs() const noexcept { return total_allocs_; }
+    uint64_t total_bytes() const noexcept { return total_bytes_; }
+    uint64_t failed_allocs() const noexcept { return failed_allocs_; }
+    uint64_t unmatched_frees() const noexcept { return unmatched_frees_; }
+
+    /** @brief Heap region from the INIT record (size 0 if unknown). */
+    uint32_t heap_base() const noexcept { return heap_base_; }
+    uint32_t heap_size() const noexcept { return heap_size_; }
+
+    uint64_t records() const noexcept { return records_; }
+    uint64_t first_time_us() const noexcept { return first_time_us_; }
+    uint64_t time_us() const noexcept { return time_us_; }
+
+   private:
+    allocation insert(const record& rec, uint32_t ptr, uint32_t size);
+    std::optional<allocation> erase(uint32_t ptr);
+
+    live_map live_;
+    uint64_t live_bytes_ = 0;
+    uint64_t live_extra_ = 0;
+    uint64_t peak_bytes_ = 0;
+    uint64_t peak_time_us_ = 0;
+    uint64_t peak_index_ = 0;
+    uint64_t total_allocs_ = 0;
+    uint64_t total_bytes_ = 0;
+    uint64_t failed_allocs_ = 0;
+    uint64_t unmatched_frees_ = 0;
+    uint32_t heap_base_ = 0;
+    uint32_t heap_size_ = 0;
+    uint64_t records_ = 0;
+    uint64_t first_time_us_ = 0;
+    uint64_t time_us_ = 0;
+};
+
+/**
+ * @brief A position in a trace: its end, a timestamp, or a marker.
+ *
+ * Parsed from "end", "<timestamp_us>" or "marker:<id>". A time point
+ * includes every record up to and including that timestamp; a marker point
+ * includes everything up to the first HEAP_OP_MARKER with that id.
+ */
+struct trace_point {
+    enum class kind { end, time, marker };
+
+    kind type = kind::end;
+    uint64_t value = 0;
+
+    /** @throws std::invalid_argument on malformed input. */
+    static trace_point parse(const std::string& text);
+
+    /** @brief True if rec lies beyond the point (stop before applying it). */
+    bool after(const record& rec) const noexcept
+    {
+        return type == kind::time && rec.timestamp_us > value;
+    }
+
+    /** @brief True if rec is the point itself (stop after applying it). */
+    bool at(const record& rec) const noexcept
+    {
+        return type == kind::marker && rec.operation == HEAP_OP_MARKER && rec.arg1 == value;
+    }
+};
+
+}  // namespace heapinst::analyzer
@@ -0,0 +1,74 @@
+/**
+ * @file sketch.hpp
+ * @brief Mergeable summaries: DDSketch quantiles and log2 histograms.
+ *
+ * dd_sketch (Masson et al., VLDB 2019) keeps counts in logarithmic buckets
+ * of ratio gamma = (1 + alpha) / (1 - alpha), so every quantile it returns
+ * is within relative error alpha of a true sample value. Merging two
+ * sketches with the same alpha adds bucket counts and is exact, which lets
+ * per-file summaries be reduced in any order on any number of threads.
+ * When a sketch outgrows max_buckets, the lowest buckets are collapsed:
+ * only the low quantiles lose accuracy.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+namespace heapinst::analyzer
+{
+
+class dd_sketch
+{
+   public:
+    explicit dd_sketch(double alpha = 0.01, size_t max_buckets = 2048);
+
+    /** @brief Adds value count times; values below 1 go to the zero bucket. */
+    void add(double value, uint64_t count = 1);
+
+    /** @throws std::invalid_argument when alpha differs. */
+    void merge(const dd_sketch& other);
+
+    /** @brief Value at quantile q in [0, 1]; 0 when empty. */
+    double quantile(double q) const;
+
+    uint64_t count() const noexcept { return count_; }
+    double sum() const noexcept { return sum_; }
+    double min() const noexcept { return count_ ? min_ : 0.0; }
+    double max() const noexcept { return count_ ? max_ : 0.0; }
+    double alpha() const noexcept { return alpha_; }
+
+   private:
+    int32_t index_of(double value) const;
+    double value_of(int32_t index) const;
+    void collapse();
+
+    double alpha_;
+    double gamma_log_;
+    size_t max_buckets_;
+    std::map<int32_t, uint64_t> buckets_;
+    uint64_t zero_count_ = 0;
+    uint64_t count_ = 0;
+    double sum_ = 0.0;
+    double min_ = 0.0;
+    double max_ = 0.0;
+};
+
+/**
+ * @brief Counts per power-of-two class: bucket 0 holds 0, bucket b holds
+ * [2^(b-1), 2^b).
+ */
+struct log2_histogram {
+    std::array<uint64_t, 65> buckets{};
+
+    void add(uint64_t value, uint64_t count = 1);
+    void merge(const log2_histogram& other);
+    static uint64_t lower_bound(size_t bucket) noexcept { return bucket ? uint64_t{1} << (bucket - 1) : 0; }
+};
+
+}  // namespace heapinst::analyzer
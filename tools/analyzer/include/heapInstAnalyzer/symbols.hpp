@@ -0,0 +1,69 @@
+/**
+ * @file symbols.hpp
+ * @brief Resolving callsites to functions and source locations.
+ *
+ * Two sources are supported, both plain text so no ELF/DWARF library is
+ * needed on the host:
+ *   - nm output (`nm -C [-S] firmware.elf`), resolving return addresses to
+ *     the enclosing function;
+ *   - site tables written by heap_inst_enable_site_ids() (heapInstSite.h),
+ *     resolving source-location ids to file:line.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "heapInstAnalyzer/replay.hpp"
+
+namespace heapinst::analyzer
+{
+
+/**
+ * @brief A resolved callsite. Empty fields are unknown.
+ */
+struct frame {
+    std::string function;
+    std::string file;
+    uint32_t line = 0;
+};
+
+class symbolizer
+{
+   public:
+    /** @throws std::runtime_error if the file cannot be read. */
+    void load_nm(const std::string& path);
+    void load_site_table(const std::string& path);
+
+    /** @brief Add one symbol (nm loading and tests). size 0 = unknown. */
+    void add_symbol(uint64_t address, uint64_t size, std::string name);
+    void add_file(uint16_t file_id, std::string path);
+
+    frame resolve(const callsite& site) const;
+
+    /**
+     * @brief Short display name: function, file:line, or the raw value in
+     * hex when nothing resolves.
+     */
+    std::string name(const callsite& site) const;
+
+   private:
+    struct symbol {
+        uint64_t address;
+        uint64_t size;
+        std::string name;
+    };
+
+    const symbol* lookup(uint64_t address) const;
+
+    mutable std::vector<symbol> symbols_;
+    mutable bool sorted_ = true;
+    std::unordered_map<uint16_t, std::string> files_;
+};
+
+}  // namespace heapinst::analyzer
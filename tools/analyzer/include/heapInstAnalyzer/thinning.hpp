@@ -0,0 +1,74 @@
+/**
+ * @file thinning.hpp
+ * @brief Bounded timelines over traces of unknown length.
+ *
+ * A timeline samples every interval-th event. When it outgrows its bound,
+ * every other sample is dropped (the first is always kept) and the interval
+ * doubles, so the samples stay evenly spread over the whole trace whatever
+ * its length, in at most max_samples entries.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace heapinst::analyzer
+{
+
+/** @brief Keep the even-indexed samples. */
+template <class T>
+void decimate(std::vector<T>& samples)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < samples.size(); i += 2) {
+        samples[kept++] = std::move(samples[i]);
+    }
+    samples.resize(kept);
+}
+
+/**
+ * @brief Samples every interval-th event, thinning by two when full.
+ */
+template <class T>
+class thinned_series
+{
+   public:
+    /** @param max_samples Bound on the length; 0 keeps every event. */
+    explicit thinned_series(size_t max_samples = 0) : max_samples_(max_samples) {}
+
+    /** @brief Count one event; true if it is to be sampled. */
+    bool due() noexcept { return events_++ % interval_ == 0; }
+
+    void push(T sample)
+    {
+        samples_.push_back(std::move(sample));
+        if (max_samples_ != 0 && samples_.size() > max_samples_) {
+            decimate(samples_);
+            interval_ *= 2;
+        }
+    }
+
+    /** @brief due() and push() in one, for samples that are cheap to build. */
+    void add(const T& sample)
+    {
+        if (due()) {
+            push(sample);
+        }
+    }
+
+    const std::vector<T>& samples() const noexcept { return samples_; }
+    std::vector<T> take() { return std::move(samples_); }
+
+   private:
+    size_t max_samples_;
+    uint64_t interval_ = 1;
+    uint64_t events_ = 0;
+    std::vector<T> samples_;
+};
+
+}  // namespace heapinst::analyzer
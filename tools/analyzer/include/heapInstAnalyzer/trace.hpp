@@ -0,0 +1,136 @@
+/**
+ * @file trace.hpp
+ * @brief Reading binary heapInst traces on the host.
+ *
+ * A trace is the concatenation of the 32-byte heap_inst_record_t records
+ * written by a stream port, in the target's (little-endian) byte order.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "heapInst/heapInst.h"
+
+namespace heapinst::analyzer
+{
+
+using record = heap_inst_record_t;
+
+static_assert(sizeof(record) == 32, "trace records are 32 bytes on the wire");
+
+/**
+ * @brief Sequential source of trace records.
+ */
+class record_source
+{
+   public:
+    virtual ~record_source() = default;
+
+    /** @brief Fetch the next record; false at end of trace. */
+    virtual bool next(record& out) = 0;
+};
+
+/**
+ * @brief Opens a fresh pass over the same trace, for multi-pass analyses.
+ */
+using source_factory = std::function<std::unique_ptr<record_source>()>;
+
+/**
+ * @brief Buffered reader over a trace file.
+ *
+ * Reads whole blocks of records per syscall. A trailing partial record
+ * (trace cut mid-write) is ignored and reported by truncated().
+ */
+class trace_reader : public record_source
+{
+   public:
+    /** @throws std::runtime_error if the file cannot be opened. */
+    explicit trace_reader(const std::string& path, size_t block_records = 4096);
+
+    bool next(record& out) override;
+
+    const std::string& path() const noexcept { return path_; }
+    uint64_t records_read() const noexcept { return count_; }
+    bool truncated() const noexcept { return truncated_; }
+
+   private:
+    bool fill();
+
+    std::string path_;
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file_;
+    std::vector<record> block_;
+    size_t pos_ = 0;
+    size_t end_ = 0;
+    uint64_t count_ = 0;
+    bool truncated_ = false;
+};
+
+/**
+ * @brief Consecutive trace files read as one stream, e.g. the rotated
+ * segments receive writes per device.
+ */
+class segment_reader : public record_source
+{
+   public:
+    explicit segment_reader(std::vector<std::string> paths) : paths_(std::move(paths)) {}
+
+    /** @throws std::runtime_error if a segment cannot be opened. */
+    bool next(record& out) override;
+
+    /** @brief A segment read so far ended in a partial record. */
+    bool truncated() const noexcept { return truncated_ || (reader_ && reader_->truncated()); }
+
+   private:
+    std::vector<std::string> paths_;
+    size_t index_ = 0;
+    std::unique_ptr<trace_reader> reader_;
+    bool truncated_ = false;
+};
+
+/**
+ * @brief Files of one trace: the path itself, or the .bin segments of a
+ * directory in name order.
+ * @throws std::runtime_error if a directory holds no segments.
+ */
+std::vector<std::string> trace_segments(const std::string& path);
+
+/**
+ * @brief Record source over an in-memory trace.
+ */
+class memory_source : public record_source
+{
+   public:
+    explicit memory_source(std::vector<record> records) : records_(std::move(records)) {}
+
+    bool next(record& out) override
+    {
+        if (pos_ >= records_.size()) {
+            return false;
+        }
+        out = records_[pos_++];
+        return true;
+    }
+
+    void rewind() noexcept { pos_ = 0; }
+
+   private:
+    std::vector<record> records_;
+    size_t pos_ = 0;
+};
+
+/** @brief Read a whole trace file into memory. */
+std::vector<record> read_trace(const std::string& path);
+
+/** @brief Write records as a binary trace file. */
+void write_trace(const std::string& path, const std::vector<record>& records);
+
+}  // namespace heapinst::analyzer
@@ -0,0 +1,289 @@
+/**
+ * @file address_index.cpp
+ * @brief Segment tree over block address ranges with per-node lifetimes.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/address_index.hpp"
+
+#include <algorithm>
+#include <map>
+
+namespace heapinst::analyzer
+{
+
+address_index address_index::build(record_source& source)
+{
+    address_index index;
+    heap_replay replay;
+    /* Live blocks by address; kept disjoint so lifetimes per node never overlap */
+    std::map<uint32_t, uint32_t> open;
+
+    auto end_block = [&](std::map<uint32_t, uint32_t>::iterator it, uint64_t position, uint64_t time_us) {
+        index.blocks_[it->second].until = position;
+        index.blocks_[it->second].free_us = time_us;
+        return open.erase(it);
+    };
+    auto close = [&](uint32_t ptr, uint64_t position, uint64_t time_us) {
+        auto it = open.find(ptr);
+        if (it != open.end()) {
+            end_block(it, position, time_us);
+        }
+    };
+    /* Every open block overlapping [address, end) lost its free; it ends now */
+    auto close_overlapping = [&](uint64_t address, uint64_t end, uint64_t position, uint64_t time_us) {
+        auto it = open.upper_bound(static_cast<uint32_t>(address));
+        if (it != open.begin() && index.blocks_[std::prev(it)->second].end() > address) {
+            --it;
+        }
+        while (it != open.end() && it->first < end) {
+            it = end_block(it, position, time_us);
+        }
+    };
+
+    record rec;
+    while (source.next(rec)) {
+        replay_step step = replay.apply(rec);
+        uint64_t position = replay.records();
+
+        if (rec.operation == HEAP_OP_INIT) {
+            /* Restart: every open block ends here */
+            for (const auto& [ptr, id] : open) {
+                index.blocks_[id].until = position;
+                index.blocks_[id].free_us = rec.timestamp_us;
+            }
+            open.clear();
+        } else if (rec.operation == HEAP_OP_MARKER) {
+            index.markers_.emplace_back(rec.arg1, position);
+        }
+        if (step.freed) {
+            close(step.freed->ptr, position, rec.timestamp_us);
+        }
+        if (step.allocated) {
+            block_lifetime b;
+            b.address = step.allocated->ptr;
+            b.size = step.allocated->size;
+            b.since = position;
+            b.until = block_lifetime::kLive;
+            b.alloc_us = rec.timestamp_us;
+            b.site = step.allocated->site;
+            b.tag = step.allocated->tag;
+            close_overlapping(b.address, b.end(), position, rec.timestamp_us);
+            open[b.address] = static_cast<uint32_t>(index.blocks_.size());
+            index.blocks_.push_back(b);
+        }
+        index.times_.emplace_back(rec.timestamp_us, position);
+    }
+    index.positions_ = replay.records();
+
+    for (const block_lifetime& b : index.blocks_) {
+        index.bounds_.push_back(b.address);
+        index.bounds_.push_back(b.end());
+    }
+    std::sort(index.bounds_.begin(), index.bounds_.end());
+    index.bounds_.erase(std::unique(index.bounds_.begin(), index.bounds_.end()), index.bounds_.end());
+    if (index.bounds_.size() < 2) {
+        return index;
+    }
+
+    /* Two passes: count entries per node, then fill in allocation order */
+    size_t leaves = index.bounds_.size() - 1;
+    index.offsets_.assign(4 * leaves + 1, 0);
+    for (uint32_t id = 0; id < index.blocks_.size(); id++) {
+        const block_lifetime& b = index.blocks_[id];
+        index.insert(1, 0, leaves, b.address, b.end(), id, true);
+    }
+    uint64_t total = 0;
+    for (uint64_t& slot : index.offsets_) {
+        uint64_t count = slot;
+        slot = total;
+        total += count;
+    }
+    index.ids_.resize(total);
+    index.cursor_.assign(index.offsets_.begin(), index.offsets_.end());
+    for (uint32_t id = 0; id < index.blocks_.size(); id++) {
+        const block_lifetime& b = index.blocks_[id];
+        index.insert(1, 0, leaves, b.address, b.end(), id, false);
+    }
+    index.cursor_.clear();
+    index.cursor_.shrink_to_fit();
+    return index;
+}
+
+void address_index::insert(size_t node, size_t lo, size_t hi, uint64_t a, uint64_t b, uint32_t id, bool count_only)
+{
+    /* Node covers bounds_[lo] .. bounds_[hi] */
+    if (b <= bounds_[lo] || a >= bounds_[hi]) {
+        return;
+    }
+    if (a <= bounds_[lo] && bounds_[hi] <= b) {
+        if (count_only) {
+            offsets_[node]++;
+        } else {
+            ids_[cursor_[node]++] = id;
+        }
+        return;
+    }
+    size_t mid = (lo + hi) / 2;
+    insert(2 * node, lo, mid, a, b, id, count_only);
+    insert(2 * node + 1, mid, hi, a, b, id, count_only);
+}
+
+std::optional<size_t> address_index::leaf_of(uint64_t addr) const
+{
+    if (bounds_.size() < 2 || addr < bounds_.front() || addr >= bounds_.back()) {
+        return std::nullopt;
+    }
+    return static_cast<size_t>(std::upper_bound(bounds_.begin(), bounds_.end(), addr) - bounds_.begin()) - 1;
+}
+
+template <class Fn>
+void address_index::for_path(size_t leaf, Fn&& fn) const
+{
+    size_t node = 1, lo = 0, hi = bounds_.size() - 1;
+    for (;;) {
+        fn(node);
+        if (hi - lo <= 1) {
+            return;
+        }
+        size_t mid = (lo + hi) / 2;
+        if (leaf < mid) {
+            node = 2 * node;
+            hi = mid;
+        } else {
+            node = 2 * node + 1;
+            lo = mid;
+        }
+    }
+}
+
+std::optional<uint64_t> address_index::position_of(const trace_point& point) const
+{
+    switch (point.type) {
+        case trace_point::kind::end:
+            return positions_;
+        case trace_point::kind::marker:
+            for (const auto& [id, position] : markers_) {
+                if (id == point.value) {
+                    return position;
+                }
+            }
+            return std::nullopt;
+        case trace_point::kind::time:
+        default: {
+            /* Last record at or before the timestamp */
+            auto it = std::upper_bound(times_.begin(), times_.end(), point.value,
+                                       [](uint64_t t, const std::pair<uint64_t, uint64_t>& e) { return t < e.first; });
+            return (it == times_.begin()) ? 0 : std::prev(it)->second;
+        }
+    }
+}
+
+std::optional<block_lifetime> address_index::owner_at(uint32_t addr, uint64_t position) const
+{
+    std::optional<size_t> leaf = leaf_of(addr);
+    if (!leaf) {
+        return std::nullopt;
+    }
+    std::optional<block_lifetime> owner;
+    for_path(*leaf, [&](size_t node) {
+        auto [first, last] = node_blocks(node);
+        /* Last block allocated at or before position */
+        auto it = std::upper_bound(first, last, position,
+                                   [this](uint64_t p, uint32_t id) { return p < blocks_[id].since; });
+        if (it != first && blocks_[*(it - 1)].live_at(position)) {
+            owner = blocks_[*(it - 1)];
+        }
+    });
+    return owner;
+}
+
+std::optional<block_lifetime> address_index::previous_owner(uint32_t addr, uint64_t position) const
+{
+    std::optional<size_t> leaf = leaf_of(addr);
+    if (!leaf) {
+        return std::nullopt;
+    }
+    std::optional<block_lifetime> best;
+    for_path(*leaf, [&](size_t node) {
+        auto [first, last] = node_blocks(node);
+        /* Lifetimes in a node are disjoint, so until is sorted as well */
+        auto it = std::upper_bound(first, last, position,
+                                   [this](uint64_t p, uint32_t id) { return p < blocks_[id].until; });
+        if (it != first) {
+            const block_lifetime& b = blocks_[*(it - 1)];
+            if (!best || b.until > best->until) {
+                best = b;
+            }
+        }
+    });
+    return best;
+}
+
+std::optional<block_lifetime> address_index::next_owner(uint32_t addr, uint64_t position) const
+{
+    std::optional<size_t> leaf = leaf_of(addr);
+    if (!leaf) {
+        return std::nullopt;
+    }
+    std::optional<block_lifetime> best;
+    for_path(*leaf, [&](size_t node) {
+        auto [first, last] = node_blocks(node);
+        auto it = std::upper_bound(first, last, position,
+                                   [this](uint64_t p, uint32_t id) { return p < blocks_[id].since; });
+        if (it != last) {
+            const block_lifetime& b = blocks_[*it];
+            if (!best || b.since < best->since) {
+                best = b;
+            }
+        }
+    });
+    return best;
+}
+
+std::vector<block_lifetime> address_index::query(uint64_t addr_lo, uint64_t addr_hi, uint64_t from, uint64_t to) const
+{
+    std::vector<uint32_t> hits;
+    if (bounds_.size() < 2 || addr_lo >= addr_hi || from > to) {
+        return {};
+    }
+
+    /* Iterative walk over nodes intersecting the address range */
+    struct span {
+        size_t node, lo, hi;
+    };
+    std::vector<span> stack{{1, 0, bounds_.size() - 1}};
+    while (!stack.empty()) {
+        span s = stack.back();
+        stack.pop_back();
+        if (addr_hi <= bounds_[s.lo] || addr_lo >= bounds_[s.hi]) {
+            continue;
+        }
+        auto [first, last] = node_blocks(s.node);
+        /* Live somewhere in [from, to]: until > from and since <= to */
+        auto begin = std::upper_bound(first, last, from,
+                                      [this](uint64_t p, uint32_t id) { return p < blocks_[id].until; });
+        auto end = std::upper_bound(first, last, to,
+                                    [this](uint64_t p, uint32_t id) { return p < blocks_[id].since; });
+        for (auto it = begin; it < end; ++it) {
+            hits.push_back(*it);
+        }
+        if (s.hi - s.lo > 1) {
+            size_t mid = (s.lo + s.hi) / 2;
+            stack.push_back({2 * s.node, s.lo, mid});
+            stack.push_back({2 * s.node + 1, mid, s.hi});
+        }
+    }
+
+    std::sort(hits.begin(), hits.end());
+    hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+    std::vector<block_lifetime> result;
+    result.reserve(hits.size());
+    for (uint32_t id : hits) {
+        result.push_back(blocks_[id]);
+    }
+    return result;
+}
+
+}  // namespace heapinst::analyzer
@@ -0,0 +1,229 @@
+/**
+ * @file arena.cpp
+ * @brief Program break, live bytes and headroom over time.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/arena.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+
+#include "heapInstAnalyzer/replay.hpp"
+#include "heapInstAnalyzer/thinning.hpp"
+
+namespace heapinst::analyzer
+{
+
+arena_report analyze_arena(record_source& source, const arena_options& options)
+{
+    arena_report report;
+    thinned_series<arena_sample> timeline(options.max_samples);
+    heap_replay replay;
+    uint64_t brk = 0;
+    uint64_t rss_kb = 0;
+    uint64_t anon_kb = 0;
+
+    record rec;
+    while (source.next(rec)) {
+        replay_step step = replay.apply(rec);
+        bool heap_event = step.freed || step.allocated;
+
+        switch (rec.operation) {
+            case HEAP_OP_INIT:
+                if (rec.arg3 & HEAP_INIT_FLAG_HEAP_INFO_VALID) {
+                    report.region_end = static_cast<uint64_t>(rec.arg1) + rec.arg2;
+                }
+                break;
+            case HEAP_OP_MEMMAP:
+                if (rec.arg1 == HEAP_MEMMAP_HEAP) {
+                    report.region_end = static_cast<uint64_t>(rec.arg2) + rec.arg3;
+                } else if (rec.arg1 == HEAP_MEMMAP_STACK) {
+                    report.stack_base = rec.arg2;
+                    report.stack_top = static_cast<uint64_t>(rec.arg2) + rec.arg3;
+                }
+                break;
+            case HEAP_OP_STACK_HWM:
+                if (rec.arg1 == 0 && rec.arg2 > report.stack_hwm) {
+                    report.stack_hwm = rec.arg2;
+                    heap_event = true;
+                }
+                break;
+            case HEAP_OP_SBRK:
+                report.sbrk_calls++;
+                if (rec.arg3 & HEAP_SBRK_FLAG_OBSERVED) {
+                    report.observed++;
+                }
+                if (rec.arg3 & HEAP_SBRK_FLAG_FAILED) {
+                    report.failed++;
+                } else {
+                    if (brk == 0) {
+                        /* The break before the first move is the arena base */
+                        report.arena_base = rec.arg2 - rec.arg1;
+                    }
+                    brk = rec.arg2;
+                }
+                heap_event = true;
+                break;
+            case HEAP_OP_RSS:
+                report.rss_samples++;
+                rss_kb = rec.arg1;
+                anon_kb = rec.arg2;
+                heap_event = true;
+                break;
+            default:
+                break;
+        }
+        if (!heap_event) {
+            continue;
+        }
+
+        arena_sample s{.time_us = rec.timestamp_us,
+                       .index = replay.records() - 1,
+                       .brk = brk,
+                       .arena = brk ? brk - report.arena_base : 0,
+                       .live = replay.live_bytes(),
+                       .rss_kb = rss_kb,
+                       .anon_kb = anon_kb};
+        bool headroom = brk != 0 && report.region_end != 0;
+        bool stack_gap = brk != 0 && report.stack_top > brk && report.stack_hwm <= report.stack_top;
+        if (headroom) {
+            s.headroom = static_cast<int64_t>(report.region_end - brk);
+            if (!report.has_headroom || s.headroom < report.min_headroom.headroom) {
+                report.min_headroom = s;
+            }
+            report.has_headroom = true;
+        }
+        if (stack_gap) {
+            s.stack_gap = static_cast<int64_t>(report.stack_top - report.stack_hwm - brk);
+            if (!report.has_stack_gap || s.stack_gap < report.min_stack_gap.stack_gap) {
+                report.min_stack_gap = s;
+            }
+            report.has_stack_gap = true;
+        }
+        if (s.brk > report.peak_break.brk) {
+            report.peak_break = s;
+        }
+        if (s.rss_kb > report.peak_rss.rss_kb) {
+            report.peak_rss = s;
+        }
+        report.final = s;
+        timeline.add(s);
+    }
+    report.timeline = timeline.take();
+    return report;
+}
+
+namespace
+{
+
+void print_sample(std::ostream& out, const char* label, const arena_sample& s)
+{
+    char line[200];
+    std::snprintf(line, sizeof(line),
+                  "%-18s %10" PRIu64 " us (record %" PRIu64 "): break 0x%08" PRIx64 ", arena %" PRIu64
+                  " B, live %" PRIu64 " B\n",
+                  label, s.time_us, s.index, s.brk, s.arena, s.live);
+    out << line;
+}
+
+}  // namespace
+
+void write_arena_report(const arena_report& report, std::ostream& out)
+{
+    if (report.sbrk_calls == 0 && report.rss_samples == 0) {
+        out << "no SBRK or RSS records: build the target with HEAPINST_WRAP_SBRK=ON or HEAPINST_CFG_RSS_SAMPLER\n";
+        return;
+    }
+
+    char line[200];
+    if (report.sbrk_calls != 0) {
+        std::snprintf(line, sizeof(line),
+                      "program break: %" PRIu64 " moves (%" PRIu64 " failed, %" PRIu64
+                      " observed), arena base 0x%08" PRIx64 "\n",
+                      report.sbrk_calls, report.failed, report.observed, report.arena_base);
+        out << line;
+        print_sample(out, "highest break:", report.peak_break);
+        print_sample(out, "end of trace:", report.final);
+        if (report.peak_break.arena != 0) {
+            std::snprintf(line, sizeof(line), "live at highest break: %.1f%% of the arena\n",
+                          100.0 * static_cast<double>(report.peak_break.live) /
+                              static_cast<double>(report.peak_break.arena));
+            out << line;
+        }
+
+        if (report.has_headroom) {
+            std::snprintf(line, sizeof(line),
+                          "heap region end 0x%08" PRIx64 ": minimum headroom %" PRId64 " B at %" PRIu64
+                          " us (record %" PRIu64 ")\n",
+                          report.region_end, report.min_headroom.headroom, report.min_headroom.time_us,
+                          report.min_headroom.index);
+        } else {
+            std::snprintf(line, sizeof(line), "heap region end unknown (no INIT heap info or HEAP memmap)\n");
+        }
+        out << line;
+        if (report.has_stack_gap) {
+            std::snprintf(line, sizeof(line),
+                          "core 0 stack 0x%08" PRIx64 "-0x%08" PRIx64 ", deepest 0x%08" PRIx64
+                          ": minimum gap to the break %" PRId64 " B at %" PRIu64 " us (record %" PRIu64 ")\n",
+                          report.stack_base, report.stack_top, report.stack_top - report.stack_hwm,
+                          report.min_stack_gap.stack_gap, report.min_stack_gap.time_us, report.min_stack_gap.index);
+        } else {
+            std::snprintf(line, sizeof(line), "stack headroom unknown (no STACK memmap above the break)\n");
+        }
+        out << line;
+    } else {
+        out << "program break not traced (no SBRK records)\n";
+    }
+
+    if (report.rss_samples != 0) {
+        const arena_sample& p = report.peak_rss;
+        std::snprintf(line, sizeof(line),
+                      "resident: %" PRIu64 " samples, peak %" PRIu64 " KiB (anon %" PRIu64 " KiB) at %" PRIu64
+                      " us (record %" PRIu64 "), live %" PRIu64 " B\n",
+                      report.rss_samples, p.rss_kb, p.anon_kb, p.time_us, p.index, p.live);
+        out << line;
+        if (p.anon_kb != 0) {
+            std::snprintf(line, sizeof(line), "live at peak RSS: %.1f%% of anonymous memory\n",
+                          100.0 * static_cast<double>(p.live) / static_cast<double>(p.anon_kb * 1024));
+            out << line;
+        }
+    }
+
+    out << "\n        time us      record       break     arena B      live B  headroom B  stack gap B     rss KiB    anon KiB\n";
+    for (const arena_sample& s : report.timeline) {
+        std::snprintf(line, sizeof(line),
+                      "  %13" PRIu64 "  %10" PRIu64 "  0x%08" PRIx64 "  %10" PRIu64 "  %10" PRIu64 "  %10" PRId64
+                      "  %11" PRId64 "  %10" PRIu64 "  %10" PRIu64 "\n",
+                      s.time_us, s.index, s.brk, s.arena, s.live, s.headroom, s.stack_gap, s.rss_kb, s.anon_kb);
+        out << line;
+    }
+}
+
+void write_arena_csv(const arena_report& report, std::ostream& out)
+{
+    out << "time_us,record,break,arena,live,headroom,stack_gap,rss_kb,anon_kb\n";
+    char line[200];
+    for (const arena_sample& s : report.timeline) {
+        std::snprintf(line, sizeof(line), "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",", s.time_us,
+                      s.index, s.brk, s.arena, s.live);
+        out << line;
+        if (report.has_headroom && s.brk != 0) {
+            out << s.headroom;
+        }
+        out << ",";
+        if (report.has_stack_gap && s.brk != 0) {
+            out << s.stack_gap;
+        }
+        out << ",";
+        if (s.rss_kb != 0) {
+            out << s.rss_kb << "," << s.anon_kb;
+        } else {
+            out << ",";
+        }
+        out << "\n";
+    }
+}
+
+}  // namespace heapinst::analyzer
@@ -0,0 +1,532 @@
+/**
+ * @file banks.cpp
+ * @brief Memory maps and per-bank occupancy replay.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/banks.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#include "heapInstAnalyzer/thinning.hpp"
+
+namespace heapinst::analyzer
+{
+
+namespace
+{
+
+/* RP2350 datasheet, SRAM: 8 x 64 KiB striped in two groups, 2 x 4 KiB scratch */
+constexpr const char* kRp2350Map =
+    "striped 0x20000000 0x40000 4 SRAM0 SRAM1 SRAM2 SRAM3\n"
+    "striped 0x20040000 0x40000 4 SRAM4 SRAM5 SRAM6 SRAM7\n"
+    "bank SRAM8 0x20080000 0x1000   # scratch X\n"
+    "bank SRAM9 0x20081000 0x1000   # scratch Y\n";
+
+uint64_t parse_number(const std::string& text)
+{
+    size_t used = 0;
+    uint64_t value = std::stoull(text, &used, 0);
+    if (used != text.size()) {
+        throw std::invalid_argument("bad number '" + text + "'");
+    }
+    return value;
+}
+
+/* Bytes of bank k in [0, x) of a region striped over n banks */
+uint64_t striped_prefix(uint64_t x, uint64_t stride, uint64_t n, uint64_t k)
+{
+    uint64_t period = stride * n;
+    uint64_t rest = x % period;
+    uint64_t tail = (rest > k * stride) ? std::min(rest - k * stride, stride) : 0;
+    return (x / period) * stride + tail;
+}
+
+}  // namespace
+
+memory_map memory_map::parse(std::istream& in)
+{
+    memory_map map;
+    std::string line;
+    for (size_t number = 1; std::getline(in, line); number++) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::vector<std::string> words;
+        for (std::string word; fields >> word;) {
+            words.push_back(word);
+        }
+        if (words.empty()) {
+            continue;
+        }
+        try {
+            if (words[0] == "bank" && words.size() == 4) {
+                map.add_bank(words[1], parse_number(words[2]), parse_number(words[3]));
+            } else if (words[0] == "striped" && words.size() >= 5) {
+                map.add_striped(parse_number(words[1]), parse_number(words[2]), parse_number(words[3]),
+                                std::vector<std::string>(words.begin() + 4, words.end()));
+            } else {
+                throw std::invalid_argument("expected 'bank <name> <base> <size>' or "
+                                            "'striped <base> <size> <stride> <name>...'");
+            }
+        } catch (const std::logic_error& e) {
+            throw std::invalid_argument("memory map line " + std::to_string(number) + ": " + e.what());
+        }
+    }
+    if (map.banks_.empty()) {
+        throw std::invalid_argument("memory map has no banks");
+    }
+    return map;
+}
+
+memory_map memory_map::rp2350()
+{
+    std::istringstream in(kRp2350Map);
+    return parse(in);
+}
+
+memory_map memory_map::load(const std::string& name_or_path)
+{
+    if (name_or_path == "pico2" || name_or_path == "rp2350") {
+        return rp2350();
+    }
+    std::ifstream in(name_or_path);
+    if (!in) {
+        throw std::runtime_error("cannot open memory map " + name_or_path);
+    }
+    return parse(in);
+}
+
+size_t memory_map::bank_index(const std::string& name)
+{
+    for (size_t i = 0; i < banks_.size(); i++) {
+        if (banks_[i].name == name) {
+            return i;
+        }
+    }
+    banks_.push_back({name, 0});
+    return banks_.size() - 1;
+}
+
+void memory_map::add_region(region r)
+{
+    if (r.size == 0) {
+        throw std::invalid_argument("empty region");
+    }
+    auto it = std::upper_bound(regions_.begin(), regions_.end(), r.base,
+                               [](uint64_t base, const region& other) { return base < other.base; });
+    if ((it != regions_.end() && r.base + r.size > it->base) ||
+        (it != regions_.begin() && std::prev(it)->base + std::prev(it)->size > r.base)) {
+        throw std::invalid_argument("region overlaps another");
+    }
+    regions_.insert(it, std::move(r));
+}
+
+void memory_map::add_bank(const std::string& name, uint64_t base, uint64_t size)
+{
+    region r{.base = base, .size = size, .stride = 0, .banks = {bank_index(name)}};
+    add_region(r);
+    banks_[r.banks[0]].capacity += size;
+}
+
+void memory_map::add_striped(uint64_t base, uint64_t size, uint64_t stride, const std::vector<std::string>& names)
+{
+    if (stride == 0 || names.empty()) {
+        throw std::invalid_argument("striped region needs a stride and banks");
+    }
+    region r{.base = base, .size = size, .stride = stride, .banks = {}};
+    for (const std::string& name : names) {
+        r.banks.push_back(bank_index(name));
+    }
+    add_region(r);
+    for (size_t k = 0; k < names.size(); k++) {
+        banks_[r.banks[k]].capacity += striped_prefix(size, stride, names.size(), k);
+    }
+}
+
+uint64_t memory_map::split(uint64_t begin, uint64_t end, const std::function<void(size_t, uint64_t)>& visit) const
+{
+    if (begin >= end) {
+        return 0;
+    }
+    uint64_t covered = 0;
+    auto it = std::upper_bound(regions_.begin(), regions_.end(), begin,
+                               [](uint64_t base, const region& other) { return base < other.base; });
+    if (it != regions_.begin()) {
+        --it;
+    }
+    for (; it != regions_.end() && it->base < end; ++it) {
+        uint64_t lo = std::max(begin, it->base);
+        uint64_t hi = std::min(end, it->base + it->size);
+        if (lo >= hi) {
+            continue;
+        }
+        covered += hi - lo;
+        if (it->stride == 0) {
+            visit(it->banks[0], hi - lo);
+            continue;
+        }
+        uint64_t n = it->banks.size();
+        for (uint64_t k = 0; k < n; k++) {
+            uint64_t bytes = striped_prefix(hi - it->base, it->stride, n, k) - striped_prefix(lo - it->base, it->stride, n, k);
+            if (bytes != 0) {
+                visit(it->banks[k], bytes);
+            }
+        }
+    }
+    return (end - begin) - covered;
+}
+
+namespace
+{
+
+struct site_usage {
+    double byte_us = 0.0;
+    uint64_t live = 0;
+    uint64_t peak = 0;
+};
+
+class bank_tracker
+{
+   public:
+    bank_tracker(const memory_map& map, const bank_options& options)
+        : map_(map),
+          options_(options),
+          live_(map.banks().size() + 1, 0),
+          sites_(map.banks().size()),
+          timeline_(options.max_samples)
+    {
+        report_.banks = map.banks();
+        report_.usage.resize(map.banks().size());
+        for (const memory_bank& b : map.banks()) {
+            report_.budget.sram += b.capacity;
+        }
+    }
+
+    void restart(const record& rec, uint64_t now)
+    {
+        for (const auto& [ptr, a] : blocks_) {
+            release(a, now);
+        }
+        blocks_.clear();
+        for (bank_usage& u : report_.usage) {
+            u.static_bytes = 0;
+            u.heap_capacity = 0;
+        }
+        /* The target re-emits its memory map after INIT */
+        ram_budget& b = report_.budget;
+        b.data = b.bss = b.stacks = b.scratch = b.heap_region = 0;
+        if (rec.arg3 & HEAP_INIT_FLAG_HEAP_INFO_VALID) {
+            map_.split(rec.arg1, static_cast<uint64_t>(rec.arg1) + rec.arg2, [&](size_t bank, uint64_t bytes) {
+                report_.usage[bank].heap_capacity += bytes;
+                b.heap_region += bytes;
+            });
+        }
+    }
+
+    void memmap(const record& rec)
+    {
+        uint64_t mapped = 0;
+        map_.split(rec.arg2, static_cast<uint64_t>(rec.arg2) + rec.arg3, [&](size_t bank, uint64_t bytes) {
+            if (rec.arg1 != HEAP_MEMMAP_HEAP) {
+                report_.usage[bank].static_bytes += bytes;
+            }
+            mapped += bytes;
+        });
+
+        ram_budget& b = report_.budget;
+        switch (rec.arg1) {
+            case HEAP_MEMMAP_DATA:
+                b.data += mapped;
+                break;
+            case HEAP_MEMMAP_BSS:
+                b.bss += mapped;
+                break;
+            case HEAP_MEMMAP_HEAP:
+                /* The linker symbols are more precise than INIT heap info */
+                b.heap_region = mapped;
+                break;
+            case HEAP_MEMMAP_STACK:
+            case HEAP_MEMMAP_STACK1:
+                b.stacks += mapped;
+                break;
+            case HEAP_MEMMAP_SCRATCH_X:
+            case HEAP_MEMMAP_SCRATCH_Y:
+                b.scratch += mapped;
+                break;
+            default:
+                break;
+        }
+    }
+
+    void allocate(const allocation& a, uint64_t now)
+    {
+        auto stale = blocks_.find(a.ptr);
+        if (stale != blocks_.end()) {
+            /* Its free was lost */
+            release(stale->second, now);
+        }
+        uint64_t unmapped = map_.split(a.ptr, end_of(a), [&](size_t bank, uint64_t bytes) {
+            live_[bank] += bytes;
+            mapped_live_ += bytes;
+            site_usage& s = sites_[bank][a.site.key()];
+            s.live += bytes;
+            s.peak = std::max(s.peak, s.live);
+            bank_usage& u = report_.usage[bank];
+            if (live_[bank] > u.peak_bytes) {
+                u.peak_bytes = live_[bank];
+                u.peak_time_us = now;
+            }
+        });
+        if (unmapped != 0) {
+            live_.back() += unmapped;
+            report_.unmapped_blocks++;
+        }
+        if (mapped_live_ > report_.budget.heap_peak) {
+            report_.budget.heap_peak = mapped_live_;
+            report_.budget.heap_peak_time_us = now;
+        }
+        blocks_[a.ptr] = a;
+    }
+
+    void deallocate(const allocation& a, uint64_t now)
+    {
+        release(a, now);
+        blocks_.erase(a.ptr);
+    }
+
+    void advance(uint64_t now)
+    {
+        if (!started_) {
+            report_.start_us = last_us_ = now;
+            started_ = true;
+        }
+        if (now > last_us_) {
+            for (size_t bank = 0; bank < report_.usage.size(); bank++) {
+                report_.usage[bank].mean_bytes += static_cast<double>(live_[bank]) * static_cast<double>(now - last_us_);
+            }
+            last_us_ = now;
+        }
+    }
+
+    void sample(uint64_t now)
+    {
+        if (timeline_.due()) {
+            timeline_.push({now, live_});
+        }
+    }
+
+    bank_report finish()
+    {
+        for (const auto& [ptr, a] : blocks_) {
+            /* Still live: charge byte-time up to the end */
+            map_.split(a.ptr, end_of(a), [&](size_t bank, uint64_t bytes) {
+                sites_[bank][a.site.key()].byte_us += static_cast<double>(bytes) * static_cast<double>(last_us_ - a.time_us);
+            });
+        }
+        report_.end_us = last_us_;
+        report_.timeline = timeline_.take();
+        double span = static_cast<double>(report_.end_us - report_.start_us);
+        for (size_t bank = 0; bank < report_.usage.size(); bank++) {
+            bank_usage& u = report_.usage[bank];
+            u.live_bytes = live_[bank];
+            u.mean_bytes = (span > 0) ? u.mean_bytes / span : static_cast<double>(live_[bank]);
+            for (const auto& [key, s] : sites_[bank]) {
+                u.hot.push_back({callsite::from_key(key), s.byte_us, s.peak});
+            }
+            std::sort(u.hot.begin(), u.hot.end(), [](const bank_site& a, const bank_site& b) {
+                if (a.byte_us != b.byte_us) {
+                    return a.byte_us > b.byte_us;
+                }
+                return a.peak_bytes > b.peak_bytes;
+            });
+            if (u.hot.size() > options_.top) {
+                u.hot.resize(options_.top);
+            }
+        }
+        return std::move(report_);
+    }
+
+   private:
+    uint64_t end_of(const allocation& a) const
+    {
+        uint32_t bytes = (options_.usable_size && a.usable > a.size) ? a.usable : a.size;
+        return static_cast<uint64_t>(a.ptr) + bytes;
+    }
+
+    void release(const allocation& a, uint64_t now)
+    {
+        uint64_t unmapped = map_.split(a.ptr, end_of(a), [&](size_t bank, uint64_t bytes) {
+            live_[bank] -= std::min(live_[bank], bytes);
+            mapped_live_ -= std::min(mapped_live_, bytes);
+            site_usage& s = sites_[bank][a.site.key()];
+            s.live -= std::min(s.live, bytes);
+            s.byte_us += static_cast<double>(bytes) * static_cast<double>(now - std::min(now, a.time_us));
+        });
+        live_.back() -= std::min(live_.back(), unmapped);
+    }
+
+    const memory_map& map_;
+    bank_options options_;
+    bank_report report_;
+    std::vector<uint64_t> live_; /* per bank, then unmapped */
+    uint64_t mapped_live_ = 0;   /* sum over the banks */
+    std::vector<std::unordered_map<uint64_t, site_usage>> sites_;
+    std::unordered_map<uint32_t, allocation> blocks_;
+    uint64_t last_us_ = 0;
+    thinned_series<bank_sample> timeline_;
+    bool started_ = false;
+};
+
+}  // namespace
+
+bank_report analyze_banks(record_source& source, const memory_map& map, const bank_options& options)
+{
+    bank_tracker tracker(map, options);
+    heap_replay replay;
+    record rec;
+    while (source.next(rec)) {
+        replay_step step = replay.apply(rec);
+        tracker.advance(rec.timestamp_us);
+
+        if (rec.operation == HEAP_OP_INIT) {
+            tracker.restart(rec, rec.timestamp_us);
+            tracker.sample(rec.timestamp_us);
+            continue;
+        }
+        if (rec.operation == HEAP_OP_MEMMAP) {
+            tracker.memmap(rec);
+            continue;
+        }
+        if (step.freed) {
+            tracker.deallocate(*step.freed, rec.timestamp_us);
+        }
+        if (step.allocated) {
+            tracker.allocate(*step.allocated, rec.timestamp_us);
+        }
+        if (step.freed || step.allocated) {
+            tracker.sample(rec.timestamp_us);
+        }
+    }
+    return tracker.finish();
+}
+
+namespace
+{
+
+double share(uint64_t part, uint64_t whole)
+{
+    return whole ? 100.0 * static_cast<double>(part) / static_cast<double>(whole) : 0.0;
+}
+
+void write_budget(const ram_budget& b, std::ostream& out)
+{
+    if (b.sram == 0 || (b.static_bytes() == 0 && b.heap_region == 0)) {
+        out << "\nRAM budget unknown (no MEMMAP records or INIT heap info inside the map)\n";
+        return;
+    }
+
+    char line[200];
+    uint64_t assigned = b.static_bytes() + b.heap_region;
+    std::snprintf(line, sizeof(line), "\nRAM budget (%" PRIu64 " B of SRAM):\n", b.sram);
+    out << line;
+    const std::pair<const char*, uint64_t> rows[] = {
+        {".data", b.data},
+        {".bss", b.bss},
+        {"stacks", b.stacks},
+        {"scratch X/Y", b.scratch},
+        {"static total", b.static_bytes()},
+        {"heap region", b.heap_region},
+        {"unassigned", b.sram - std::min(b.sram, assigned)},
+    };
+    for (const auto& [name, bytes] : rows) {
+        std::snprintf(line, sizeof(line), "  %-13s %9" PRIu64 " B %6.1f%%\n", name, bytes, share(bytes, b.sram));
+        out << line;
+    }
+    std::snprintf(line, sizeof(line), "  %-13s %9" PRIu64 " B %6.1f%%  (%.1f%% of the heap region, at %" PRIu64 " us)\n",
+                  "heap peak", b.heap_peak, share(b.heap_peak, b.sram), share(b.heap_peak, b.heap_region),
+                  b.heap_peak_time_us);
+    out << line;
+
+    if (b.heap_region == 0) {
+        return;
+    }
+    /* Static and heap share the same SRAM: shrinking one grows the other */
+    if (b.heap_peak * 10 >= b.heap_region * 9) {
+        std::snprintf(line, sizeof(line),
+                      "suggestion: the heap peaks within 10%% of its region; static buffers needed only part of\n"
+                      "  the time (%" PRIu64 " B in .data/.bss) can be allocated on demand to leave it room\n",
+                      b.data + b.bss);
+        out << line;
+    } else if (b.heap_peak * 2 < b.heap_region) {
+        std::snprintf(line, sizeof(line),
+                      "suggestion: %" PRIu64 " B of the heap region are never used; allocations that live for the\n"
+                      "  whole run can move to static storage, or the space can go to stacks or .bss\n",
+                      b.heap_region - b.heap_peak);
+        out << line;
+    }
+}
+
+}  // namespace
+
+void write_bank_report(const bank_report& report, const symbolizer& symbols, std::ostream& out)
+{
+    char line[200];
+    std::snprintf(line, sizeof(line), "%" PRIu64 " us of trace, %zu samples\n\n", report.end_us - report.start_us,
+                  report.timeline.size());
+    out << line;
+    out << "  bank      capacity    static      heap      peak    mean   end live\n";
+    for (size_t bank = 0; bank < report.banks.size(); bank++) {
+        const memory_bank& b = report.banks[bank];
+        const bank_usage& u = report.usage[bank];
+        double pct = b.capacity ? 100.0 * static_cast<double>(u.peak_bytes) / static_cast<double>(b.capacity) : 0.0;
+        std::snprintf(line, sizeof(line),
+                      "  %-8s %9" PRIu64 " %9" PRIu64 " %9" PRIu64 " %9" PRIu64 " %7.0f %10" PRIu64 "   peak %5.1f%% at %" PRIu64
+                      " us\n",
+                      b.name.c_str(), b.capacity, u.static_bytes, u.heap_capacity, u.peak_bytes, u.mean_bytes,
+                      u.live_bytes, pct, u.peak_time_us);
+        out << line;
+    }
+    if (report.unmapped_blocks != 0) {
+        out << "warning: " << report.unmapped_blocks << " allocations lie (partly) outside every bank\n";
+    }
+    write_budget(report.budget, out);
+
+    out << "\nhot callsites per bank (byte-seconds held, peak bytes):\n";
+    for (size_t bank = 0; bank < report.banks.size(); bank++) {
+        const bank_usage& u = report.usage[bank];
+        if (u.hot.empty()) {
+            continue;
+        }
+        out << "  " << report.banks[bank].name << ":\n";
+        for (const bank_site& s : u.hot) {
+            std::snprintf(line, sizeof(line), "    %12.3f B*s %9" PRIu64 " B  ", s.byte_us / 1e6, s.peak_bytes);
+            out << line << symbols.name(s.site) << "\n";
+        }
+    }
+}
+
+void write_bank_csv(const bank_report& report, std::ostream& out)
+{
+    out << "time_us";
+    for (const memory_bank& b : report.banks) {
+        out << "," << b.name;
+    }
+    out << ",unmapped\n";
+    for (const bank_sample& s : report.timeline) {
+        out << s.time_us;
+        for (uint64_t bytes : s.bytes) {
+            out << "," << bytes;
+        }
+        out << "\n";
+    }
+}
+
+}  // namespace heapinst::analyzer
@@ -0,0 +1,119 @@
+/**
+ * @file cli.cpp
+ * @brief Argument parsing and common options.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "cli.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace heapinst::analyzer::cli
+{
+
+args::args(int argc, char** argv, std::initializer_list<const char*> flags)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string token = argv[i];
+        if (token == "-o") {
+            token = "--output";
+        }
+        if (token.size() > 2 && token.rfind("--", 0) == 0) {
+            std::string name = token.substr(2);
+            size_t eq = name.find('=');
+            if (eq != std::string::npos) {
+                options_.emplace(name.substr(0, eq), name.substr(eq + 1));
+            } else if (std::find_if(flags.begin(), flags.end(), [&](const char* f) { return name == f; }) !=
+                       flags.end()) {
+                options_.emplace(name, "");
+            } else if (i + 1 < argc) {
+                options_.emplace(name, argv[++i]);
+            } else {
+                throw std::invalid_argument("option --" + name + " needs a value");
+            }
+        } else {
+            positional_.push_back(token);
+        }
+    }
+}
+
+std::optional<std::string> args::get(const std::string& name) const
+{
+    auto it = options_.find(name);
+    if (it == options_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::string args::get_or(const std::string& name, const std::string& fallback) const
+{
+    return get(name).value_or(fallback);
+}
+
+std::vector<std::string> args::get_all(const std::string& name) const
+{
+    std::vector<std::string> values;
+    auto [first, last] = options_.equal_range(name);
+    for (auto it = first; it != last; ++it) {
+        values.push_back(it->second);
+    }
+    return values;
+}
+
+const std::string& args::trace() const
+{
+    if (positional_.size() != 1) {
+        throw std::invalid_argument("expected exactly one trace file");
+    }
+    return positional_[0];
+}
+
+source_factory trace_factory(const args& a)
+{
+    std::string path = a.trace();
+    return [path]() -> std::unique_ptr<record_source> { return std::make_unique<trace_reader>(path); };
+}
+
+symbolizer load_symbols(const args& a)
+{
+    symbolizer symbols;
+    for (const std::string& path : a.get_all("symbols")) {
+        symbols.load_nm(path);
+    }
+    for (const std::string& path : a.get_all("sites")) {
+        symbols.load_site_table(path);
+    }
+    return symbols;
+}
+
+heap_profile load_profile(const args& a, const trace_point& point)
+{
+    trace_reader reader(a.trace());
+    std::optional<std::string> spill = a.get("spill");
+    if (!spill) {
+        return build_heap_profile(reader, point);
+    }
+    spill_options options;
+    options.memory_bytes = static_cast<size_t>(std::stoull(*spill)) << 20;
+    options.temp_dir = a.get_or("tmpdir", "");
+    return build_heap_profile_spilled(reader, point, options);
+}
+
+std::ostream& open_output(const args& a, std::ofstream& file, bool binary)
+{
+    std::optional<std::string> path = a.get("output");
+    if (!path || *path == "-") {
+        return std::cout;
+    }
+    file.open(*path, binary ? std::ios::out | std::ios::binary : std::ios::out);
+    if (!file) {
+        throw std::runtime_error("cannot create " + *path);
+    }
+    return file;
+}
+
+}  // namespace heapinst::analyzer::cli
@@ -0,0 +1,94 @@
+/**
+ * @file cli.hpp
+ * @brief Shared plumbing of the heapinst_analyze subcommands.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <initializer_list>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "heapInstAnalyzer/profile.hpp"
+#include "heapInstAnalyzer/symbols.hpp"
+
+namespace heapinst::analyzer::cli
+{
+
+/**
+ * @brief "--name value" options, boolean "--flag"s and positionals.
+ */
+class args
+{
+   public:
+    /** @throws std::invalid_argument on an option missing its value. */
+    args(int argc, char** argv, std::initializer_list<const char*> flags = {});
+
+    bool has(const std::string& name) const { return options_.count(name) != 0; }
+    std::optional<std::string> get(const std::string& name) const;
+    std::string get_or(const std::string& name, const std::string& fallback) const;
+    std::vector<std::string> get_all(const std::string& name) const;
+    const std::vector<std::string>& positional() const noexcept { return positional_; }
+
+    /** @brief The single trace argument. @throws std::invalid_argument */
+    const std::string& trace() const;
+
+   private:
+    std::multimap<std::string, std::string> options_;
+    std::vector<std::string> positional_;
+};
+
+/** @brief Re-openable reader over the trace argument, for multi-pass commands. */
+source_factory trace_factory(const args& a);
+
+/** @brief Symbolizer from --symbols (nm output) and --sites (site tables). */
+symbolizer load_symbols(const args& a);
+
+/**
+ * @brief Per-callsite profile of the trace argument up to point; out of
+ * core with --spill <MiB> [--tmpdir DIR].
+ */
+heap_profile load_profile(const args& a, const trace_point& point);
+
+/**
+ * @brief The stream selected by -o/--output, stdout by default.
+ *
+ * file keeps the opened file alive for the caller.
+ */
+std::ostream& open_output(const args& a, std::ofstream& file, bool binary = false);
+
+/* POSIX sockets for the streaming commands (net.cpp) */
+void set_nonblocking(int fd);
+
+/** @brief Bound nonblocking IPv4 socket, listening if SOCK_STREAM. */
+int bind_socket(int type, const std::string& host, uint16_t port);
+
+/** @brief "host:port" or "port". @throws std::invalid_argument */
+std::pair<std::string, uint16_t> parse_endpoint(const std::string& text, const std::string& default_host);
+
+/* Subcommands: argv[0] is the subcommand name */
+int run_pprof(const args& a);
+int run_massif(const args& a);
+int run_heaptrack(const args& a);
+int run_folded(const args& a);
+int run_peak(const args& a);
+int run_minheap(const args& a);
+int run_whatwas(const args& a);
+int run_chains(const args& a);
+int run_frag(const args& a);
+int run_arena(const args& a);
+int run_banks(const args& a);
+int run_fleet(const args& a);
+int run_live(const args& a);
+int run_receive(const args& a);
+int run_merge(const args& a);
+
+}  // namespace heapinst::analyzer::cli
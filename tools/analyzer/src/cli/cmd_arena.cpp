@@ -0,0 +1,34 @@
+/**
+ * @file cmd_arena.cpp
+ * @brief heapinst_analyze arena: program break, live bytes and headroom.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <string>
+
+#include "cli.hpp"
+#include "heapInstAnalyzer/arena.hpp"
+
+namespace heapinst::analyzer::cli
+{
+
+int run_arena(const args& a)
+{
+    arena_options options;
+    options.max_samples = std::stoul(a.get_or("samples", "200"));
+
+    trace_reader reader(a.trace());
+    arena_report report = analyze_arena(reader, options);
+
+    std::ofstream file;
+    std::ostream& out = open_output(a, file);
+    if (a.has("csv")) {
+        write_arena_csv(report, out);
+    } else {
+        write_arena_report(report, out);
+    }
+    return 0;
+}
+
+}  // namespace heapinst::analyzer::cli
@@ -0,0 +1,38 @@
+/**
+ * @file cmd_banks.cpp
+ * @brief heapinst_analyze banks: per-SRAM-bank heap occupancy.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <string>
+
+#include "cli.hpp"
+#include "heapInstAnalyzer/banks.hpp"
+
+namespace heapinst::analyzer::cli
+{
+
+int run_banks(const args& a)
+{
+    bank_options options;
+    options.top = std::stoul(a.get_or("top", "5"));
+    options.max_samples = std::stoul(a.get_or("samples", "200"));
+    options.usable_size = !a.has("requested");
+    memory_map map = memory_map::load(a.get_or("map", "pico2"));
+    symbolizer symbols = load_symbols(a);
+
+    trace_reader reader(a.trace());
+    bank_report report = analyze_banks(reader, map, options);
+
+    std::ofstream file;
+    std::ostream& out = open_output(a, file);
+    if (a.has("csv")) {
+        write_bank_csv(report, out);
+    } else {
+        write_bank_report(report, symbols, out);
+    }
+    return 0;
+}
+
+}  // namespace heapinst::analyzer::cli
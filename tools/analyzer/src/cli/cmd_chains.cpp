@@ -0,0 +1,31 @@
+/**
+ * @file cmd_chains.cpp
+ * @brief heapinst_analyze chains: realloc growth chains.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <string>
+
+#include "cli.hpp"
+#include "heapInstAnalyzer/realloc_chains.hpp"
+
+namespace heapinst::analyzer::cli
+{
+
+int run_chains(const args& a)
+{
+    chain_options options;
+    options.top = std::stoul(a.get_or("top", "20"));
+    options.min_reallocs = std::stoull(a.get_or("min-reallocs", "1"));
+    symbolizer symbols = load_symbols(a);
+
+    trace_reader reader(a.trace());
+    chain_report report = analyze_realloc_chains(reader, options);
+
+    std::ofstream file;
+    write_chain_report(report, symbols, options.top, open_output(a, file));
+    return 0;
+}
+
+}  // namespace heapinst::analyzer::cli
@@ -0,0 +1,38 @@
+/**
+ * @file cmd_fleet.cpp
+ * @brief heapinst_analyze fleet: parallel summary of many traces.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <stdexcept>
+#include <string>
+
+#include "cli.hpp"
+#include "heapInstAnalyzer/fleet.hpp"
+
+namespace heapinst::analyzer::cli
+{
+
+int run_fleet(const args& a)
+{
+    std::vector<std::string> files = collect_trace_files(a.positional());
+    if (files.empty()) {
+        throw std::invalid_argument("no trace files given");
+    }
+
+    fleet_options options;
+    options.jobs = static_cast<unsigned>(std::stoul(a.get_or("jobs", "0")));
+    options.threshold = std::stod(a.get_or("threshold", "3.5"));
+    options.alpha = std::stod(a.get_or("accuracy", "0.01"));
+    size_t top = std::stoul(a.get_or("top", "20"));
+    symbolizer symbols = load_symbols(a);
+
+    fleet_report report = analyze_fleet(files, options);
+
+    std::ofstream file;
+    write_fleet_report(report, symbols, top, a.has("devices"), open_output(a, file));
+    return report.failed_files == files.size() ? 1 : 0;
+}
+
+}  // namespace heapinst::analyzer::cli
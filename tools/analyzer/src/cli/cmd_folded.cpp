@@ -0,0 +1,29 @@
+/**
+ * @file cmd_folded.cpp
+ * @brief heapinst_analyze folded: folded stacks for flame graphs.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "cli.hpp"
+#include "heapInstAnalyzer/folded.hpp"
+
+namespace heapinst::analyzer::cli
+{
+
+int run_folded(const args& a)
+{
+    folded_options options;
+    options.weight = parse_folded_weight(a.get_or("weight", "bytes"));
+    options.tag_frames = a.has("tags");
+    trace_point point = trace_point::parse(a.get_or("at", "end"));
+    symbolizer symbols = load_symbols(a);
+
+    heap_profile profile = load_profile(a, point);
+
+    std::ofstream file;
+    write_folded(profile, symbols, options, open_output(a, file));
+    return 0;
+}
+
+}  // namespace heapinst::analyzer::cli
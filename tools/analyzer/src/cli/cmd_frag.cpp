@@ -0,0 +1,40 @@
+/**
+ * @file cmd_frag.cpp
+ * @brief heapinst_analyze frag: fragmentation timeline of the heap region.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <stdexcept>
+#include <string>
+
+#include "cli.hpp"
+#include "heapInstAnalyzer/fragmentation.hpp"
+
+namespace heapinst::analyzer::cli
+{
+
+int run_frag(const args& a)
+{
+    fragmentation_options options;
+    options.heap_base = std::stoull(a.get_or("base", "0"), nullptr, 0);
+    options.heap_size = std::stoull(a.get_or("size", "0"), nullptr, 0);
+    options.max_samples = std::stoul(a.get_or("samples", "200"));
+    options.usable_size = !a.has("requested");
+    if (a.has("base") && options.heap_size == 0) {
+        throw std::invalid_argument("--base needs --size");
+    }
+
+    fragmentation_report report = analyze_fragmentation(trace_factory(a), options);
+
+    std::ofstream file;
+    std::ostream& out = open_output(a, file);
+    if (a.has("csv")) {
+        write_fragmentation_csv(report, out);
+    } else {
+        write_fragmentation_report(report, out);
+    }
+    return 0;
+}
+
+}  // namespace heapinst::analyzer::cli
@@ -0,0 +1,27 @@
+/**
+ * @file cmd_heaptrack.cpp
+ * @brief heapinst_analyze heaptrack: data file for heaptrack_gui.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "cli.hpp"
+#include "heapInstAnalyzer/heaptrack.hpp"
+
+namespace heapinst::analyzer::cli
+{
+
+int run_heaptrack(const args& a)
+{
+    heaptrack_options options;
+    options.cmd = a.trace();
+    options.module = a.get_or("module", options.module);
+    symbolizer symbols = load_symbols(a);
+
+    trace_reader reader(a.trace());
+    std::ofstream file;
+    write_heaptrack(reader, symbols, options, open_output(a, file));
+    return 0;
+}
+
+}  // namespace heapinst::analyzer::cli
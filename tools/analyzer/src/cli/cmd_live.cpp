@@ -0,0 +1,417 @@
+/**
+ * @file cmd_live.cpp
+ * @brief heapinst_analyze live: browser dashboard for a running target.
+ *
+ * Records come from a trace file that is still being written (followed
+ * like tail -f, restarting when it is truncated), from UDP datagrams of
+ * whole records or frames (heapInstFrame.h), or from TCP connections
+ * carrying the raw record stream. A single poll() loop feeds them into a
+ * live_state and serves, on a local HTTP port:
+ *
+ *   /          the dashboard page
+ *   /snapshot  the full state as JSON
+ *   /events    Server-Sent Events: a full snapshot, then one delta per
+ *              --interval, only when something changed
+ *
+ * Slow subscribers are dropped rather than allowed to buffer without bound.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <stdexcept>
+#include <string>
+
+#include "cli.hpp"
+#include "heapInstAnalyzer/live.hpp"
+#include "heapInstAnalyzer/receiver.hpp"
+
+namespace heapinst::analyzer::cli
+{
+
+namespace
+{
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 /* SIGPIPE is ignored instead */
+#endif
+
+constexpr size_t kMaxRequest = 8192;
+constexpr size_t kMaxBacklog = 1 << 20; /* bytes queued for one subscriber */
+
+volatile std::sig_atomic_t g_stop = 0;
+
+const char kPage[] = R"(<!doctype html>
+<html><head><meta charset="utf-8"><title>heapInst live</title>
+<style>
+body{font:14px monospace;margin:1em;background:#fafafa}
+table{border-collapse:collapse}td,th{padding:2px 10px;text-align:right}
+td.name{text-align:left}canvas{border:1px solid #ccc;background:#fff}
+</style></head><body>
+<h3>heapInst live <span id="status">connecting</span></h3>
+<canvas id="chart" width="800" height="160"></canvas>
+<table id="values"></table>
+<h4>top callsites (live bytes)</h4>
+<table><thead><tr><th>bytes</th><th>blocks</th><th>callsite</th></tr></thead><tbody id="top"></tbody></table>
+<script>
+const values = {}, top = {}, history = [];
+let order = [];
+function render() {
+  document.getElementById("values").innerHTML = Object.keys(values).map(k =>
+    `<tr><td class="name">${k}</td><td>${Number(values[k]).toLocaleString()}</td></tr>`).join("");
+  document.getElementById("top").innerHTML = order.filter(k => top[k]).map(k =>
+    `<tr><td>${top[k].bytes.toLocaleString()}</td><td>${top[k].count}</td><td class="name"></td></tr>`).join("");
+  const names = document.querySelectorAll("#top td.name");
+  order.filter(k => top[k]).forEach((k, i) => names[i].textContent = top[k].name);
+  const c = document.getElementById("chart").getContext("2d"), w = c.canvas.width, h = c.canvas.height;
+  const cap = Math.max(values.heap_size || 0, ...history, 1);
+  c.clearRect(0, 0, w, h); c.beginPath();
+  history.forEach((v, i) => c.lineTo(i * w / 400, h - v / cap * h)); c.stroke();
+}
+const events = new EventSource("/events");
+events.onopen = () => document.getElementById("status").textContent = "live";
+events.onerror = () => document.getElementById("status").textContent = "disconnected";
+events.onmessage = e => {
+  const d = JSON.parse(e.data);
+  if (d.full) { for (const k in values) delete values[k]; for (const k in top) delete top[k]; }
+  Object.assign(values, d.values);
+  d.top.set.forEach(s => top[s.key] = s);
+  order = d.top.order;
+  for (const k in top) if (!order.includes(k)) delete top[k];
+  history.push(values.live_bytes || 0); if (history.length > 400) history.shift();
+  render();
+};
+</script></body></html>
+)";
+
+/* Splits a byte stream into records, keeping partial ones for later */
+class record_splitter
+{
+   public:
+    template <class Fn>
+    void feed(const char* data, size_t len, Fn&& apply)
+    {
+        pending_.append(data, len);
+        size_t used = 0;
+        for (; pending_.size() - used >= sizeof(record); used += sizeof(record)) {
+            record rec;
+            std::memcpy(&rec, pending_.data() + used, sizeof(rec));
+            apply(rec);
+        }
+        pending_.erase(0, used);
+    }
+    void clear() { pending_.clear(); }
+
+   private:
+    std::string pending_;
+};
+
+struct client {
+    int fd = -1;
+    bool subscriber = false;
+    std::string in;
+    std::string out;
+    live_view view;
+};
+
+struct tcp_source {
+    int fd = -1;
+    record_splitter splitter;
+};
+
+class dashboard
+{
+   public:
+    dashboard(live_state& state, const symbolizer& symbols) : state_(state), symbols_(symbols) {}
+
+    void accept_clients(int listen_fd)
+    {
+        for (;;) {
+            int fd = ::accept(listen_fd, nullptr, nullptr);
+            if (fd < 0) {
+                return;
+            }
+            set_nonblocking(fd);
+            clients_.push_back({});
+            clients_.back().fd = fd;
+        }
+    }
+
+    void add_poll(std::vector<pollfd>& fds) const
+    {
+        for (const client& c : clients_) {
+            /* Subscribers are polled for input only to notice disconnects */
+            fds.push_back({c.fd, static_cast<short>(POLLIN | (c.out.empty() ? 0 : POLLOUT)), 0});
+        }
+    }
+
+    void service(const std::vector<pollfd>& fds, size_t first)
+    {
+        size_t i = first;
+        for (auto it = clients_.begin(); it != clients_.end(); ++i) {
+            /* Clients accepted this round have no pollfd yet */
+            bool keep = service_one(*it, i < fds.size() ? fds[i].revents : 0);
+            if (!keep) {
+                ::close(it->fd);
+                it = clients_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    /* One publishing tick: every subscriber gets its own delta */
+    void publish()
+    {
+        live_sample sample = state_.sample();
+        for (client& c : clients_) {
+            if (!c.subscriber) {
+                continue;
+            }
+            std::string delta = live_delta_json(sample, c.view, symbols_);
+            if (!delta.empty()) {
+                c.out += "data: " + delta + "\n\n";
+            }
+        }
+    }
+
+   private:
+    bool service_one(client& c, short revents)
+    {
+        if (revents & (POLLERR | POLLNVAL)) {
+            return false;
+        }
+        if (revents & (POLLIN | POLLHUP)) {
+            char buffer[2048];
+            ssize_t n = ::read(c.fd, buffer, sizeof(buffer));
+            if (n <= 0) {
+                return n < 0 && (errno == EAGAIN || errno == EINTR);
+            }
+            if (!c.subscriber) {
+                c.in.append(buffer, static_cast<size_t>(n));
+                if (c.in.size() > kMaxRequest) {
+                    return false;
+                }
+                if (c.in.find("\r\n\r\n") != std::string::npos) {
+                    respond(c);
+                }
+            }
+        }
+        if (!c.out.empty()) {
+            ssize_t n = ::send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+            if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                return false;
+            }
+            c.out.erase(0, n > 0 ? static_cast<size_t>(n) : 0);
+        }
+        if (c.out.size() > kMaxBacklog) {
+            return false; /* subscriber cannot keep up */
+        }
+        /* Plain requests close once answered */
+        return c.subscriber || !c.out.empty() || c.in.find("\r\n\r\n") == std::string::npos;
+    }
+
+    void respond(client& c)
+    {
+        std::string path;
+        if (c.in.rfind("GET ", 0) == 0) {
+            path = c.in.substr(4, c.in.find(' ', 4) - 4);
+        }
+        c.in = "\r\n\r\n"; /* answered */
+
+        auto reply = [&](const char* status, const char* type, const std::string& body) {
+            c.out = std::string("HTTP/1.1 ") + status + "\r\nContent-Type: " + type +
+                    "\r\nCache-Control: no-store\r\nConnection: close\r\nContent-Length: " + std::to_string(body.size()) +
+                    "\r\n\r\n" + body;
+        };
+        if (path == "/" || path == "/index.html") {
+            reply("200 OK", "text/html; charset=utf-8", kPage);
+        } else if (path == "/snapshot") {
+            live_view fresh;
+            reply("200 OK", "application/json", live_delta_json(state_.sample(), fresh, symbols_));
+        } else if (path == "/events") {
+            c.subscriber = true;
+            c.out = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-store\r\n"
+                    "Connection: keep-alive\r\n\r\n";
+            c.out += "data: " + live_delta_json(state_.sample(), c.view, symbols_) + "\n\n";
+        } else {
+            reply("404 Not Found", "text/plain", "not found\n");
+        }
+    }
+
+    live_state& state_;
+    const symbolizer& symbols_;
+    std::list<client> clients_;
+};
+
+}  // namespace
+
+int run_live(const args& a)
+{
+    live_options options;
+    options.top = std::stoul(a.get_or("top", "10"));
+    options.heap_base = std::stoull(a.get_or("base", "0"), nullptr, 0);
+    options.heap_size = std::stoull(a.get_or("size", "0"), nullptr, 0);
+    auto interval = std::chrono::milliseconds(std::stoul(a.get_or("interval", "250")));
+    auto [http_host, http_port] = parse_endpoint(a.get_or("http", "127.0.0.1:8080"), "127.0.0.1");
+    symbolizer symbols = load_symbols(a);
+
+    int sources = (a.positional().empty() ? 0 : 1) + (a.has("udp") ? 1 : 0) + (a.has("tcp") ? 1 : 0);
+    if (sources != 1) {
+        throw std::invalid_argument("give exactly one of a trace file, --udp or --tcp");
+    }
+
+    live_state state(options);
+    dashboard board(state, symbols);
+    record_splitter file_splitter;
+    auto apply = [&](const record& rec) { state.apply(rec); };
+
+    int http_fd = bind_socket(SOCK_STREAM, http_host, http_port);
+    int udp_fd = -1, tcp_fd = -1, file_fd = -1;
+    std::string path;
+    off_t file_offset = 0;
+    if (a.has("udp")) {
+        auto [host, port] = parse_endpoint(*a.get("udp"), "0.0.0.0");
+        udp_fd = bind_socket(SOCK_DGRAM, host, port);
+    } else if (a.has("tcp")) {
+        auto [host, port] = parse_endpoint(*a.get("tcp"), "0.0.0.0");
+        tcp_fd = bind_socket(SOCK_STREAM, host, port);
+    } else {
+        path = a.trace();
+    }
+    std::list<tcp_source> tcp_sources;
+    uint64_t bad_datagrams = 0;
+    frame_decoder frames([&](const heap_inst_frame_header_t&, const record* records, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            state.apply(records[i]);
+        }
+    });
+
+    g_stop = 0;
+    std::signal(SIGINT, [](int) { g_stop = 1; });
+    std::signal(SIGTERM, [](int) { g_stop = 1; });
+    std::signal(SIGPIPE, SIG_IGN);
+    std::cerr << "heapinst_analyze live: http://" << http_host << ":" << http_port << "/\n";
+
+    auto next_tick = std::chrono::steady_clock::now() + interval;
+    std::vector<pollfd> fds;
+    std::vector<char> buffer(1 << 16);
+    while (!g_stop) {
+        fds.clear();
+        fds.push_back({http_fd, POLLIN, 0});
+        fds.push_back({udp_fd >= 0 ? udp_fd : tcp_fd, POLLIN, 0});
+        for (const tcp_source& s : tcp_sources) {
+            fds.push_back({s.fd, POLLIN, 0});
+        }
+        size_t first_client = fds.size();
+        board.add_poll(fds);
+
+        /* Regular files are always "readable": follow them on a short timer */
+        auto now = std::chrono::steady_clock::now();
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_tick - now).count();
+        if (!path.empty()) {
+            wait = std::min<long long>(wait, 20);
+        }
+        int ready = ::poll(fds.data(), fds.size(), static_cast<int>(std::max<long long>(wait, 0)));
+        if (ready < 0 && errno != EINTR) {
+            throw std::runtime_error(std::string("poll: ") + std::strerror(errno));
+        }
+
+        if (fds[0].revents & POLLIN) {
+            board.accept_clients(http_fd);
+        }
+        if (udp_fd >= 0 && (fds[1].revents & POLLIN)) {
+            for (ssize_t n; (n = ::recv(udp_fd, buffer.data(), buffer.size(), 0)) > 0;) {
+                uint32_t magic = 0;
+                std::memcpy(&magic, buffer.data(), std::min(sizeof(magic), static_cast<size_t>(n)));
+                if (magic == HEAP_INST_FRAME_MAGIC) {
+                    /* Framed by the UDP stream port */
+                    frames.feed_datagram(buffer.data(), static_cast<size_t>(n));
+                    continue;
+                }
+                /* Otherwise a datagram carries whole records */
+                if (n % sizeof(record) != 0) {
+                    bad_datagrams++;
+                }
+                record_splitter datagram;
+                datagram.feed(buffer.data(), static_cast<size_t>(n), apply);
+            }
+        }
+        size_t i = 2;
+        for (auto it = tcp_sources.begin(); it != tcp_sources.end(); ++i) {
+            bool closed = false;
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                ssize_t n;
+                while ((n = ::read(it->fd, buffer.data(), buffer.size())) > 0) {
+                    it->splitter.feed(buffer.data(), static_cast<size_t>(n), apply);
+                }
+                closed = (n == 0 || (errno != EAGAIN && errno != EINTR));
+            }
+            if (closed) {
+                ::close(it->fd);
+                it = tcp_sources.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        /* After the loop above: new sources have no pollfd this round */
+        if (tcp_fd >= 0 && (fds[1].revents & POLLIN)) {
+            for (int fd; (fd = ::accept(tcp_fd, nullptr, nullptr)) >= 0;) {
+                set_nonblocking(fd);
+                tcp_sources.push_back({});
+                tcp_sources.back().fd = fd;
+            }
+        }
+        if (!path.empty()) {
+            if (file_fd < 0) {
+                file_fd = ::open(path.c_str(), O_RDONLY);
+                file_offset = 0;
+            }
+            struct stat st;
+            if (file_fd >= 0 && ::fstat(file_fd, &st) == 0 && st.st_size < file_offset) {
+                /* Truncated or rewritten: the target restarted */
+                state.reset();
+                file_splitter.clear();
+                file_offset = ::lseek(file_fd, 0, SEEK_SET);
+            }
+            for (ssize_t n; file_fd >= 0 && (n = ::read(file_fd, buffer.data(), buffer.size())) > 0;) {
+                file_offset += n;
+                file_splitter.feed(buffer.data(), static_cast<size_t>(n), apply);
+            }
+        }
+
+        if (std::chrono::steady_clock::now() >= next_tick) {
+            board.publish();
+            next_tick = std::chrono::steady_clock::now() + interval;
+        }
+        board.service(fds, first_client);
+    }
+
+    bad_datagrams += frames.counters().malformed + frames.counters().crc_errors;
+    if (bad_datagrams != 0) {
+        std::cerr << "heapinst_analyze live: " << bad_datagrams << " datagrams were not whole records or frames\n";
+    }
+    for (int fd : {http_fd, udp_fd, tcp_fd, file_fd}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    for (const tcp_source& s : tcp_sources) {
+        ::close(s.fd);
+    }
+    return 0;
+}
+
+}  // namespace heapinst::analyzer::cli
@@ -0,0 +1,32 @@
+/**
+ * @file cmd_massif.cpp
+ * @brief heapinst_analyze massif: massif.out for ms_print.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <string>
+
+#include "cli.hpp"
+#include "heapInstAnalyzer/massif.hpp"
+
+namespace heapinst::analyzer::cli
+{
+
+int run_massif(const args& a)
+{
+    massif_options options;
+    options.time_unit = a.get_or("time-unit", options.time_unit);
+    options.max_snapshots = std::stoul(a.get_or("max-snapshots", std::to_string(options.max_snapshots)));
+    options.detailed_freq = std::stoul(a.get_or("detailed-freq", std::to_string(options.detailed_freq)));
+    options.threshold = std::stod(a.get_or("threshold", std::to_string(options.threshold)));
+    options.cmd = a.trace();
+    symbolizer symbols = load_symbols(a);
+
+    trace_reader reader(a.trace());
+    std::ofstream file;
+    write_massif(reader, symbols, options, open_output(a, file));
+    return 0;
+}
+
+}  // namespace heapinst::analyzer::cli
@@ -0,0 +1,100 @@
+/**
+ * @file cmd_minheap.cpp
+ * @brief heapinst_analyze minheap: smallest heap the trace fits in.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <cinttypes>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "cli.hpp"
+#include "heapInstAnalyzer/minheap.hpp"
+
+namespace heapinst::analyzer::cli
+{
+
+namespace
+{
+
+std::vector<uint32_t> parse_list(const std::string& text)
+{
+    std::vector<uint32_t> values;
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        values.push_back(static_cast<uint32_t>(std::stoul(item, nullptr, 0)));
+    }
+    if (values.empty()) {
+        throw std::invalid_argument("empty list '" + text + "'");
+    }
+    return values;
+}
+
+}  // namespace
+
+int run_minheap(const args& a)
+{
+    std::vector<uint32_t> aligns = parse_list(a.get_or("align", "8"));
+    std::vector<uint32_t> overheads = parse_list(a.get_or("overhead", "8"));
+    uint32_t min_chunk = static_cast<uint32_t>(std::stoul(a.get_or("min-chunk", "16"), nullptr, 0));
+    std::string policy = a.get_or("policy", "first");
+    if (policy != "first" && policy != "best") {
+        throw std::invalid_argument("policy must be first or best");
+    }
+    for (uint32_t align : aligns) {
+        if (align == 0 || (align & (align - 1)) != 0) {
+            throw std::invalid_argument("alignment must be a power of two");
+        }
+    }
+
+    trace_reader reader(a.trace());
+    heap_workload workload = heap_workload::from(reader);
+
+    std::ofstream file;
+    std::ostream& out = open_output(a, file);
+    char line[160];
+
+    std::snprintf(line, sizeof(line), "%zu allocation events, peak requested %" PRIu64 " B\n",
+                  workload.events().size(), workload.peak_requested());
+    out << line;
+    if (workload.heap_size() != 0) {
+        std::snprintf(line, sizeof(line), "INIT heap: %" PRIu32 " B at 0x%08" PRIx32 "\n", workload.heap_size(),
+                      workload.heap_base());
+        out << line;
+    } else {
+        out << "INIT heap: unknown (no headroom figures)\n";
+    }
+    out << "policy: " << policy << "-fit, min chunk " << min_chunk << " B\n\n";
+    out << "  align  overhead   min heap  lower bound   headroom\n";
+
+    for (uint32_t align : aligns) {
+        for (uint32_t overhead : overheads) {
+            allocator_model model;
+            model.align = align;
+            model.overhead = overhead;
+            model.min_chunk = min_chunk;
+            model.policy = (policy == "best") ? allocator_model::fit::best : allocator_model::fit::first;
+
+            uint64_t needed = min_heap_size(workload, model);
+            uint64_t bound = min_heap_lower_bound(workload, model);
+            std::snprintf(line, sizeof(line), "  %5" PRIu32 "  %8" PRIu32 "  %9" PRIu64 "  %11" PRIu64, align, overhead,
+                          needed, bound);
+            out << line;
+            if (workload.heap_size() != 0) {
+                int64_t headroom = static_cast<int64_t>(workload.heap_size()) - static_cast<int64_t>(needed);
+                std::snprintf(line, sizeof(line), "  %9" PRId64 " B (%.1f%%)", headroom,
+                              100.0 * static_cast<double>(headroom) / workload.heap_size());
+                out << line;
+            }
+            out << "\n";
+        }
+    }
+    return 0;
+}
+
+}  // namespace heapinst::analyzer::cli
@@ -0,0 +1,31 @@
+/**
+ * @file cmd_peak.cpp
+ * @brief heapinst_analyze peak: peak-contributor report.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <string>
+
+#include "cli.hpp"
+#include "heapInstAnalyzer/peak.hpp"
+
+namespace heapinst::analyzer::cli
+{
+
+int run_peak(const args& a)
+{
+    peak_options options;
+    options.from = trace_point::parse(a.get_or("from", "end"));
+    options.to = trace_point::parse(a.get_or("to", "end"));
+    size_t top = std::stoul(a.get_or("top", "20"));
+    symbolizer symbols = load_symbols(a);
+
+    peak_report report = analyze_peak(trace_factory(a), options);
+
+    std::ofstream file;
+    write_peak_report(report, symbols, top, open_output(a, file));
+    return 0;
+}
+
+}  // namespace heapinst::analyzer::cli
@@ -0,0 +1,26 @@
+/**
+ * @file cmd_pprof.cpp
+ * @brief heapinst_analyze pprof: heap profile for pprof.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "cli.hpp"
+#include "heapInstAnalyzer/pprof.hpp"
+
+namespace heapinst::analyzer::cli
+{
+
+int run_pprof(const args& a)
+{
+    trace_point point = trace_point::parse(a.get_or("at", "end"));
+    symbolizer symbols = load_symbols(a);
+
+    heap_profile profile = load_profile(a, point);
+
+    std::ofstream file;
+    write_pprof(profile, symbols, open_output(a, file, true));
+    return 0;
+}
+
+}  // namespace heapinst::analyzer::cli
@@ -0,0 +1,277 @@
+/**
+ * @file cmd_receive.cpp
+ * @brief heapinst_analyze receive: store framed traces from many devices.
+ *
+ * Listens on any number of UDP ports, TCP ports and serial lines at once;
+ * every input carries frames (heapInst/heapInstFrame.h) tagged with a
+ * device id, so one socket can serve a whole fleet. Bare record streams
+ * (semihosting, filesystem ports) are not accepted on any input: they are
+ * trace files already. Frames are checked and written by a trace_receiver
+ * into rotated per-device segments under --out, each closed segment
+ * getting a row in the device's index.csv.
+ *
+ * The single poll() loop drains each socket until it would block, with a
+ * large SO_RCVBUF to ride out disk stalls. Every --interval the counters
+ * are written to --metrics (Prometheus text format, replaced atomically,
+ * ready for node_exporter's textfile collector) and aged segments rotate.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "cli.hpp"
+#include "heapInstAnalyzer/receiver.hpp"
+
+namespace heapinst::analyzer::cli
+{
+
+namespace
+{
+
+volatile std::sig_atomic_t g_stop = 0;
+
+enum class input_kind { udp, tcp_listener, tcp, serial };
+
+struct input {
+    input_kind kind;
+    std::string name;
+    int fd = -1;
+    frame_decoder decoder;
+};
+
+speed_t baud_constant(unsigned long baud)
+{
+    switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+#ifdef B460800
+        case 460800: return B460800;
+#endif
+#ifdef B921600
+        case 921600: return B921600;
+#endif
+#ifdef B1000000
+        case 1000000: return B1000000;
+#endif
+#ifdef B2000000
+        case 2000000: return B2000000;
+#endif
+#ifdef B3000000
+        case 3000000: return B3000000;
+#endif
+        default: throw std::invalid_argument("unsupported baud rate " + std::to_string(baud));
+    }
+}
+
+/* "DEV" or "DEV:BAUD"; raw 8N1, nonblocking */
+int open_serial(const std::string& spec)
+{
+    size_t colon = spec.rfind(':');
+    std::string device = spec.substr(0, colon);
+    unsigned long baud = (colon == std::string::npos) ? 115200 : std::stoul(spec.substr(colon + 1));
+
+    int fd = ::open(device.c_str(), O_RDONLY | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open " + device + ": " + std::strerror(errno));
+    }
+    termios tio{};
+    if (::tcgetattr(fd, &tio) == 0) {
+        ::cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        ::cfsetispeed(&tio, baud_constant(baud));
+        ::cfsetospeed(&tio, baud_constant(baud));
+        ::tcsetattr(fd, TCSANOW, &tio);
+    }
+    /* Not a tty (a FIFO, a pty in tests): read it as is */
+    return fd;
+}
+
+void write_metrics_file(const std::string& path, const trace_receiver& receiver, const std::list<input>& inputs)
+{
+    std::vector<std::pair<std::string, source_counters>> sources;
+    for (const input& in : inputs) {
+        if (in.kind != input_kind::tcp_listener) {
+            sources.emplace_back(in.name, in.decoder.counters());
+        }
+    }
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp);
+        receiver.write_metrics(out, sources);
+        if (!out) {
+            throw std::runtime_error("cannot write " + tmp);
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("cannot replace " + path + ": " + std::strerror(errno));
+    }
+}
+
+}  // namespace
+
+int run_receive(const args& a)
+{
+    auto out = a.get("out");
+    if (!out) {
+        throw std::invalid_argument("receive needs --out DIR");
+    }
+    receiver_options options;
+    options.directory = *out;
+    options.segment_bytes = std::stoull(a.get_or("segment-mb", "64")) << 20;
+    options.segment_seconds = std::stoull(a.get_or("segment-s", "0"));
+    options.reorder_frames = static_cast<uint32_t>(std::stoul(a.get_or("reorder", "8")));
+    if (options.segment_bytes == 0) {
+        throw std::invalid_argument("--segment-mb must be positive");
+    }
+    auto interval = std::chrono::milliseconds(std::stoul(a.get_or("interval", "1000")));
+    int rcvbuf = std::stoi(a.get_or("rcvbuf", std::to_string(8 << 20)));
+    std::string metrics = a.get_or("metrics", "");
+
+    trace_receiver receiver(options);
+    auto on_frame = [&](const heap_inst_frame_header_t& header, const record* records, size_t count) {
+        receiver.on_frame(header, records, count);
+    };
+
+    std::list<input> inputs;
+    auto add = [&](input_kind kind, std::string name, int fd) {
+        inputs.push_back({kind, std::move(name), fd, frame_decoder(on_frame)});
+    };
+    for (const std::string& spec : a.get_all("udp")) {
+        auto [host, port] = parse_endpoint(spec, "0.0.0.0");
+        int fd = bind_socket(SOCK_DGRAM, host, port);
+        /* The kernel may clamp this (net.core.rmem_max) */
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        add(input_kind::udp, "udp:" + host + ":" + std::to_string(port), fd);
+    }
+    for (const std::string& spec : a.get_all("tcp")) {
+        auto [host, port] = parse_endpoint(spec, "0.0.0.0");
+        add(input_kind::tcp_listener, "tcp:" + host + ":" + std::to_string(port),
+            bind_socket(SOCK_STREAM, host, port));
+    }
+    for (const std::string& spec : a.get_all("serial")) {
+        add(input_kind::serial, "serial:" + spec.substr(0, spec.rfind(':')), open_serial(spec));
+    }
+    if (inputs.empty()) {
+        throw std::invalid_argument("give at least one --udp, --tcp or --serial input");
+    }
+
+    g_stop = 0;
+    std::signal(SIGINT, [](int) { g_stop = 1; });
+    std::signal(SIGTERM, [](int) { g_stop = 1; });
+    std::signal(SIGPIPE, SIG_IGN);
+
+    auto start = std::chrono::steady_clock::now();
+    auto next_tick = start + interval;
+    std::vector<pollfd> fds;
+    std::vector<input*> polled;
+    std::vector<uint8_t> buffer(1 << 16);
+    while (!g_stop) {
+        fds.clear();
+        polled.clear();
+        for (input& in : inputs) {
+            fds.push_back({in.fd, POLLIN, 0});
+            polled.push_back(&in);
+        }
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_tick - std::chrono::steady_clock::now());
+        int ready = ::poll(fds.data(), fds.size(), static_cast<int>(std::max<long long>(wait.count(), 0)));
+        if (ready < 0 && errno != EINTR) {
+            throw std::runtime_error(std::string("poll: ") + std::strerror(errno));
+        }
+
+        for (size_t i = 0; i < fds.size(); i++) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            input& in = *polled[i];
+            ssize_t n = 0;
+            switch (in.kind) {
+                case input_kind::udp:
+                    while ((n = ::recv(in.fd, buffer.data(), buffer.size(), 0)) >= 0) {
+                        in.decoder.feed_datagram(buffer.data(), static_cast<size_t>(n));
+                    }
+                    break;
+                case input_kind::tcp_listener:
+                    for (int fd; (fd = ::accept(in.fd, nullptr, nullptr)) >= 0;) {
+                        set_nonblocking(fd);
+                        add(input_kind::tcp, in.name + "#" + std::to_string(fd), fd);
+                    }
+                    break;
+                case input_kind::tcp:
+                case input_kind::serial:
+                    while ((n = ::read(in.fd, buffer.data(), buffer.size())) > 0) {
+                        in.decoder.feed_stream(buffer.data(), static_cast<size_t>(n));
+                    }
+                    if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+                        /* Peer gone or port unplugged: keep its counters, stop polling it */
+                        if (in.kind == input_kind::serial) {
+                            std::cerr << in.name << ": closed\n";
+                        }
+                        ::close(in.fd);
+                        in.fd = -1;
+                    }
+                    break;
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_tick) {
+            receiver.rotate_aged(
+                static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count()));
+            if (!metrics.empty()) {
+                write_metrics_file(metrics, receiver, inputs);
+            }
+            next_tick = now + interval;
+        }
+    }
+
+    receiver.close_all();
+    if (!metrics.empty()) {
+        write_metrics_file(metrics, receiver, inputs);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (const auto& [id, c] : receiver.counters()) {
+        char line[200];
+        std::snprintf(line, sizeof(line),
+                      "device %04x: %llu records in %llu frames (%.0f records/s), %llu lost, %llu late, %llu "
+                      "restarts, %llu segments\n",
+                      id, static_cast<unsigned long long>(c.records), static_cast<unsigned long long>(c.frames),
+                      c.records / std::max(seconds, 1e-3), static_cast<unsigned long long>(c.lost_frames),
+                      static_cast<unsigned long long>(c.late_frames), static_cast<unsigned long long>(c.restarts),
+                      static_cast<unsigned long long>(c.segments));
+        std::cerr << line;
+    }
+    for (const input& in : inputs) {
+        const source_counters& c = in.decoder.counters();
+        if (c.crc_errors + c.malformed + c.resync_bytes != 0) {
+            std::cerr << in.name << ": " << c.crc_errors << " CRC errors, " << c.malformed << " malformed, "
+                      << c.resync_bytes << " bytes skipped\n";
+        }
+        if (in.fd >= 0) {
+            ::close(in.fd);
+        }
+    }
+    return 0;
+}
+
+}  // namespace heapinst::analyzer::cli
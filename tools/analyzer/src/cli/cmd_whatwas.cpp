@@ -0,0 +1,98 @@
+/**
+ * @file cmd_whatwas.cpp
+ * @brief heapinst_analyze whatwas: which block held an address at a time.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <cinttypes>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#include "cli.hpp"
+#include "heapInstAnalyzer/address_index.hpp"
+
+namespace heapinst::analyzer::cli
+{
+
+namespace
+{
+
+void print_block(std::ostream& out, const char* label, const block_lifetime& b, const symbolizer& symbols)
+{
+    char line[200];
+    std::snprintf(line, sizeof(line), "%-8s 0x%08" PRIx32 "+%-6" PRIu32 " records %" PRIu64 "..", label, b.address,
+                  b.size, b.since);
+    out << line;
+    if (b.until == block_lifetime::kLive) {
+        std::snprintf(line, sizeof(line), "      (%" PRIu64 " us .. live)", b.alloc_us);
+    } else {
+        std::snprintf(line, sizeof(line), "%-6" PRIu64 "(%" PRIu64 " us .. %" PRIu64 " us)", b.until, b.alloc_us,
+                      b.free_us);
+    }
+    out << line << "  tag " << b.tag << "  " << symbols.name(b.site) << "\n";
+}
+
+}  // namespace
+
+int run_whatwas(const args& a)
+{
+    std::optional<std::string> addr_text = a.get("addr");
+    if (!addr_text) {
+        throw std::invalid_argument("--addr is required");
+    }
+    uint64_t addr = std::stoull(*addr_text, nullptr, 0);
+    uint64_t size = std::stoull(a.get_or("size", "1"), nullptr, 0);
+    if (addr > UINT32_MAX || size == 0) {
+        throw std::invalid_argument("address out of range or empty size");
+    }
+    symbolizer symbols = load_symbols(a);
+
+    trace_reader reader(a.trace());
+    address_index index = address_index::build(reader);
+
+    std::ofstream file;
+    std::ostream& out = open_output(a, file);
+    out << index.blocks().size() << " blocks over " << index.positions() << " records\n";
+
+    std::optional<std::string> at = a.get("at");
+    if (!at) {
+        /* Full history of the range */
+        for (const block_lifetime& b : index.query(addr, addr + size, 0, index.positions())) {
+            print_block(out, "block", b, symbols);
+        }
+        return 0;
+    }
+
+    std::optional<uint64_t> position = index.position_of(trace_point::parse(*at));
+    if (!position) {
+        throw std::runtime_error("trace point '" + *at + "' not found in trace");
+    }
+    out << "at record " << *position << "\n";
+    if (size > 1) {
+        for (const block_lifetime& b : index.query(addr, addr + size, *position, *position)) {
+            print_block(out, "live", b, symbols);
+        }
+        return 0;
+    }
+
+    uint32_t addr32 = static_cast<uint32_t>(addr);
+    std::optional<block_lifetime> owner = index.owner_at(addr32, *position);
+    std::optional<block_lifetime> before = index.previous_owner(addr32, *position);
+    std::optional<block_lifetime> after = index.next_owner(addr32, *position);
+    if (before) {
+        print_block(out, "before", *before, symbols);
+    }
+    if (owner) {
+        print_block(out, "owner", *owner, symbols);
+    } else {
+        out << "owner    none (address not allocated)\n";
+    }
+    if (after) {
+        print_block(out, "after", *after, symbols);
+    }
+    return 0;
+}
+
+}  // namespace heapinst::analyzer::cli
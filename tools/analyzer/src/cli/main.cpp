@@ -0,0 +1,124 @@
+/**
+ * @file main.cpp
+ * @brief heapinst_analyze: host-side analysis of heapInst traces.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+#include "cli.hpp"
+
+namespace
+{
+
+using namespace heapinst::analyzer::cli;
+
+struct command {
+    const char* name;
+    int (*run)(const args&);
+    std::initializer_list<const char*> flags;
+    const char* usage;
+};
+
+const command kCommands[] = {
+    {"pprof", run_pprof, {},
+     "pprof [--at end|<us>|marker:<id>] [--symbols nm.txt] [--sites table] [-o out.pb] <trace>\n"
+     "      pprof heap profile (alloc/inuse objects and space)"},
+    {"massif", run_massif, {},
+     "massif [--time-unit ms|B|i] [--max-snapshots N] [--detailed-freq N] [--threshold PCT]\n"
+     "      [--symbols nm.txt] [--sites table] [-o massif.out] <trace>\n"
+     "      valgrind massif output for ms_print / massif-visualizer"},
+    {"heaptrack", run_heaptrack, {},
+     "heaptrack [--module NAME] [--symbols nm.txt] [--sites table] [-o heaptrack.fw] <trace>\n"
+     "      heaptrack data file for heaptrack_gui / heaptrack_print"},
+    {"folded", run_folded, {"tags"},
+     "folded [--weight bytes|count|live] [--at end|<us>|marker:<id>] [--tags]\n"
+     "      [--symbols nm.txt] [--sites table] [-o out.folded] <trace>\n"
+     "      folded stacks for flamegraph.pl / speedscope"},
+    {"peak", run_peak, {},
+     "peak [--from <point>] [--to <point>] [--top N] [--symbols nm.txt] [--sites table] <trace>\n"
+     "      live set at the (range) heap peak by callsite, tag, size class and age"},
+    {"minheap", run_minheap, {},
+     "minheap [--align 4,8] [--overhead 4,8] [--min-chunk 16] [--policy first|best] <trace>\n"
+     "      smallest heap region the trace fits in, by allocator-model replay"},
+    {"whatwas", run_whatwas, {},
+     "whatwas --addr X [--size N] [--at <point>] [--symbols nm.txt] [--sites table] <trace>\n"
+     "      block(s) covering an address: owner at a point with the ones before and\n"
+     "      after, or the full history when --at is omitted"},
+    {"chains", run_chains, {},
+     "chains [--top N] [--min-reallocs N] [--symbols nm.txt] [--sites table] <trace>\n"
+     "      realloc growth chains ranked by bytes copied, with their origin callsites"},
+    {"frag", run_frag, {"csv", "requested"},
+     "frag [--base X --size N] [--samples N] [--requested] [--csv] <trace>\n"
+     "      largest free gap, gap count and external fragmentation over time"},
+    {"arena", run_arena, {"csv"},
+     "arena [--samples N] [--csv] <trace>\n"
+     "      program break and RSS vs live bytes, headroom to the heap end and the stack\n"
+     "      (SBRK and RSS records)"},
+    {"banks", run_banks, {"csv", "requested"},
+     "banks [--map pico2|FILE] [--top N] [--samples N] [--requested] [--csv]\n"
+     "      [--symbols nm.txt] [--sites table] <trace>\n"
+     "      heap occupancy per SRAM bank over time, the callsites holding each bank\n"
+     "      and the RAM budget (MEMMAP records)"},
+    {"fleet", run_fleet, {"devices"},
+     "fleet [--jobs N] [--top N] [--threshold Z] [--accuracy A] [--devices]\n"
+     "      [--symbols nm.txt] [--sites table] <trace|dir>...\n"
+     "      many traces summarised in parallel: sizes, lifetimes, callsites, outlier devices"},
+    {"live", run_live, {},
+     "live [--http [HOST:]PORT] [--interval MS] [--top N] [--base X --size N]\n"
+     "      [--symbols nm.txt] [--sites table] <trace> | --udp [HOST:]PORT | --tcp [HOST:]PORT\n"
+     "      browser dashboard (SSE deltas) of a growing trace file or a record stream"},
+    {"receive", run_receive, {},
+     "receive --out DIR [--udp [HOST:]PORT]... [--tcp [HOST:]PORT]... [--serial DEV[:BAUD]]...\n"
+     "      [--segment-mb N] [--segment-s N] [--reorder FRAMES] [--metrics FILE] [--interval MS]\n"
+     "      [--rcvbuf BYTES]\n"
+     "      store framed streams (heapInstFrame.h, also on serial and TCP) of many devices\n"
+     "      in rotated, indexed segments"},
+    {"merge", run_merge, {},
+     "merge [--window US] [--max-pending N] [--offset INPUT:US]... -o merged.bin <trace|dir>...\n"
+     "      one time-ordered trace from per-core/thread/device streams, aligned by time-sync records"},
+};
+
+void usage(std::ostream& out)
+{
+    out << "usage: heapinst_analyze <command> [options] <trace>\n\ncommands:\n";
+    for (const command& c : kCommands) {
+        out << "  " << c.usage << "\n";
+    }
+    out << "\npprof and folded take --spill <MiB> [--tmpdir DIR] to bound memory on huge traces.\n";
+    out << "--symbols takes `nm -C -S firmware.elf` output, --sites a site table from\n"
+           "heap_inst_enable_site_ids(); both may be repeated.\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || std::strcmp(argv[1], "--help") == 0 || std::strcmp(argv[1], "-h") == 0) {
+        usage(argc < 2 ? std::cerr : std::cout);
+        return argc < 2 ? 2 : 0;
+    }
+
+    for (const command& c : kCommands) {
+        if (std::strcmp(argv[1], c.name) != 0) {
+            continue;
+        }
+        try {
+            return c.run(args(argc - 1, argv + 1, c.flags));
+        } catch (const std::invalid_argument& e) {
+            std::cerr << "heapinst_analyze " << c.name << ": " << e.what() << "\nusage: heapinst_analyze "
+                      << c.usage << "\n";
+            return 2;
+        } catch (const std::exception& e) {
+            std::cerr << "heapinst_analyze " << c.name << ": " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    std::cerr << "heapinst_analyze: unknown command '" << argv[1] << "'\n";
+    usage(std::cerr);
+    return 2;
+}
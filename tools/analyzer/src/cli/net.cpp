@@ -0,0 +1,64 @@
+/**
+ * @file net.cpp
+ * @brief Socket helpers shared by live and receive.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "cli.hpp"
+
+namespace heapinst::analyzer::cli
+{
+
+void set_nonblocking(int fd)
+{
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+int bind_socket(int type, const std::string& host, uint16_t port)
+{
+    int fd = ::socket(AF_INET, type, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    }
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        ::close(fd);
+        throw std::invalid_argument("bad IPv4 address '" + host + "'");
+    }
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        (type == SOCK_STREAM && ::listen(fd, 16) != 0)) {
+        std::string error = std::strerror(errno);
+        ::close(fd);
+        throw std::runtime_error("cannot bind " + host + ":" + std::to_string(port) + ": " + error);
+    }
+    set_nonblocking(fd);
+    return fd;
+}
+
+std::pair<std::string, uint16_t> parse_endpoint(const std::string& text, const std::string& default_host)
+{
+    size_t colon = text.rfind(':');
+    std::string host = (colon == std::string::npos) ? default_host : text.substr(0, colon);
+    unsigned long port = std::stoul(colon == std::string::npos ? text : text.substr(colon + 1));
+    if (port == 0 || port > 65535) {
+        throw std::invalid_argument("bad port in '" + text + "'");
+    }
+    return {host, static_cast<uint16_t>(port)};
+}
+
+}  // namespace heapinst::analyzer::cli
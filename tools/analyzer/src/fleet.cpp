@@ -0,0 +1,340 @@
+/**
+ * @file fleet.cpp
+ * @brief Parallel per-trace reduction, merging and outlier detection.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/fleet.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <thread>
+
+#include "heapInstAnalyzer/replay.hpp"
+
+namespace heapinst::analyzer
+{
+
+void trace_summary::merge(const trace_summary& other)
+{
+    traces += other.traces;
+    records += other.records;
+    allocs += other.allocs;
+    frees += other.frees;
+    failed_allocs += other.failed_allocs;
+    bytes_allocated += other.bytes_allocated;
+    peak_live = std::max(peak_live, other.peak_live);
+    final_live += other.final_live;
+    final_objects += other.final_objects;
+    duration_us += other.duration_us;
+    sizes.merge(other.sizes);
+    lifetime_us.merge(other.lifetime_us);
+    for (const auto& [key, s] : other.sites) {
+        site_totals& mine = sites[key];
+        mine.allocs += s.allocs;
+        mine.bytes += s.bytes;
+        mine.live_bytes += s.live_bytes;
+        mine.traces += s.traces;
+    }
+}
+
+trace_summary summarize_trace(record_source& source, double alpha)
+{
+    trace_summary summary(alpha);
+    summary.traces = 1;
+    heap_replay replay;
+    record rec;
+    while (source.next(rec)) {
+        replay_step step = replay.apply(rec);
+        if (step.freed) {
+            const allocation& a = *step.freed;
+            summary.lifetime_us.add(static_cast<double>(rec.timestamp_us - std::min(rec.timestamp_us, a.time_us)));
+            if (!step.is_realloc) {
+                summary.frees++;
+            }
+        }
+        if (step.allocated) {
+            const allocation& a = *step.allocated;
+            summary.allocs++;
+            summary.bytes_allocated += a.size;
+            summary.sizes.add(a.size);
+            site_totals& s = summary.sites[a.site.key()];
+            s.allocs++;
+            s.bytes += a.size;
+            s.traces = 1;
+        }
+    }
+
+    summary.records = replay.records();
+    summary.failed_allocs = replay.failed_allocs();
+    summary.peak_live = replay.peak_bytes();
+    summary.final_live = replay.live_bytes();
+    summary.final_objects = replay.live_objects();
+    summary.duration_us = replay.time_us() - std::min(replay.time_us(), replay.first_time_us());
+    for (const auto& [ptr, a] : replay.live()) {
+        summary.sites[a.site.key()].live_bytes += a.size;
+    }
+    return summary;
+}
+
+namespace
+{
+
+/* A receive output directory: rotated segments of one device */
+bool is_device_dir(std::filesystem::path path)
+{
+    if (!path.has_filename()) {
+        path = path.parent_path(); /* trailing separator */
+    }
+    return path.filename().string().rfind("dev", 0) == 0;
+}
+
+}  // namespace
+
+std::vector<std::string> collect_trace_files(const std::vector<std::string>& paths)
+{
+    namespace fs = std::filesystem;
+    std::vector<std::string> files;
+    for (const std::string& path : paths) {
+        if (!fs::is_directory(path) || is_device_dir(path)) {
+            files.push_back(path);
+            continue;
+        }
+        std::vector<std::string> found;
+        for (auto it = fs::recursive_directory_iterator(path); it != fs::recursive_directory_iterator(); ++it) {
+            if (it->is_directory() && is_device_dir(it->path())) {
+                found.push_back(it->path().string());
+                it.disable_recursion_pending();
+            } else if (it->is_regular_file() && it->path().extension() == ".bin") {
+                found.push_back(it->path().string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+    }
+    return files;
+}
+
+namespace
+{
+
+double median_of(std::vector<double> values)
+{
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t mid = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + mid, values.end());
+    double upper = values[mid];
+    if (values.size() % 2 != 0) {
+        return upper;
+    }
+    return (upper + *std::max_element(values.begin(), values.begin() + mid)) / 2.0;
+}
+
+struct metric {
+    const char* name;
+    double (*get)(const device_stats&);
+};
+
+const metric kMetrics[] = {
+    {"peak live bytes", [](const device_stats& d) { return static_cast<double>(d.peak_live); }},
+    {"bytes left allocated", [](const device_stats& d) { return static_cast<double>(d.final_live); }},
+    {"failed allocations", [](const device_stats& d) { return static_cast<double>(d.failed_allocs); }},
+    {"allocations per second", [](const device_stats& d) { return d.alloc_rate; }},
+    {"p99 lifetime us", [](const device_stats& d) { return d.lifetime_p99_us; }},
+};
+
+}  // namespace
+
+std::vector<fleet_outlier> find_outliers(const std::vector<device_stats>& devices, double threshold)
+{
+    std::vector<size_t> usable;
+    for (size_t i = 0; i < devices.size(); i++) {
+        if (devices[i].error.empty()) {
+            usable.push_back(i);
+        }
+    }
+    std::vector<fleet_outlier> outliers;
+    if (usable.size() < 3) {
+        return outliers;
+    }
+
+    for (const metric& m : kMetrics) {
+        std::vector<double> values;
+        for (size_t i : usable) {
+            values.push_back(m.get(devices[i]));
+        }
+        double median = median_of(values);
+        std::vector<double> deviations;
+        double mean_deviation = 0.0;
+        for (double v : values) {
+            deviations.push_back(std::fabs(v - median));
+            mean_deviation += std::fabs(v - median);
+        }
+        mean_deviation /= static_cast<double>(values.size());
+        double mad = median_of(deviations);
+
+        /* MAD is 0 when most devices agree; fall back to the mean deviation */
+        double scale = (mad > 0.0) ? mad / 0.6745 : 1.253314 * mean_deviation;
+        if (scale <= 0.0) {
+            continue;
+        }
+        for (size_t k = 0; k < usable.size(); k++) {
+            double score = (values[k] - median) / scale;
+            if (score > threshold) {
+                outliers.push_back({usable[k], m.name, values[k], median, score});
+            }
+        }
+    }
+    std::sort(outliers.begin(), outliers.end(),
+              [](const fleet_outlier& a, const fleet_outlier& b) { return a.score > b.score; });
+    return outliers;
+}
+
+fleet_report analyze_fleet(const std::vector<std::string>& files, const fleet_options& options)
+{
+    fleet_report report;
+    report.total = trace_summary(options.alpha);
+    report.devices.resize(files.size());
+
+    unsigned jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = static_cast<unsigned>(std::min<size_t>(jobs, std::max<size_t>(files.size(), 1)));
+
+    std::atomic<size_t> next{0};
+    std::vector<trace_summary> partials(jobs, trace_summary(options.alpha));
+    auto worker = [&](trace_summary& partial) {
+        /* Each file writes only its own device row: no locking needed */
+        for (size_t i = next++; i < files.size(); i = next++) {
+            device_stats& d = report.devices[i];
+            d.name = files[i];
+            try {
+                segment_reader reader(trace_segments(files[i]));
+                trace_summary s = summarize_trace(reader, options.alpha);
+                d.truncated = reader.truncated();
+                d.records = s.records;
+                d.allocs = s.allocs;
+                d.failed_allocs = s.failed_allocs;
+                d.peak_live = s.peak_live;
+                d.final_live = s.final_live;
+                d.duration_us = s.duration_us;
+                d.alloc_rate = s.duration_us ? static_cast<double>(s.allocs) * 1e6 / static_cast<double>(s.duration_us) : 0.0;
+                d.lifetime_p50_us = s.lifetime_us.quantile(0.5);
+                d.lifetime_p99_us = s.lifetime_us.quantile(0.99);
+                partial.merge(s);
+            } catch (const std::exception& e) {
+                d.error = e.what();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < jobs; t++) {
+        threads.emplace_back(worker, std::ref(partials[t]));
+    }
+    worker(partials[0]);
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    for (const trace_summary& partial : partials) {
+        report.total.merge(partial);
+    }
+    for (const device_stats& d : report.devices) {
+        report.failed_files += d.error.empty() ? 0 : 1;
+    }
+    report.outliers = find_outliers(report.devices, options.threshold);
+    return report;
+}
+
+void write_fleet_report(const fleet_report& report, const symbolizer& symbols, size_t top, bool per_device,
+                        std::ostream& out)
+{
+    const trace_summary& t = report.total;
+    char line[240];
+    std::snprintf(line, sizeof(line),
+                  "%" PRIu64 " traces (%zu unreadable), %" PRIu64 " records, %" PRIu64 " allocations, %" PRIu64
+                  " bytes, %" PRIu64 " failed\n",
+                  t.traces, report.failed_files, t.records, t.allocs, t.bytes_allocated, t.failed_allocs);
+    out << line;
+    std::snprintf(line, sizeof(line),
+                  "largest peak %" PRIu64 " B; %" PRIu64 " B in %" PRIu64 " blocks left allocated across the fleet\n",
+                  t.peak_live, t.final_live, t.final_objects);
+    out << line;
+
+    out << "\nblock lifetime (us, +-" << 100.0 * t.lifetime_us.alpha() << "%):\n";
+    std::snprintf(line, sizeof(line), "  p50 %.0f  p90 %.0f  p99 %.0f  p99.9 %.0f  max %.0f  (%" PRIu64 " freed)\n",
+                  t.lifetime_us.quantile(0.5), t.lifetime_us.quantile(0.9), t.lifetime_us.quantile(0.99),
+                  t.lifetime_us.quantile(0.999), t.lifetime_us.max(), t.lifetime_us.count());
+    out << line;
+
+    out << "\nallocation sizes:\n";
+    for (size_t b = 0; b < t.sizes.buckets.size(); b++) {
+        if (t.sizes.buckets[b] == 0) {
+            continue;
+        }
+        std::snprintf(line, sizeof(line), "  [%10" PRIu64 ", %10" PRIu64 ")  %12" PRIu64 "  %5.1f%%\n",
+                      log2_histogram::lower_bound(b), b ? log2_histogram::lower_bound(b + 1) : 1, t.sizes.buckets[b],
+                      t.allocs ? 100.0 * static_cast<double>(t.sizes.buckets[b]) / static_cast<double>(t.allocs) : 0.0);
+        out << line;
+    }
+
+    std::vector<std::pair<uint64_t, site_totals>> sites(t.sites.begin(), t.sites.end());
+    std::sort(sites.begin(), sites.end(), [](const auto& a, const auto& b) {
+        if (a.second.bytes != b.second.bytes) {
+            return a.second.bytes > b.second.bytes;
+        }
+        return a.first < b.first;
+    });
+    out << "\ntop callsites by bytes allocated:\n";
+    out << "         bytes      allocs   left live  traces  callsite\n";
+    for (size_t i = 0; i < sites.size() && i < top; i++) {
+        const site_totals& s = sites[i].second;
+        std::snprintf(line, sizeof(line), "  %12" PRIu64 "  %10" PRIu64 "  %10" PRIu64 "  %6" PRIu64 "  ", s.bytes,
+                      s.allocs, s.live_bytes, s.traces);
+        out << line << symbols.name(callsite::from_key(sites[i].first)) << "\n";
+    }
+
+    out << "\noutliers:\n";
+    if (report.outliers.empty()) {
+        out << "  none\n";
+    }
+    for (const fleet_outlier& o : report.outliers) {
+        std::snprintf(line, sizeof(line), "  score %6.1f  %-24s %14.0f (median %.0f)  ", o.score, o.metric, o.value,
+                      o.median);
+        out << line << report.devices[o.device].name << "\n";
+    }
+
+    bool any_error = false;
+    for (const device_stats& d : report.devices) {
+        if (!d.error.empty()) {
+            if (!any_error) {
+                out << "\nunreadable:\n";
+                any_error = true;
+            }
+            out << "  " << d.name << ": " << d.error << "\n";
+        }
+    }
+
+    if (!per_device) {
+        return;
+    }
+    out << "\n       records      allocs  failed        peak   left live   allocs/s  p99 life us  trace\n";
+    for (const device_stats& d : report.devices) {
+        if (!d.error.empty()) {
+            continue;
+        }
+        std::snprintf(line, sizeof(line),
+                      "  %12" PRIu64 "  %10" PRIu64 "  %6" PRIu64 "  %10" PRIu64 "  %10" PRIu64 "  %9.1f  %11.0f  ",
+                      d.records, d.allocs, d.failed_allocs, d.peak_live, d.final_live, d.alloc_rate, d.lifetime_p99_us);
+        out << line << d.name << (d.truncated ? " (truncated)" : "") << "\n";
+    }
+}
+
+}  // namespace heapinst::analyzer
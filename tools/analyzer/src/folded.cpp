@@ -0,0 +1,82 @@
+/**
+ * @file folded.cpp
+ * @brief Folded-stack writer.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/folded.hpp"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace heapinst::analyzer
+{
+
+namespace
+{
+
+/* ';' separates frames and the last space the weight; keep frames clean */
+std::string frame_name(std::string name)
+{
+    std::replace(name.begin(), name.end(), ';', ':');
+    std::replace(name.begin(), name.end(), '\n', ' ');
+    return name;
+}
+
+uint64_t weight_of(const profile_entry& e, folded_weight weight)
+{
+    switch (weight) {
+        case folded_weight::count:
+            return e.alloc_objects;
+        case folded_weight::live_bytes:
+            return e.inuse_space;
+        case folded_weight::bytes:
+        default:
+            return e.alloc_space;
+    }
+}
+
+}  // namespace
+
+folded_weight parse_folded_weight(const std::string& text)
+{
+    if (text == "bytes") {
+        return folded_weight::bytes;
+    }
+    if (text == "count") {
+        return folded_weight::count;
+    }
+    if (text == "live") {
+        return folded_weight::live_bytes;
+    }
+    throw std::invalid_argument("weight must be bytes, count or live");
+}
+
+void write_folded(const heap_profile& profile, const symbolizer& symbols, const folded_options& options,
+                  std::ostream& out)
+{
+    std::map<std::string, uint64_t> stacks;
+    for (const profile_entry& e : profile.entries) {
+        uint64_t weight = weight_of(e, options.weight);
+        if (weight == 0) {
+            continue;
+        }
+        std::string stack;
+        if (options.tag_frames && e.tag != 0) {
+            stack = "tag:" + std::to_string(e.tag) + ";";
+        }
+        stack += frame_name(symbols.name(e.site));
+        stacks[stack] += weight;
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> lines(stacks.begin(), stacks.end());
+    std::stable_sort(lines.begin(), lines.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    for (const auto& [stack, weight] : lines) {
+        out << stack << ' ' << weight << '\n';
+    }
+}
+
+}  // namespace heapinst::analyzer
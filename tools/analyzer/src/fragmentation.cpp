@@ -0,0 +1,264 @@
+/**
+ * @file fragmentation.cpp
+ * @brief Free-gap tracking and the fragmentation timeline.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/fragmentation.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+#include "heapInstAnalyzer/replay.hpp"
+#include "heapInstAnalyzer/thinning.hpp"
+
+namespace heapinst::analyzer
+{
+
+void free_space::reset(uint64_t begin, uint64_t end)
+{
+    begin_ = begin;
+    end_ = std::max(begin, end);
+    total_free_ = 0;
+    gaps_.clear();
+    lengths_.clear();
+    add_gap(begin_, end_);
+}
+
+void free_space::add_gap(uint64_t begin, uint64_t end)
+{
+    if (begin < end) {
+        gaps_.emplace(begin, end);
+        lengths_.insert(end - begin);
+        total_free_ += end - begin;
+    }
+}
+
+std::map<uint64_t, uint64_t>::iterator free_space::remove_gap(std::map<uint64_t, uint64_t>::iterator it)
+{
+    lengths_.erase(lengths_.find(it->second - it->first));
+    total_free_ -= it->second - it->first;
+    return gaps_.erase(it);
+}
+
+void free_space::occupy(uint64_t begin, uint64_t end)
+{
+    begin = std::max(begin, begin_);
+    end = std::min(end, end_);
+    if (begin >= end) {
+        return;
+    }
+
+    auto it = gaps_.upper_bound(begin);
+    if (it != gaps_.begin()) {
+        --it;
+    }
+    while (it != gaps_.end() && it->first < end) {
+        uint64_t gap_begin = it->first, gap_end = it->second;
+        if (gap_end <= begin) {
+            ++it;
+            continue;
+        }
+        it = remove_gap(it);
+        add_gap(gap_begin, begin);
+        add_gap(end, gap_end);
+        /* The right remainder starts at end: nothing further overlaps */
+        if (gap_end > end) {
+            break;
+        }
+    }
+}
+
+void free_space::release(uint64_t begin, uint64_t end)
+{
+    begin = std::max(begin, begin_);
+    end = std::min(end, end_);
+    if (begin >= end) {
+        return;
+    }
+
+    /* Absorb every gap touching or overlapping [begin, end) */
+    auto it = gaps_.upper_bound(begin);
+    if (it != gaps_.begin() && std::prev(it)->second >= begin) {
+        --it;
+    }
+    while (it != gaps_.end() && it->first <= end) {
+        begin = std::min(begin, it->first);
+        end = std::max(end, it->second);
+        it = remove_gap(it);
+    }
+    add_gap(begin, end);
+}
+
+namespace
+{
+
+uint64_t block_end(const allocation& a, bool usable_size)
+{
+    uint32_t bytes = (usable_size && a.usable > a.size) ? a.usable : a.size;
+    return static_cast<uint64_t>(a.ptr) + std::max<uint32_t>(bytes, 1);
+}
+
+/* Region before any INIT: options, else the extent of all allocations */
+bool infer_region(const source_factory& open, const fragmentation_options& options, uint64_t& base, uint64_t& size)
+{
+    if (options.heap_size != 0) {
+        base = options.heap_base;
+        size = options.heap_size;
+        return false;
+    }
+
+    std::unique_ptr<record_source> source = open();
+    heap_replay replay;
+    uint64_t lowest = UINT64_MAX, highest = 0;
+    record rec;
+    while (source->next(rec)) {
+        if (rec.operation == HEAP_OP_INIT && (rec.arg3 & HEAP_INIT_FLAG_HEAP_INFO_VALID) && lowest == UINT64_MAX) {
+            /* The usual case: INIT describes the heap before anything is allocated */
+            base = rec.arg1;
+            size = rec.arg2;
+            return false;
+        }
+        replay_step step = replay.apply(rec);
+        if (step.allocated) {
+            lowest = std::min<uint64_t>(lowest, step.allocated->ptr);
+            highest = std::max(highest, block_end(*step.allocated, options.usable_size));
+        }
+    }
+    base = (lowest == UINT64_MAX) ? 0 : lowest;
+    size = (lowest == UINT64_MAX) ? 0 : highest - lowest;
+    return true;
+}
+
+}  // namespace
+
+fragmentation_report analyze_fragmentation(const source_factory& open, const fragmentation_options& options)
+{
+    fragmentation_report report;
+    report.region_from_extent = infer_region(open, options, report.heap_base, report.heap_size);
+
+    free_space space;
+    space.reset(report.heap_base, report.heap_base + report.heap_size);
+    uint64_t used = 0;
+    thinned_series<fragmentation_sample> timeline(options.max_samples);
+    bool any = false;
+
+    auto sample = [&](const record& rec, uint64_t index) {
+        fragmentation_sample s{.time_us = rec.timestamp_us,
+                               .index = index,
+                               .used = used,
+                               .total_free = space.total_free(),
+                               .largest_free = space.largest_free(),
+                               .gaps = space.gaps(),
+                               .fragmentation = space.fragmentation()};
+        if (!any || s.largest_free < report.min_largest_free.largest_free) {
+            report.min_largest_free = s;
+        }
+        if (!any || s.fragmentation > report.max_fragmentation.fragmentation) {
+            report.max_fragmentation = s;
+        }
+        any = true;
+        report.final = s;
+
+        timeline.add(s);
+    };
+
+    std::unique_ptr<record_source> source = open();
+    heap_replay replay;
+    record rec;
+    while (source->next(rec)) {
+        replay_step step = replay.apply(rec);
+        uint64_t index = replay.records() - 1;
+
+        if (rec.operation == HEAP_OP_INIT) {
+            if (options.heap_size == 0 && (rec.arg3 & HEAP_INIT_FLAG_HEAP_INFO_VALID)) {
+                report.heap_base = rec.arg1;
+                report.heap_size = rec.arg2;
+                report.region_from_extent = false;
+            }
+            space.reset(report.heap_base, report.heap_base + report.heap_size);
+            used = 0;
+            sample(rec, index);
+            continue;
+        }
+        if (!step.freed && !step.allocated) {
+            continue;
+        }
+
+        if (step.freed) {
+            const allocation& a = *step.freed;
+            space.release(a.ptr, block_end(a, options.usable_size));
+            used -= std::min(used, block_end(a, options.usable_size) - a.ptr);
+        }
+        if (step.allocated) {
+            const allocation& a = *step.allocated;
+            uint64_t end = block_end(a, options.usable_size);
+            if (a.ptr < report.heap_base || end > report.heap_base + report.heap_size) {
+                report.outside_blocks++;
+            }
+            space.occupy(a.ptr, end);
+            used += end - a.ptr;
+        }
+        sample(rec, index);
+    }
+    report.timeline = timeline.take();
+    return report;
+}
+
+namespace
+{
+
+void print_sample(std::ostream& out, const char* label, const fragmentation_sample& s)
+{
+    char line[200];
+    std::snprintf(line, sizeof(line),
+                  "%-18s %10" PRIu64 " us (record %" PRIu64 "): largest gap %" PRIu64 " B of %" PRIu64
+                  " B free in %" PRIu64 " gaps, fragmentation %.1f%%\n",
+                  label, s.time_us, s.index, s.largest_free, s.total_free, s.gaps, 100.0 * s.fragmentation);
+    out << line;
+}
+
+}  // namespace
+
+void write_fragmentation_report(const fragmentation_report& report, std::ostream& out)
+{
+    char line[200];
+    std::snprintf(line, sizeof(line), "heap region: 0x%08" PRIx64 " + %" PRIu64 " B%s\n", report.heap_base,
+                  report.heap_size, report.region_from_extent ? " (allocation extent; no INIT heap info)" : "");
+    out << line;
+    if (report.outside_blocks != 0) {
+        out << "warning: " << report.outside_blocks << " allocations outside the region were clipped\n";
+    }
+    if (report.timeline.empty()) {
+        out << "no heap events\n";
+        return;
+    }
+
+    print_sample(out, "smallest gap:", report.min_largest_free);
+    print_sample(out, "most fragmented:", report.max_fragmentation);
+    print_sample(out, "end of trace:", report.final);
+
+    out << "\n        time us      record      used B      free B   largest B   gaps   frag\n";
+    for (const fragmentation_sample& s : report.timeline) {
+        std::snprintf(line, sizeof(line),
+                      "  %13" PRIu64 "  %10" PRIu64 "  %10" PRIu64 "  %10" PRIu64 "  %10" PRIu64 "  %5" PRIu64
+                      "  %5.1f%%\n",
+                      s.time_us, s.index, s.used, s.total_free, s.largest_free, s.gaps, 100.0 * s.fragmentation);
+        out << line;
+    }
+}
+
+void write_fragmentation_csv(const fragmentation_report& report, std::ostream& out)
+{
+    out << "time_us,record,used,total_free,largest_free,gaps,fragmentation\n";
+    char line[160];
+    for (const fragmentation_sample& s : report.timeline) {
+        std::snprintf(line, sizeof(line), "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%.4f\n",
+                      s.time_us, s.index, s.used, s.total_free, s.largest_free, s.gaps, s.fragmentation);
+        out << line;
+    }
+}
+
+}  // namespace heapinst::analyzer
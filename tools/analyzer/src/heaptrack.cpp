@@ -0,0 +1,141 @@
+/**
+ * @file heaptrack.cpp
+ * @brief Streaming heaptrack (format v2) writer.
+ *
+ * All numbers are hex without prefix. String, ip and trace indices are
+ * 1-based (0 = none); allocation info indices are 0-based.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/heaptrack.hpp"
+
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+#include "heapInstAnalyzer/replay.hpp"
+
+namespace heapinst::analyzer
+{
+
+namespace
+{
+
+constexpr unsigned kHeaptrackVersion = 0x010200;
+constexpr unsigned kFileFormatVersion = 2;
+constexpr uint64_t kPageSize = 4096;
+
+class heaptrack_writer
+{
+   public:
+    heaptrack_writer(const symbolizer& symbols, const heaptrack_options& options, std::ostream& out)
+        : symbols_(symbols), out_(out)
+    {
+        out_ << std::hex;
+        out_ << "v " << kHeaptrackVersion << ' ' << kFileFormatVersion << '\n';
+        out_ << "X " << options.cmd << '\n';
+        out_ << "I " << kPageSize << " 0\n";
+        module_ = intern(options.module);
+    }
+
+    ~heaptrack_writer() { out_ << std::dec; }
+
+    void feed(const record& rec)
+    {
+        uint64_t ms = rec.timestamp_us / 1000;
+        if (!started_) {
+            start_ms_ = ms;
+            started_ = true;
+        }
+        /* Elapsed time only moves forward, even across a target restart */
+        if (ms >= start_ms_ && ms - start_ms_ > last_ms_) {
+            last_ms_ = ms - start_ms_;
+            out_ << "c " << last_ms_ << '\n';
+        }
+
+        if (rec.operation == HEAP_OP_RSS) {
+            out_ << "R " << (static_cast<uint64_t>(rec.arg1) * 1024 / kPageSize) << '\n';
+            return;
+        }
+
+        /* Resolve indices first: new s/i/t/a lines must precede their use */
+        replay_step step = replay_.apply(rec);
+        if (step.freed) {
+            uint64_t info = alloc_info(*step.freed);
+            out_ << "- " << info << '\n';
+        }
+        if (step.allocated) {
+            uint64_t info = alloc_info(*step.allocated);
+            out_ << "+ " << info << '\n';
+        }
+    }
+
+   private:
+    uint64_t intern(const std::string& s)
+    {
+        auto [it, inserted] = strings_.try_emplace(s, strings_.size() + 1);
+        if (inserted) {
+            out_ << "s " << s << '\n';
+        }
+        return it->second;
+    }
+
+    uint64_t trace(const callsite& site)
+    {
+        auto it = traces_.find(site.key());
+        if (it != traces_.end()) {
+            return it->second;
+        }
+
+        frame f = symbols_.resolve(site);
+        uint64_t function = intern(symbols_.name(site));
+        uint64_t ip = ++ip_count_;
+        out_ << "i " << (site.is_site_id ? 0 : site.site) << ' ' << module_ << ' ' << function;
+        if (!f.file.empty()) {
+            out_ << ' ' << intern(f.file) << ' ' << f.line;
+        }
+        out_ << '\n';
+
+        uint64_t index = traces_.size() + 1;
+        out_ << "t " << ip << " 0\n";
+        traces_.emplace(site.key(), index);
+        return index;
+    }
+
+    uint64_t alloc_info(const allocation& a)
+    {
+        uint64_t trace_index = trace(a.site);
+        auto [it, inserted] = infos_.try_emplace({a.size, trace_index}, infos_.size());
+        if (inserted) {
+            out_ << "a " << a.size << ' ' << trace_index << '\n';
+        }
+        return it->second;
+    }
+
+    const symbolizer& symbols_;
+    std::ostream& out_;
+    heap_replay replay_;
+    std::unordered_map<std::string, uint64_t> strings_;
+    std::unordered_map<uint64_t, uint64_t> traces_;
+    std::map<std::pair<uint64_t, uint64_t>, uint64_t> infos_;
+    uint64_t ip_count_ = 0;
+    uint64_t module_ = 0;
+    uint64_t start_ms_ = 0;
+    uint64_t last_ms_ = 0;
+    bool started_ = false;
+};
+
+}  // namespace
+
+void write_heaptrack(record_source& source, const symbolizer& symbols, const heaptrack_options& options,
+                     std::ostream& out)
+{
+    heaptrack_writer writer(symbols, options, out);
+    record rec;
+    while (source.next(rec)) {
+        writer.feed(rec);
+    }
+}
+
+}  // namespace heapinst::analyzer
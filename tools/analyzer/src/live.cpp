@@ -0,0 +1,237 @@
+/**
+ * @file live.cpp
+ * @brief Incremental live state and JSON delta encoding.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/live.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+namespace heapinst::analyzer
+{
+
+live_state::live_state(const live_options& options) : options_(options)
+{
+    reset();
+}
+
+void live_state::reset()
+{
+    replay_ = heap_replay();
+    sites_.clear();
+    rate_.clear();
+    region_known_ = options_.heap_size != 0;
+    space_.reset(options_.heap_base, options_.heap_base + options_.heap_size);
+}
+
+uint64_t live_state::block_end(const allocation& a) const
+{
+    uint32_t bytes = std::max(a.usable, a.size);
+    return static_cast<uint64_t>(a.ptr) + std::max<uint32_t>(bytes, 1);
+}
+
+void live_state::allocated(const allocation& a)
+{
+    live_site& s = sites_[a.site.key()];
+    s.key = a.site.key();
+    s.bytes += a.size;
+    s.count++;
+    space_.occupy(a.ptr, block_end(a));
+
+    uint64_t slot_us = std::max<uint64_t>(options_.rate_window_us / 10, 1);
+    uint64_t slot = a.time_us / slot_us;
+    if (rate_.empty() || rate_.back().slot < slot) {
+        rate_.push_back({slot, 0, 0});
+        while (rate_.front().slot + 10 <= slot) {
+            rate_.pop_front();
+        }
+    }
+    rate_.back().count++;
+    rate_.back().bytes += a.size;
+}
+
+void live_state::released(const allocation& a)
+{
+    auto it = sites_.find(a.site.key());
+    if (it != sites_.end()) {
+        it->second.bytes -= std::min(it->second.bytes, static_cast<uint64_t>(a.size));
+        it->second.count -= std::min<uint64_t>(it->second.count, 1);
+        if (it->second.count == 0) {
+            sites_.erase(it);
+        }
+    }
+    space_.release(a.ptr, block_end(a));
+}
+
+void live_state::apply(const record& rec)
+{
+    if (rec.operation == HEAP_OP_INIT) {
+        /* The target restarted: its clock starts over, and so does the rate */
+        sites_.clear();
+        rate_.clear();
+        if (options_.heap_size == 0 && (rec.arg3 & HEAP_INIT_FLAG_HEAP_INFO_VALID)) {
+            space_.reset(rec.arg1, static_cast<uint64_t>(rec.arg1) + rec.arg2);
+            region_known_ = true;
+        } else {
+            space_.reset(options_.heap_base, options_.heap_base + options_.heap_size);
+            region_known_ = options_.heap_size != 0;
+        }
+    }
+
+    replay_step step = replay_.apply(rec);
+    if (step.freed) {
+        released(*step.freed);
+    }
+    if (step.allocated) {
+        allocated(*step.allocated);
+    }
+}
+
+live_sample live_state::sample() const
+{
+    live_sample s;
+    auto value = [&](const char* name, double v) { s.values.emplace_back(name, v); };
+
+    value("records", static_cast<double>(replay_.records()));
+    value("time_us", static_cast<double>(replay_.time_us()));
+    value("live_bytes", static_cast<double>(replay_.live_bytes()));
+    value("live_objects", static_cast<double>(replay_.live_objects()));
+    value("peak_bytes", static_cast<double>(replay_.peak_bytes()));
+    value("total_allocs", static_cast<double>(replay_.total_allocs()));
+    value("failed_allocs", static_cast<double>(replay_.failed_allocs()));
+
+    /* Rate over the complete slots of the window ending now */
+    uint64_t slot_us = std::max<uint64_t>(options_.rate_window_us / 10, 1);
+    uint64_t now_slot = replay_.time_us() / slot_us;
+    uint64_t count = 0, bytes = 0;
+    for (const rate_bucket& b : rate_) {
+        if (b.slot + 10 > now_slot) {
+            count += b.count;
+            bytes += b.bytes;
+        }
+    }
+    double window_s = static_cast<double>(slot_us * 10) / 1e6;
+    value("alloc_rate", static_cast<double>(count) / window_s);
+    value("byte_rate", static_cast<double>(bytes) / window_s);
+
+    if (region_known_) {
+        value("heap_size", static_cast<double>(space_.region_size()));
+        value("free_bytes", static_cast<double>(space_.total_free()));
+        value("largest_free", static_cast<double>(space_.largest_free()));
+        value("free_gaps", static_cast<double>(space_.gaps()));
+        value("fragmentation", space_.fragmentation());
+    }
+
+    for (const auto& [key, site] : sites_) {
+        s.top.push_back(site);
+    }
+    auto heavier = [](const live_site& a, const live_site& b) {
+        return a.bytes != b.bytes ? a.bytes > b.bytes : a.key < b.key;
+    };
+    size_t n = std::min(options_.top, s.top.size());
+    std::partial_sort(s.top.begin(), s.top.begin() + static_cast<std::ptrdiff_t>(n), s.top.end(), heavier);
+    s.top.resize(n);
+    return s;
+}
+
+namespace
+{
+
+std::string key_string(uint64_t key)
+{
+    char text[24];
+    std::snprintf(text, sizeof(text), "s%016" PRIx64, key);
+    return text;
+}
+
+void append_number(std::string& out, double v)
+{
+    char text[40];
+    if (v == static_cast<double>(static_cast<int64_t>(v))) {
+        std::snprintf(text, sizeof(text), "%" PRId64, static_cast<int64_t>(v));
+    } else {
+        std::snprintf(text, sizeof(text), "%.6g", v);
+    }
+    out += text;
+}
+
+}  // namespace
+
+std::string json_string(const std::string& text)
+{
+    std::string out = "\"";
+    for (unsigned char c : text) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            default:
+                if (c < 0x20) {
+                    char escape[8];
+                    std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+                    out += escape;
+                } else {
+                    out += static_cast<char>(c);
+                }
+        }
+    }
+    return out + "\"";
+}
+
+std::string live_delta_json(const live_sample& sample, live_view& view, const symbolizer& symbols)
+{
+    bool full = (view.seq == 0);
+    std::string values;
+    for (const auto& [name, v] : sample.values) {
+        auto it = view.values.find(name);
+        if (!full && it != view.values.end() && it->second == v) {
+            continue;
+        }
+        view.values[name] = v;
+        values += values.empty() ? "" : ",";
+        values += json_string(name) + ":";
+        append_number(values, v);
+    }
+
+    std::vector<uint64_t> order;
+    std::string set;
+    for (const live_site& s : sample.top) {
+        order.push_back(s.key);
+        auto it = view.top.find(s.key);
+        if (!full && it != view.top.end() && it->second == std::make_pair(s.bytes, s.count)) {
+            continue;
+        }
+        set += set.empty() ? "" : ",";
+        set += "{\"key\":\"" + key_string(s.key) + "\",\"name\":" + json_string(symbols.name(callsite::from_key(s.key))) +
+               ",\"bytes\":" + std::to_string(s.bytes) + ",\"count\":" + std::to_string(s.count) + "}";
+    }
+    bool order_changed = full || order != view.order;
+    if (values.empty() && set.empty() && !order_changed) {
+        return "";
+    }
+
+    view.top.clear();
+    for (const live_site& s : sample.top) {
+        view.top[s.key] = {s.bytes, s.count};
+    }
+    view.order = order;
+
+    std::string out = "{\"seq\":" + std::to_string(++view.seq) + ",\"full\":" + (full ? "true" : "false") +
+                      ",\"values\":{" + values + "},\"top\":{\"order\":[";
+    for (size_t i = 0; i < order.size(); i++) {
+        out += (i ? ",\"" : "\"") + key_string(order[i]) + "\"";
+    }
+    return out + "],\"set\":[" + set + "]}}";
+}
+
+}  // namespace heapinst::analyzer
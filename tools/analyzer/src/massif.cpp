@@ -0,0 +1,248 @@
+/**
+ * @file massif.cpp
+ * @brief Streaming massif.out writer.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/massif.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "heapInstAnalyzer/replay.hpp"
+#include "heapInstAnalyzer/thinning.hpp"
+
+namespace heapinst::analyzer
+{
+
+namespace
+{
+
+struct tree_node {
+    uint64_t site_key;
+    uint64_t bytes;
+};
+
+struct snapshot {
+    uint64_t time = 0;
+    uint64_t heap = 0;
+    uint64_t extra = 0;
+    uint64_t stacks = 0;
+    std::vector<tree_node> tree; /* above threshold, heaviest first */
+    uint64_t below_bytes = 0;
+    uint64_t below_places = 0;
+    bool is_peak = false;
+};
+
+class massif_builder
+{
+   public:
+    explicit massif_builder(const massif_options& options) : options_(options)
+    {
+        if (options.time_unit != "ms" && options.time_unit != "B" && options.time_unit != "i") {
+            throw std::invalid_argument("massif time unit must be ms, B or i");
+        }
+        if (options_.max_snapshots < 2) {
+            options_.max_snapshots = 2;
+        }
+    }
+
+    void feed(const record& rec)
+    {
+        bool may_shrink = rec.operation == HEAP_OP_FREE || rec.operation == HEAP_OP_REALLOC ||
+                          rec.operation == HEAP_OP_INIT;
+        if (peak_pending_ && may_shrink) {
+            /* The heap is at its peak right before the first possible decrease */
+            peak_ = capture();
+            peak_->is_peak = true;
+            peak_pending_ = false;
+        }
+
+        replay_step step = replay_.apply(rec);
+        if (rec.operation == HEAP_OP_INIT) {
+            by_site_.clear();
+        }
+        if (step.freed) {
+            account(*step.freed, -1);
+        }
+        if (step.allocated) {
+            account(*step.allocated, +1);
+        }
+        if (rec.operation == HEAP_OP_STACK_HWM) {
+            stacks_[rec.arg1] = rec.arg2;
+        }
+
+        if (replay_.live_bytes() > peak_bytes_) {
+            peak_bytes_ = replay_.live_bytes();
+            peak_pending_ = true;
+        }
+
+        if (rec.operation == HEAP_OP_MALLOC || rec.operation == HEAP_OP_FREE || rec.operation == HEAP_OP_REALLOC) {
+            if (snapshots_.empty() || now() >= snapshots_.back().time + interval_) {
+                take();
+            }
+        }
+    }
+
+    void write(const symbolizer& symbols, std::ostream& out)
+    {
+        if (peak_pending_) {
+            peak_ = capture();
+            peak_->is_peak = true;
+        }
+        take();
+
+        std::vector<snapshot> all = snapshots_;
+        if (peak_) {
+            auto pos = std::upper_bound(all.begin(), all.end(), peak_->time,
+                                        [](uint64_t t, const snapshot& s) { return t < s.time; });
+            all.insert(pos, *peak_);
+        }
+
+        out << "desc: --time-unit=" << options_.time_unit << "\n";
+        out << "cmd: " << options_.cmd << "\n";
+        out << "time_unit: " << options_.time_unit << "\n";
+
+        for (size_t i = 0; i < all.size(); i++) {
+            const snapshot& s = all[i];
+            out << "#-----------\nsnapshot=" << i << "\n#-----------\n";
+            out << "time=" << s.time << "\n";
+            out << "mem_heap_B=" << s.heap << "\n";
+            out << "mem_heap_extra_B=" << s.extra << "\n";
+            out << "mem_stacks_B=" << s.stacks << "\n";
+
+            bool detailed = s.is_peak || (options_.detailed_freq != 0 && i % options_.detailed_freq == 0);
+            if (!detailed || s.heap == 0) {
+                out << "heap_tree=empty\n";
+                continue;
+            }
+            out << "heap_tree=" << (s.is_peak ? "peak" : "detailed") << "\n";
+            write_tree(s, symbols, out);
+        }
+    }
+
+   private:
+    uint64_t now() const
+    {
+        if (options_.time_unit == "B") {
+            return bytes_moved_;
+        }
+        if (options_.time_unit == "i") {
+            return replay_.records();
+        }
+        return (replay_.time_us() - replay_.first_time_us()) / 1000;
+    }
+
+    void account(const allocation& a, int direction)
+    {
+        auto& entry = by_site_[a.site.key()];
+        if (direction > 0) {
+            entry += a.size;
+        } else {
+            entry -= std::min<uint64_t>(entry, a.size);
+            if (entry == 0) {
+                by_site_.erase(a.site.key());
+            }
+        }
+        bytes_moved_ += a.size;
+    }
+
+    snapshot capture() const
+    {
+        snapshot s;
+        s.time = now();
+        s.heap = replay_.live_bytes();
+        s.extra = replay_.live_extra_bytes();
+        for (const auto& [id, hwm] : stacks_) {
+            s.stacks += hwm;
+        }
+
+        uint64_t cutoff = static_cast<uint64_t>(static_cast<double>(s.heap) * options_.threshold / 100.0);
+        for (const auto& [key, bytes] : by_site_) {
+            if (bytes > cutoff || (cutoff == 0 && bytes > 0)) {
+                s.tree.push_back({key, bytes});
+            } else if (bytes > 0) {
+                s.below_bytes += bytes;
+                s.below_places++;
+            }
+        }
+        std::sort(s.tree.begin(), s.tree.end(), [](const tree_node& a, const tree_node& b) {
+            return a.bytes != b.bytes ? a.bytes > b.bytes : a.site_key < b.site_key;
+        });
+        return s;
+    }
+
+    void take()
+    {
+        snapshot s = capture();
+        if (!snapshots_.empty() && snapshots_.back().time == s.time) {
+            snapshots_.back() = std::move(s);
+        } else {
+            snapshots_.push_back(std::move(s));
+        }
+
+        if (snapshots_.size() >= options_.max_snapshots) {
+            /* The interval is in time here, not events; thin the same way */
+            decimate(snapshots_);
+            interval_ = interval_ ? interval_ * 2 : 1;
+        }
+    }
+
+    void write_tree(const snapshot& s, const symbolizer& symbols, std::ostream& out) const
+    {
+        size_t children = s.tree.size() + (s.below_places ? 1 : 0);
+        out << "n" << children << ": " << s.heap
+            << " (heap allocation functions) malloc/new/new[], --alloc-fns, etc.\n";
+        for (const tree_node& node : s.tree) {
+            callsite site = callsite::from_key(node.site_key);
+            frame f = symbols.resolve(site);
+            char addr[16];
+            std::snprintf(addr, sizeof(addr), "0x%" PRIX32, site.site);
+            out << " n0: " << node.bytes << " " << addr << ": " << symbols.name(site);
+            if (!f.file.empty()) {
+                out << " (" << f.file << ":" << f.line << ")";
+            }
+            out << "\n";
+        }
+        if (s.below_places) {
+            char pct[16];
+            std::snprintf(pct, sizeof(pct), "%.2f", options_.threshold);
+            out << " n0: " << s.below_bytes << " in " << s.below_places << " place"
+                << (s.below_places == 1 ? "" : "s") << ", " << (s.below_places == 1 ? "" : "all ")
+                << "below massif's threshold (" << pct << "%)\n";
+        }
+    }
+
+    massif_options options_;
+    heap_replay replay_;
+    std::unordered_map<uint64_t, uint64_t> by_site_;
+    std::map<uint32_t, uint32_t> stacks_;
+    std::vector<snapshot> snapshots_;
+    std::optional<snapshot> peak_;
+    bool peak_pending_ = false;
+    uint64_t peak_bytes_ = 0;
+    uint64_t interval_ = 0;
+    uint64_t bytes_moved_ = 0;
+};
+
+}  // namespace
+
+void write_massif(record_source& source, const symbolizer& symbols, const massif_options& options,
+                  std::ostream& out)
+{
+    massif_builder builder(options);
+    record rec;
+    while (source.next(rec)) {
+        builder.feed(rec);
+    }
+    builder.write(symbols, out);
+}
+
+}  // namespace heapinst::analyzer
@@ -0,0 +1,145 @@
+/**
+ * @file merge.cpp
+ * @brief Streaming k-way timestamp merge.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/merge.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace heapinst::analyzer
+{
+
+namespace
+{
+
+constexpr size_t kNone = SIZE_MAX;
+
+/* std heaps are max-heaps: order by "comes later" */
+bool later(const auto& a, const auto& b)
+{
+    return a.time != b.time ? a.time > b.time : a.seq > b.seq;
+}
+
+uint64_t shifted(uint64_t time, int64_t offset)
+{
+    if (offset < 0 && time < static_cast<uint64_t>(-offset)) {
+        return 0;
+    }
+    return time + static_cast<uint64_t>(offset);
+}
+
+}  // namespace
+
+merge_source::merge_source(std::vector<std::unique_ptr<record_source>> inputs, merge_options options)
+    : options_(std::move(options)), current_(kNone)
+{
+    if (options_.max_pending == 0) {
+        throw std::invalid_argument("merge needs max_pending > 0");
+    }
+    inputs_.resize(inputs.size());
+    stats_.resize(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        inputs_[i].source = std::move(inputs[i]);
+        inputs_[i].offset = (i < options_.offsets_us.size()) ? options_.offsets_us[i] : 0;
+        stats_[i].offset_us = inputs_[i].offset;
+    }
+    for (size_t i = 0; i < inputs_.size(); i++) {
+        fill(i);
+        if (!inputs_[i].pending.empty()) {
+            heap_.push_back(i);
+        }
+    }
+    auto cmp = [this](size_t a, size_t b) { return before(b, a); };
+    std::make_heap(heap_.begin(), heap_.end(), cmp);
+}
+
+bool merge_source::ready(const input& in) const
+{
+    if (in.pending.empty()) {
+        return false;
+    }
+    return in.done || in.pending.front().time + options_.window_us <= in.high ||
+           in.pending.size() > options_.max_pending;
+}
+
+void merge_source::fill(size_t i)
+{
+    input& in = inputs_[i];
+    record rec;
+    while (!in.done && !ready(in)) {
+        if (!in.source->next(rec)) {
+            in.done = true;
+            break;
+        }
+        if (rec.operation == HEAP_OP_TIME_SYNC) {
+            uint64_t reference = (static_cast<uint64_t>(rec.arg2) << 32) | rec.arg1;
+            in.offset = static_cast<int64_t>(reference - rec.timestamp_us);
+            stats_[i].offset_us = in.offset;
+            stats_[i].syncs++;
+        }
+        uint64_t time = shifted(rec.timestamp_us, in.offset);
+        in.high = std::max(in.high, time);
+        in.pending.push_back({time, in.seq++, rec});
+        std::push_heap(in.pending.begin(), in.pending.end(), [](const entry& a, const entry& b) { return later(a, b); });
+    }
+}
+
+/* Earliest final record first; ties go to the lower input, then arrival */
+bool merge_source::before(size_t a, size_t b) const
+{
+    const entry& x = inputs_[a].pending.front();
+    const entry& y = inputs_[b].pending.front();
+    if (x.time != y.time) {
+        return x.time < y.time;
+    }
+    return a < b;
+}
+
+bool merge_source::next(record& out)
+{
+    auto cmp = [this](size_t a, size_t b) { return before(b, a); };
+
+    if (current_ != kNone) {
+        size_t i = current_;
+        current_ = kNone;
+        fill(i);
+        if (!inputs_[i].pending.empty()) {
+            if (heap_.empty() || !before(heap_.front(), i)) {
+                /* Still the earliest: keep draining it without touching the heap */
+                current_ = i;
+            } else {
+                heap_.push_back(i);
+                std::push_heap(heap_.begin(), heap_.end(), cmp);
+            }
+        }
+    }
+    if (current_ == kNone) {
+        if (heap_.empty()) {
+            return false;
+        }
+        std::pop_heap(heap_.begin(), heap_.end(), cmp);
+        current_ = heap_.back();
+        heap_.pop_back();
+    }
+
+    input& in = inputs_[current_];
+    std::pop_heap(in.pending.begin(), in.pending.end(), [](const entry& a, const entry& b) { return later(a, b); });
+    entry& e = in.pending.back();
+    merge_input_stats& stats = stats_[current_];
+    stats.records++;
+    if (e.time < last_out_) {
+        stats.late++;
+        e.time = last_out_;
+    }
+    last_out_ = e.time;
+    out = e.rec;
+    out.timestamp_us = e.time;
+    in.pending.pop_back();
+    return true;
+}
+
+}  // namespace heapinst::analyzer
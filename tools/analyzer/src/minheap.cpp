@@ -0,0 +1,279 @@
+/**
+ * @file minheap.cpp
+ * @brief Free-list allocator model and heap size search.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/minheap.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+#include "heapInstAnalyzer/replay.hpp"
+
+namespace heapinst::analyzer
+{
+
+namespace
+{
+
+constexpr uint64_t kNoChunk = UINT64_MAX;
+
+/*
+ * Free chunks indexed by address (first-fit, coalescing) and by size
+ * (best-fit). Offsets are relative to the region start.
+ */
+class region_model
+{
+   public:
+    region_model(const allocator_model& model, uint64_t size) : model_(model) { insert_free(0, size); }
+
+    uint64_t allocate(uint64_t need)
+    {
+        std::map<uint64_t, uint64_t>::iterator chunk;
+        if (model_.policy == allocator_model::fit::best) {
+            auto it = by_size_.lower_bound({need, 0});
+            if (it == by_size_.end()) {
+                return kNoChunk;
+            }
+            chunk = by_addr_.find(it->second);
+        } else {
+            chunk = by_addr_.begin();
+            while (chunk != by_addr_.end() && chunk->second < need) {
+                ++chunk;
+            }
+            if (chunk == by_addr_.end()) {
+                return kNoChunk;
+            }
+        }
+
+        uint64_t offset = chunk->first;
+        uint64_t length = chunk->second;
+        erase_free(chunk);
+        if (length - need >= model_.min_chunk) {
+            insert_free(offset + need, length - need);
+        } else {
+            need = length; /* remainder too small to split off */
+        }
+        used_[offset] = need;
+        return offset;
+    }
+
+    void release(uint64_t offset)
+    {
+        auto used = used_.find(offset);
+        if (used == used_.end()) {
+            return;
+        }
+        uint64_t length = used->second;
+        used_.erase(used);
+
+        /* Coalesce with free neighbours */
+        auto next = by_addr_.lower_bound(offset);
+        if (next != by_addr_.end() && next->first == offset + length) {
+            length += next->second;
+            next = erase_free(next);
+        }
+        if (next != by_addr_.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                offset = prev->first;
+                length += prev->second;
+                erase_free(prev);
+            }
+        }
+        insert_free(offset, length);
+    }
+
+    /* Grow or shrink in place; false if the chunk cannot hold need */
+    bool resize(uint64_t offset, uint64_t need)
+    {
+        uint64_t& length = used_.at(offset);
+        if (need <= length) {
+            if (length - need >= model_.min_chunk) {
+                uint64_t tail = length - need;
+                length = need;
+                used_[offset + need] = tail;
+                release(offset + need);
+            }
+            return true;
+        }
+        auto next = by_addr_.find(offset + length);
+        if (next == by_addr_.end() || length + next->second < need) {
+            return false;
+        }
+        uint64_t total = length + next->second;
+        erase_free(next);
+        if (total - need >= model_.min_chunk) {
+            insert_free(offset + need, total - need);
+            length = need;
+        } else {
+            length = total;
+        }
+        return true;
+    }
+
+   private:
+    void insert_free(uint64_t offset, uint64_t length)
+    {
+        by_addr_[offset] = length;
+        by_size_.insert({length, offset});
+    }
+
+    std::map<uint64_t, uint64_t>::iterator erase_free(std::map<uint64_t, uint64_t>::iterator it)
+    {
+        by_size_.erase({it->second, it->first});
+        return by_addr_.erase(it);
+    }
+
+    const allocator_model& model_;
+    std::map<uint64_t, uint64_t> by_addr_;
+    std::set<std::pair<uint64_t, uint64_t>> by_size_;
+    std::unordered_map<uint64_t, uint64_t> used_;
+};
+
+}  // namespace
+
+heap_workload heap_workload::from(record_source& source)
+{
+    heap_workload w;
+    std::unordered_map<uint32_t, uint32_t> block_of; /* live pointer -> block id */
+    heap_replay replay;
+    record rec;
+
+    while (source.next(rec)) {
+        replay_step step = replay.apply(rec);
+        if (rec.operation == HEAP_OP_INIT) {
+            w.heap_base_ = replay.heap_base();
+            w.heap_size_ = replay.heap_size();
+            /* A restart releases everything */
+            for (const auto& [ptr, block] : block_of) {
+                w.events_.push_back({op::free, block, 0, 0});
+            }
+            block_of.clear();
+            continue;
+        }
+
+        std::optional<uint32_t> old_block;
+        if (step.freed) {
+            auto it = block_of.find(step.freed->ptr);
+            if (it != block_of.end()) {
+                old_block = it->second;
+                block_of.erase(it);
+            }
+        }
+        if (step.allocated) {
+            uint32_t block = w.blocks_++;
+            block_of[step.allocated->ptr] = block;
+            if (step.is_realloc && old_block) {
+                w.events_.push_back({op::realloc, block, step.allocated->size, *old_block});
+                continue;
+            }
+            if (old_block) {
+                w.events_.push_back({op::free, *old_block, 0, 0});
+            }
+            w.events_.push_back({op::alloc, block, step.allocated->size, 0});
+        } else if (old_block) {
+            w.events_.push_back({op::free, *old_block, 0, 0});
+        }
+    }
+    w.peak_requested_ = replay.peak_bytes();
+    return w;
+}
+
+uint64_t min_heap_lower_bound(const heap_workload& workload, const allocator_model& model)
+{
+    std::vector<uint64_t> chunk(workload.blocks(), 0);
+    uint64_t live = 0, peak = 0;
+    for (const auto& e : workload.events()) {
+        switch (e.kind) {
+            case heap_workload::op::alloc:
+                chunk[e.block] = model.chunk_size(e.size);
+                live += chunk[e.block];
+                break;
+            case heap_workload::op::free:
+                live -= chunk[e.block];
+                break;
+            case heap_workload::op::realloc:
+                /* Best case is in place: the old chunk is not held alongside */
+                chunk[e.block] = model.chunk_size(e.size);
+                live += chunk[e.block];
+                live -= chunk[e.old_block];
+                break;
+        }
+        peak = std::max(peak, live);
+    }
+    return peak;
+}
+
+bool workload_fits(const heap_workload& workload, const allocator_model& model, uint64_t region_size)
+{
+    region_model region(model, region_size);
+    std::vector<uint64_t> offset(workload.blocks(), kNoChunk);
+
+    for (const auto& e : workload.events()) {
+        switch (e.kind) {
+            case heap_workload::op::alloc:
+                offset[e.block] = region.allocate(model.chunk_size(e.size));
+                if (offset[e.block] == kNoChunk) {
+                    return false;
+                }
+                break;
+            case heap_workload::op::free:
+                region.release(offset[e.block]);
+                break;
+            case heap_workload::op::realloc: {
+                uint64_t need = model.chunk_size(e.size);
+                if (region.resize(offset[e.old_block], need)) {
+                    offset[e.block] = offset[e.old_block];
+                    break;
+                }
+                offset[e.block] = region.allocate(need);
+                if (offset[e.block] == kNoChunk) {
+                    return false;
+                }
+                region.release(offset[e.old_block]);
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+uint64_t min_heap_size(const heap_workload& workload, const allocator_model& model)
+{
+    uint64_t lo = min_heap_lower_bound(workload, model);
+    if (lo == 0) {
+        return 0;
+    }
+    if (workload_fits(workload, model, lo)) {
+        return lo;
+    }
+
+    /* Find a fitting upper bound, then bisect in align steps */
+    uint64_t hi = lo * 2;
+    while (!workload_fits(workload, model, hi)) {
+        lo = hi;
+        hi *= 2;
+    }
+    while (hi - lo > model.align) {
+        uint64_t mid = (lo + (hi - lo) / 2) & ~static_cast<uint64_t>(model.align - 1);
+        if (mid <= lo) {
+            break;
+        }
+        if (workload_fits(workload, model, mid)) {
+            hi = mid;
+        } else {
+            lo = mid;
+        }
+    }
+    return hi;
+}
+
+}  // namespace heapinst::analyzer
@@ -0,0 +1,223 @@
+/**
+ * @file peak.cpp
+ * @brief Peak search and live-set breakdown.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/peak.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cinttypes>
+#include <cstdio>
+#include <iterator>
+#include <map>
+
+namespace heapinst::analyzer
+{
+
+namespace
+{
+
+/* Age buckets (upper bounds, microseconds) */
+constexpr uint64_t kAgeBuckets[] = {1000, 10000, 100000, 1000000, 10000000, 60000000, UINT64_MAX};
+
+/* Where the range starts/stops as the trace is replayed */
+class range_tracker
+{
+   public:
+    explicit range_tracker(const peak_options& options) : options_(options)
+    {
+        inside_ = options.from.type == trace_point::kind::end;
+    }
+
+    /* Returns false once the range has ended (stop before applying rec) */
+    bool before(const record& rec)
+    {
+        if (!inside_ && options_.from.type == trace_point::kind::time && rec.timestamp_us >= options_.from.value) {
+            inside_ = true;
+        }
+        return !options_.to.after(rec) && !done_;
+    }
+
+    void after(const record& rec)
+    {
+        if (!inside_ && options_.from.at(rec)) {
+            inside_ = true;
+        } else if (inside_ && options_.to.at(rec)) {
+            done_ = true;
+        }
+    }
+
+    bool inside() const noexcept { return inside_; }
+
+   private:
+    const peak_options& options_;
+    bool inside_ = false;
+    bool done_ = false;
+};
+
+std::vector<peak_group> sorted_groups(const std::map<uint64_t, peak_group>& groups, bool by_weight)
+{
+    std::vector<peak_group> out;
+    std::transform(groups.begin(), groups.end(), std::back_inserter(out), [](const auto& kv) { return kv.second; });
+    if (by_weight) {
+        std::stable_sort(out.begin(), out.end(), [](const peak_group& a, const peak_group& b) { return a.bytes > b.bytes; });
+    }
+    return out;
+}
+
+void add(std::map<uint64_t, peak_group>& groups, uint64_t key, const allocation& a)
+{
+    peak_group& g = groups[key];
+    g.key = key;
+    g.bytes += a.size;
+    g.usable += std::max(a.usable, a.size);
+    g.count++;
+}
+
+}  // namespace
+
+peak_report analyze_peak(const source_factory& open, const peak_options& options)
+{
+    peak_report report;
+
+    /* Pass 1: locate the peak within the range */
+    {
+        auto source = open();
+        range_tracker range(options);
+        heap_replay replay;
+        bool entered = false;
+        record rec;
+        while (source->next(rec) && range.before(rec)) {
+            bool was_inside = range.inside();
+            replay.apply(rec);
+            range.after(rec);
+            if (!was_inside && !range.inside()) {
+                continue;
+            }
+            uint64_t index = replay.records() - 1;
+            if (!entered) {
+                entered = true;
+                report.range_first = index;
+            }
+            report.range_last = index;
+            if (!report.found || replay.live_bytes() > report.bytes) {
+                report.found = true;
+                report.bytes = replay.live_bytes();
+                report.objects = replay.live_objects();
+                report.time_us = rec.timestamp_us;
+                report.index = index;
+            }
+        }
+    }
+    if (!report.found) {
+        return report;
+    }
+
+    /* Pass 2: rebuild the live set at the peak record */
+    heap_replay replay;
+    {
+        auto source = open();
+        record rec;
+        while (replay.records() <= report.index && source->next(rec)) {
+            replay.apply(rec);
+        }
+    }
+
+    std::map<uint64_t, peak_group> sites, tags, sizes, ages;
+    for (const auto& [ptr, a] : replay.live()) {
+        add(sites, a.site.key(), a);
+        add(tags, a.tag, a);
+        add(sizes, a.size ? std::bit_floor(static_cast<uint64_t>(a.size)) : 0, a);
+        uint64_t age = report.time_us >= a.time_us ? report.time_us - a.time_us : 0;
+        add(ages, *std::upper_bound(std::begin(kAgeBuckets), std::end(kAgeBuckets) - 1, age), a);
+        report.usable_known = report.usable_known || a.usable != 0;
+    }
+    report.by_site = sorted_groups(sites, true);
+    report.by_tag = sorted_groups(tags, true);
+    report.by_size = sorted_groups(sizes, false);
+    report.by_age = sorted_groups(ages, false);
+    return report;
+}
+
+void write_peak_report(const peak_report& report, const symbolizer& symbols, size_t top, std::ostream& out)
+{
+    if (!report.found) {
+        out << "no records in range\n";
+        return;
+    }
+
+    char line[160];
+    auto pct = [&](uint64_t bytes) { return report.bytes ? 100.0 * static_cast<double>(bytes) / static_cast<double>(report.bytes) : 0.0; };
+
+    std::snprintf(line, sizeof(line), "peak: %" PRIu64 " bytes in %" PRIu64 " blocks at %" PRIu64 " us (record %" PRIu64
+                  ", range %" PRIu64 "-%" PRIu64 ")\n",
+                  report.bytes, report.objects, report.time_us, report.index, report.range_first, report.range_last);
+    out << line;
+
+    out << "\nby callsite:\n";
+    for (size_t i = 0; i < report.by_site.size() && i < top; i++) {
+        const peak_group& g = report.by_site[i];
+        std::snprintf(line, sizeof(line), "  %10" PRIu64 " B %5.1f%% %8" PRIu64 " blocks  ", g.bytes, pct(g.bytes), g.count);
+        out << line << symbols.name(callsite::from_key(g.key)) << "\n";
+    }
+    if (report.by_site.size() > top) {
+        uint64_t bytes = 0, count = 0;
+        for (size_t i = top; i < report.by_site.size(); i++) {
+            bytes += report.by_site[i].bytes;
+            count += report.by_site[i].count;
+        }
+        std::snprintf(line, sizeof(line), "  %10" PRIu64 " B %5.1f%% %8" PRIu64 " blocks  (%zu more callsites)\n", bytes,
+                      pct(bytes), count, report.by_site.size() - top);
+        out << line;
+    }
+
+    out << "\nby tag:\n";
+    for (const peak_group& g : report.by_tag) {
+        std::snprintf(line, sizeof(line), "  %10" PRIu64 " B %5.1f%% %8" PRIu64 " blocks  tag %" PRIu64 "\n", g.bytes,
+                      pct(g.bytes), g.count, g.key);
+        out << line;
+    }
+
+    out << (report.usable_known ? "\nby size class (requested, usable, slack):\n" : "\nby size class:\n");
+    auto slack_pct = [](const peak_group& g) {
+        return g.usable ? 100.0 * static_cast<double>(g.slack()) / static_cast<double>(g.usable) : 0.0;
+    };
+    peak_group total;
+    for (const peak_group& g : report.by_size) {
+        char range[48];
+        std::snprintf(range, sizeof(range), "[%" PRIu64 ", %" PRIu64 ")", g.key, g.key ? g.key * 2 : 1);
+        int n = std::snprintf(line, sizeof(line), "  %10" PRIu64 " B %5.1f%% %8" PRIu64 " blocks  %-*s", g.bytes,
+                              pct(g.bytes), g.count, report.usable_known ? 12 : 0, range);
+        if (report.usable_known) {
+            std::snprintf(line + n, sizeof(line) - static_cast<size_t>(n), "  %10" PRIu64 " B  %8" PRIu64 " B %5.1f%%",
+                          g.usable, g.slack(), slack_pct(g));
+        }
+        out << line << "\n";
+        total.bytes += g.bytes;
+        total.usable += g.usable;
+    }
+    if (report.usable_known) {
+        std::snprintf(line, sizeof(line), "  slack at peak: %" PRIu64 " B of %" PRIu64 " B usable (%.1f%%)\n", total.slack(),
+                      total.usable, slack_pct(total));
+        out << line;
+    }
+
+    out << "\nby age at peak:\n";
+    for (const peak_group& g : report.by_age) {
+        auto it = std::find(std::begin(kAgeBuckets), std::end(kAgeBuckets), g.key);
+        uint64_t lower = (it == std::begin(kAgeBuckets)) ? 0 : *(it - 1);
+        if (g.key == UINT64_MAX) {
+            std::snprintf(line, sizeof(line), "  %10" PRIu64 " B %5.1f%% %8" PRIu64 " blocks  >= %" PRIu64 " ms\n", g.bytes,
+                          pct(g.bytes), g.count, lower / 1000);
+        } else {
+            std::snprintf(line, sizeof(line), "  %10" PRIu64 " B %5.1f%% %8" PRIu64 " blocks  < %" PRIu64 " ms\n", g.bytes,
+                          pct(g.bytes), g.count, g.key / 1000);
+        }
+        out << line;
+    }
+}
+
+}  // namespace heapinst::analyzer
@@ -0,0 +1,202 @@
+/**
+ * @file pprof.cpp
+ * @brief Minimal profile.proto encoder for heap profiles.
+ *
+ * Hand-rolled protobuf wire format (varints and length-delimited fields
+ * only) to avoid a protobuf dependency for the handful of messages used.
+ * Field numbers follow github.com/google/pprof/proto/profile.proto.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/pprof.hpp"
+
+#include <string>
+#include <unordered_map>
+
+namespace heapinst::analyzer
+{
+
+namespace
+{
+
+/* Profile */
+constexpr uint32_t kProfileSampleType = 1;
+constexpr uint32_t kProfileSample = 2;
+constexpr uint32_t kProfileMapping = 3;
+constexpr uint32_t kProfileLocation = 4;
+constexpr uint32_t kProfileFunction = 5;
+constexpr uint32_t kProfileStringTable = 6;
+constexpr uint32_t kProfileTimeNanos = 9;
+constexpr uint32_t kProfileDurationNanos = 10;
+constexpr uint32_t kProfilePeriodType = 11;
+constexpr uint32_t kProfilePeriod = 12;
+constexpr uint32_t kProfileComment = 13;
+constexpr uint32_t kProfileDefaultSampleType = 14;
+
+class proto_writer
+{
+   public:
+    void varint(uint32_t field, uint64_t value)
+    {
+        key(field, 0);
+        raw_varint(value);
+    }
+
+    void bytes(uint32_t field, const std::string& data)
+    {
+        key(field, 2);
+        raw_varint(data.size());
+        buf_ += data;
+    }
+
+    void message(uint32_t field, const proto_writer& sub) { bytes(field, sub.buf_); }
+
+    /* Packed repeated varints (the proto3 default for repeated scalars) */
+    template <class Range>
+    void packed(uint32_t field, const Range& values)
+    {
+        proto_writer sub;
+        for (auto v : values) {
+            sub.raw_varint(static_cast<uint64_t>(v));
+        }
+        bytes(field, sub.buf_);
+    }
+
+    const std::string& data() const noexcept { return buf_; }
+
+   private:
+    void key(uint32_t field, uint32_t wire_type) { raw_varint((static_cast<uint64_t>(field) << 3) | wire_type); }
+
+    void raw_varint(uint64_t value)
+    {
+        while (value >= 0x80) {
+            buf_.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        buf_.push_back(static_cast<char>(value));
+    }
+
+    std::string buf_;
+};
+
+class string_table
+{
+   public:
+    string_table() { intern(""); /* index 0 must be the empty string */ }
+
+    int64_t intern(const std::string& s)
+    {
+        auto [it, inserted] = index_.try_emplace(s, static_cast<int64_t>(strings_.size()));
+        if (inserted) {
+            strings_.push_back(s);
+        }
+        return it->second;
+    }
+
+    const std::vector<std::string>& strings() const noexcept { return strings_; }
+
+   private:
+    std::unordered_map<std::string, int64_t> index_;
+    std::vector<std::string> strings_;
+};
+
+proto_writer value_type(string_table& strings, const char* type, const char* unit)
+{
+    proto_writer vt;
+    vt.varint(1, strings.intern(type));
+    vt.varint(2, strings.intern(unit));
+    return vt;
+}
+
+}  // namespace
+
+void write_pprof(const heap_profile& profile, const symbolizer& symbols, std::ostream& out)
+{
+    string_table strings;
+    proto_writer pb;
+
+    static const char* const kSampleTypes[] = {"alloc_objects", "alloc_space", "inuse_objects", "inuse_space"};
+    static const char* const kSampleUnits[] = {"count", "bytes", "count", "bytes"};
+    for (size_t i = 0; i < 4; i++) {
+        pb.message(kProfileSampleType, value_type(strings, kSampleTypes[i], kSampleUnits[i]));
+    }
+
+    /* One location (and function) per distinct callsite, ids from 1 */
+    std::unordered_map<uint64_t, uint64_t> location_ids;
+    std::unordered_map<std::string, uint64_t> function_ids;
+    proto_writer functions, locations;
+    const int64_t tag_key = strings.intern("tag");
+
+    for (const profile_entry& e : profile.entries) {
+        auto [loc, inserted] = location_ids.try_emplace(e.site.key(), location_ids.size() + 1);
+        if (inserted) {
+            frame f = symbols.resolve(e.site);
+            std::string name = symbols.name(e.site);
+
+            auto [fn, new_function] = function_ids.try_emplace(name, function_ids.size() + 1);
+            if (new_function) {
+                proto_writer function;
+                function.varint(1, fn->second);
+                function.varint(2, strings.intern(name));
+                function.varint(3, strings.intern(name));
+                if (!f.file.empty()) {
+                    function.varint(4, strings.intern(f.file));
+                }
+                functions.message(kProfileFunction, function);
+            }
+
+            proto_writer line;
+            line.varint(1, fn->second);
+            if (f.line != 0) {
+                line.varint(2, f.line);
+            }
+            proto_writer location;
+            location.varint(1, loc->second);
+            location.varint(2, 1); /* mapping */
+            if (!e.site.is_site_id) {
+                location.varint(3, e.site.site);
+            }
+            location.message(4, line);
+            locations.message(kProfileLocation, location);
+        }
+
+        proto_writer sample;
+        sample.packed(1, std::initializer_list<uint64_t>{loc->second});
+        sample.packed(2, std::initializer_list<uint64_t>{e.alloc_objects, e.alloc_space, e.inuse_objects,
+                                                         e.inuse_space});
+        if (e.tag != 0) {
+            proto_writer label;
+            label.varint(1, tag_key);
+            label.varint(3, e.tag);
+            sample.message(3, label);
+        }
+        pb.message(kProfileSample, sample);
+    }
+
+    proto_writer mapping;
+    mapping.varint(1, 1);
+    mapping.varint(3, UINT32_MAX);
+    mapping.varint(5, strings.intern("firmware"));
+    mapping.varint(7, 1); /* has_functions */
+    pb.message(kProfileMapping, mapping);
+
+    std::string body = pb.data() + locations.data() + functions.data();
+
+    /* Scalars and the string table go last: everything above interns into it */
+    proto_writer tail;
+    tail.varint(kProfileTimeNanos, profile.end_us * 1000);
+    tail.varint(kProfileDurationNanos, (profile.end_us - profile.start_us) * 1000);
+    tail.message(kProfilePeriodType, value_type(strings, "space", "bytes"));
+    tail.varint(kProfilePeriod, 1);
+    tail.varint(kProfileComment, strings.intern("heapInst trace, " + std::to_string(profile.records) + " records"));
+    tail.varint(kProfileDefaultSampleType, strings.intern("inuse_space"));
+    for (const std::string& s : strings.strings()) {
+        tail.bytes(kProfileStringTable, s);
+    }
+
+    out.write(body.data(), static_cast<std::streamsize>(body.size()));
+    out.write(tail.data().data(), static_cast<std::streamsize>(tail.data().size()));
+}
+
+}  // namespace heapinst::analyzer
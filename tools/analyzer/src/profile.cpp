@@ -0,0 +1,244 @@
+/**
+ * @file profile.cpp
+ * @brief Per-callsite aggregation of allocations and live blocks.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/profile.hpp"
+
+#include "heapInstAnalyzer/external_sort.hpp"
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <tuple>
+#include <utility>
+
+namespace heapinst::analyzer
+{
+
+namespace
+{
+
+void sort_entries(std::vector<profile_entry>& entries)
+{
+    std::stable_sort(entries.begin(), entries.end(), [](const profile_entry& a, const profile_entry& b) {
+        return std::tie(a.inuse_space, a.alloc_space) > std::tie(b.inuse_space, b.alloc_space);
+    });
+}
+
+/* Partial per-(callsite, tag) sums, merged after sorting */
+struct agg_item {
+    uint64_t site_key;
+    uint64_t alloc_objects;
+    uint64_t alloc_space;
+    uint64_t inuse_objects;
+    uint64_t inuse_space;
+    uint16_t tag;
+
+    bool operator<(const agg_item& o) const { return std::tie(site_key, tag) < std::tie(o.site_key, o.tag); }
+};
+
+/* One pointer event: the allocating or releasing side of a block */
+struct ptr_event {
+    uint32_t ptr;
+    uint32_t size;
+    uint64_t seq;
+    uint64_t site_key;
+    uint32_t epoch; /* INITs seen before the event */
+    uint16_t tag;
+    uint8_t is_alloc;
+
+    bool operator<(const ptr_event& o) const { return std::tie(ptr, seq) < std::tie(o.ptr, o.seq); }
+};
+
+/* Combines partial sums in a bounded table, spilling it when full */
+class agg_combiner
+{
+   public:
+    agg_combiner(size_t table_items, external_sorter<agg_item>& sorter) : limit_(table_items), sorter_(sorter) {}
+
+    void add(const agg_item& item)
+    {
+        auto [it, inserted] = table_.try_emplace(std::make_pair(item.site_key, item.tag), item);
+        if (!inserted) {
+            it->second.alloc_objects += item.alloc_objects;
+            it->second.alloc_space += item.alloc_space;
+            it->second.inuse_objects += item.inuse_objects;
+            it->second.inuse_space += item.inuse_space;
+        } else if (table_.size() >= limit_) {
+            flush();
+        }
+    }
+
+    void flush()
+    {
+        for (const auto& [key, item] : table_) {
+            sorter_.add(item);
+        }
+        table_.clear();
+    }
+
+   private:
+    size_t limit_;
+    external_sorter<agg_item>& sorter_;
+    std::map<std::pair<uint64_t, uint16_t>, agg_item> table_;
+};
+
+}  // namespace
+
+heap_profile build_heap_profile(record_source& source, const trace_point& point)
+{
+    using key = std::pair<uint64_t, uint16_t>;
+    std::map<key, profile_entry> entries;
+    auto entry_for = [&entries](const allocation& a) -> profile_entry& {
+        profile_entry& e = entries[{a.site.key(), a.tag}];
+        e.site = a.site;
+        e.tag = a.tag;
+        return e;
+    };
+
+    heap_replay replay;
+    record rec;
+    while (source.next(rec)) {
+        if (point.after(rec)) {
+            break;
+        }
+        replay_step step = replay.apply(rec);
+        if (step.allocated) {
+            profile_entry& e = entry_for(*step.allocated);
+            e.alloc_objects++;
+            e.alloc_space += step.allocated->size;
+        }
+        if (point.at(rec)) {
+            break;
+        }
+    }
+
+    for (const auto& [ptr, a] : replay.live()) {
+        profile_entry& e = entry_for(a);
+        e.inuse_objects++;
+        e.inuse_space += a.size;
+    }
+
+    heap_profile profile;
+    profile.start_us = replay.first_time_us();
+    profile.end_us = replay.time_us();
+    profile.records = replay.records();
+    profile.entries.reserve(entries.size());
+    for (auto& [k, e] : entries) {
+        profile.entries.push_back(e);
+    }
+    sort_entries(profile.entries);
+    return profile;
+}
+
+heap_profile build_heap_profile_spilled(record_source& source, const trace_point& point,
+                                        const spill_options& options)
+{
+    /* Budget: half for pointer events, a quarter each for the combiner and its runs */
+    size_t event_items = std::max<size_t>(options.memory_bytes / 2 / sizeof(ptr_event), 1);
+    size_t agg_items = std::max<size_t>(options.memory_bytes / 4 / (sizeof(agg_item) + 64), 1);
+    external_sorter<ptr_event> events(event_items, options.temp_dir);
+    external_sorter<agg_item> partials(agg_items, options.temp_dir);
+    agg_combiner combiner(agg_items, partials);
+
+    heap_profile profile;
+    uint64_t seq = 0;
+    uint32_t epoch = 0;
+    record rec;
+    while (source.next(rec)) {
+        if (point.after(rec)) {
+            break;
+        }
+        if (profile.records == 0) {
+            profile.start_us = rec.timestamp_us;
+        }
+        profile.records++;
+        profile.end_us = rec.timestamp_us;
+
+        auto release = [&](uint32_t ptr) { events.add(ptr_event{ptr, 0, seq++, 0, epoch, 0, 0}); };
+        auto allocate = [&](uint32_t ptr, uint32_t size) {
+            callsite site = callsite_of(rec);
+            events.add(ptr_event{ptr, size, seq++, site.key(), epoch, rec.tag, 1});
+            combiner.add(agg_item{site.key(), 1, size, 0, 0, rec.tag});
+        };
+
+        /* Same interpretation as heap_replay::apply() */
+        switch (rec.operation) {
+            case HEAP_OP_INIT:
+                epoch++;
+                break;
+            case HEAP_OP_MALLOC:
+                if (rec.arg2 != 0) {
+                    allocate(rec.arg2, rec.arg1);
+                }
+                break;
+            case HEAP_OP_FREE:
+                if (rec.arg1 != 0) {
+                    release(rec.arg1);
+                }
+                break;
+            case HEAP_OP_REALLOC:
+                if (rec.arg3 == 0 && rec.arg2 != 0) {
+                    break;
+                }
+                if (rec.arg1 != 0) {
+                    release(rec.arg1);
+                }
+                if (rec.arg3 != 0) {
+                    allocate(rec.arg3, rec.arg2);
+                }
+                break;
+            default:
+                break;
+        }
+
+        if (point.at(rec)) {
+            break;
+        }
+    }
+
+    /* Live at the point: last event of its pointer, an allocation, in the last epoch */
+    std::optional<ptr_event> last;
+    auto settle = [&]() {
+        if (last && last->is_alloc && last->epoch == epoch) {
+            combiner.add(agg_item{last->site_key, 0, 0, 1, last->size, last->tag});
+        }
+    };
+    events.merge([&](const ptr_event& e) {
+        if (last && last->ptr != e.ptr) {
+            settle();
+        }
+        last = e;
+    });
+    settle();
+    combiner.flush();
+
+    std::optional<agg_item> current;
+    auto emit = [&]() {
+        if (current) {
+            profile.entries.push_back(profile_entry{callsite::from_key(current->site_key), current->tag,
+                                                    current->alloc_objects, current->alloc_space,
+                                                    current->inuse_objects, current->inuse_space});
+        }
+    };
+    partials.merge([&](const agg_item& item) {
+        if (current && current->site_key == item.site_key && current->tag == item.tag) {
+            current->alloc_objects += item.alloc_objects;
+            current->alloc_space += item.alloc_space;
+            current->inuse_objects += item.inuse_objects;
+            current->inuse_space += item.inuse_space;
+            return;
+        }
+        emit();
+        current = item;
+    });
+    emit();
+
+    sort_entries(profile.entries);
+    return profile;
+}
+
+}  // namespace heapinst::analyzer
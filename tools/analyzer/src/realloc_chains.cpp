@@ -0,0 +1,230 @@
+/**
+ * @file realloc_chains.cpp
+ * @brief Realloc growth-chain reconstruction and ranking.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/realloc_chains.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <queue>
+#include <unordered_map>
+
+namespace heapinst::analyzer
+{
+
+namespace
+{
+
+bool costlier(const realloc_chain& a, const realloc_chain& b)
+{
+    if (a.copied_bytes != b.copied_bytes) {
+        return a.copied_bytes > b.copied_bytes;
+    }
+    if (a.moves != b.moves) {
+        return a.moves > b.moves;
+    }
+    return a.reallocs > b.reallocs;
+}
+
+class chain_collector
+{
+   public:
+    explicit chain_collector(const chain_options& options) : options_(options) {}
+
+    void close(const realloc_chain& chain)
+    {
+        if (chain.reallocs < options_.min_reallocs) {
+            return;
+        }
+        report_.chains++;
+        report_.reallocs += chain.reallocs;
+        report_.moves += chain.moves;
+        report_.copied_bytes += chain.copied_bytes;
+
+        chain_site_summary& s = sites_[chain.origin.key()];
+        s.origin = chain.origin;
+        s.chains++;
+        s.reallocs += chain.reallocs;
+        s.moves += chain.moves;
+        s.copied_bytes += chain.copied_bytes;
+        s.max_final_size = std::max(s.max_final_size, chain.max_size);
+
+        /* Bounded min-heap on cost keeps the top chains */
+        if (options_.top == 0) {
+            return;
+        }
+        if (top_.size() < options_.top) {
+            top_.push_back(chain);
+            std::push_heap(top_.begin(), top_.end(), costlier);
+        } else if (costlier(chain, top_.front())) {
+            std::pop_heap(top_.begin(), top_.end(), costlier);
+            top_.back() = chain;
+            std::push_heap(top_.begin(), top_.end(), costlier);
+        }
+    }
+
+    chain_report finish()
+    {
+        std::sort(top_.begin(), top_.end(), costlier);
+        report_.top = std::move(top_);
+        for (auto& [key, s] : sites_) {
+            report_.by_site.push_back(s);
+        }
+        std::sort(report_.by_site.begin(), report_.by_site.end(),
+                  [](const chain_site_summary& a, const chain_site_summary& b) {
+                      if (a.copied_bytes != b.copied_bytes) {
+                          return a.copied_bytes > b.copied_bytes;
+                      }
+                      if (a.moves != b.moves) {
+                          return a.moves > b.moves;
+                      }
+                      return a.origin.key() < b.origin.key();
+                  });
+        return std::move(report_);
+    }
+
+   private:
+    chain_options options_;
+    chain_report report_;
+    std::vector<realloc_chain> top_;
+    std::unordered_map<uint64_t, chain_site_summary> sites_;
+};
+
+}  // namespace
+
+chain_report analyze_realloc_chains(record_source& source, const chain_options& options)
+{
+    chain_collector collector(options);
+    heap_replay replay;
+    std::unordered_map<uint32_t, realloc_chain> open; /* live pointer -> its chain */
+
+    auto close = [&](uint32_t ptr, uint64_t time_us) {
+        auto it = open.find(ptr);
+        if (it != open.end()) {
+            it->second.end_us = time_us;
+            collector.close(it->second);
+            open.erase(it);
+        }
+    };
+
+    record rec;
+    while (source.next(rec)) {
+        replay_step step = replay.apply(rec);
+
+        if (rec.operation == HEAP_OP_INIT) {
+            for (auto& [ptr, chain] : open) {
+                chain.end_us = rec.timestamp_us;
+                collector.close(chain);
+            }
+            open.clear();
+            continue;
+        }
+
+        if (!step.is_realloc) {
+            if (step.freed) {
+                close(step.freed->ptr, rec.timestamp_us);
+            }
+            if (step.allocated) {
+                const allocation& a = *step.allocated;
+                close(a.ptr, rec.timestamp_us); /* lost free */
+                realloc_chain chain;
+                chain.origin = chain.grow_site = a.site;
+                chain.tag = a.tag;
+                chain.first_ptr = chain.final_ptr = a.ptr;
+                chain.initial_size = chain.final_size = chain.max_size = a.size;
+                chain.start_us = a.time_us;
+                open[a.ptr] = chain;
+            }
+            continue;
+        }
+
+        /* A realloc continues the chain of its old pointer */
+        uint32_t old_ptr = rec.arg1;
+        realloc_chain chain;
+        auto it = open.find(old_ptr);
+        if (it != open.end()) {
+            chain = it->second;
+            open.erase(it);
+        } else {
+            /* Creating malloc not in the trace: the chain starts here */
+            chain.origin = callsite_of(rec);
+            chain.tag = rec.tag;
+            chain.first_ptr = old_ptr;
+            chain.initial_size = step.freed ? step.freed->size : 0;
+            chain.start_us = rec.timestamp_us;
+        }
+
+        chain.reallocs++;
+        chain.grow_site = callsite_of(rec);
+        if (!step.allocated) {
+            /* realloc(p, 0) */
+            chain.final_size = 0;
+            chain.end_us = rec.timestamp_us;
+            collector.close(chain);
+            continue;
+        }
+
+        const allocation& a = *step.allocated;
+        if (a.ptr != old_ptr) {
+            chain.moves++;
+            chain.copied_bytes += std::min(step.freed ? step.freed->size : 0u, a.size);
+            close(a.ptr, rec.timestamp_us); /* lost free */
+        }
+        chain.final_ptr = a.ptr;
+        chain.final_size = a.size;
+        chain.max_size = std::max(chain.max_size, a.size);
+        open[a.ptr] = chain;
+    }
+
+    for (auto& [ptr, chain] : open) {
+        chain.end_us = replay.time_us();
+        chain.live = true;
+        collector.close(chain);
+    }
+    return collector.finish();
+}
+
+void write_chain_report(const chain_report& report, const symbolizer& symbols, size_t top, std::ostream& out)
+{
+    char line[200];
+    std::snprintf(line, sizeof(line),
+                  "%" PRIu64 " realloc chains: %" PRIu64 " reallocs, %" PRIu64 " moves, %" PRIu64 " bytes copied\n",
+                  report.chains, report.reallocs, report.moves, report.copied_bytes);
+    out << line;
+    if (report.chains == 0) {
+        return;
+    }
+
+    out << "\nby origin callsite (reserve = largest final size):\n";
+    out << "      copied    moves  reallocs  chains    reserve  callsite\n";
+    for (size_t i = 0; i < report.by_site.size() && i < top; i++) {
+        const chain_site_summary& s = report.by_site[i];
+        std::snprintf(line, sizeof(line), "  %10" PRIu64 " %8" PRIu64 "  %8" PRIu64 "  %6" PRIu64 " %10" PRIu32 "  ",
+                      s.copied_bytes, s.moves, s.reallocs, s.chains, s.max_final_size);
+        out << line << symbols.name(s.origin) << "\n";
+    }
+    if (report.by_site.size() > top) {
+        out << "  (" << report.by_site.size() - top << " more callsites)\n";
+    }
+
+    out << "\ncostliest chains:\n";
+    out << "      copied    moves  reallocs        sizes          lifetime us  origin / last realloc\n";
+    for (size_t i = 0; i < report.top.size() && i < top; i++) {
+        const realloc_chain& c = report.top[i];
+        std::snprintf(line, sizeof(line),
+                      "  %10" PRIu64 " %8" PRIu64 "  %8" PRIu64 "  %6" PRIu32 " -> %-6" PRIu32 " %10" PRIu64 "%s  ",
+                      c.copied_bytes, c.moves, c.reallocs, c.initial_size, c.final_size, c.end_us - c.start_us,
+                      c.live ? "+" : " ");
+        out << line << symbols.name(c.origin);
+        if (c.grow_site != c.origin) {
+            out << " / " << symbols.name(c.grow_site);
+        }
+        out << "\n";
+    }
+}
+
+}  // namespace heapinst::analyzer
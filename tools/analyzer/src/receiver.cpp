@@ -0,0 +1,408 @@
+/**
+ * @file receiver.cpp
+ * @brief Frame decoding, sequence tracking and segment storage.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/receiver.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace heapinst::analyzer
+{
+
+static_assert(sizeof(heap_inst_frame_header_t) == 16, "frame header layout");
+
+namespace
+{
+
+constexpr size_t kHeader = sizeof(heap_inst_frame_header_t);
+constexpr uint32_t kMagic = HEAP_INST_FRAME_MAGIC;
+
+uint64_t now_seconds()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+}  // namespace
+
+std::vector<uint8_t> encode_frame(uint16_t device_id, uint32_t sequence, const record* records, size_t count)
+{
+    heap_inst_frame_header_t header{HEAP_INST_FRAME_MAGIC, device_id, static_cast<uint16_t>(count), sequence, 0};
+    uint32_t crc = heap_inst_crc32(0, &header, HEAP_INST_FRAME_CRC_OFFSET);
+    header.crc32 = heap_inst_crc32(crc, records, count * sizeof(record));
+
+    std::vector<uint8_t> frame(kHeader + count * sizeof(record));
+    std::memcpy(frame.data(), &header, kHeader);
+    if (count != 0) {
+        std::memcpy(frame.data() + kHeader, records, count * sizeof(record));
+    }
+    return frame;
+}
+
+bool frame_decoder::deliver(const uint8_t* data, size_t len)
+{
+    heap_inst_frame_header_t header;
+    std::memcpy(&header, data, kHeader);
+    uint32_t crc = heap_inst_crc32(0, data, HEAP_INST_FRAME_CRC_OFFSET);
+    crc = heap_inst_crc32(crc, data + kHeader, len - kHeader);
+    if (crc != header.crc32) {
+        counters_.crc_errors++;
+        return false;
+    }
+
+    size_t count = header.record_count;
+    records_.resize(count);
+    if (count != 0) {
+        std::memcpy(records_.data(), data + kHeader, count * sizeof(record));
+    }
+    counters_.frames++;
+    on_frame_(header, records_.data(), count);
+    return true;
+}
+
+void frame_decoder::feed_datagram(const void* data, size_t len)
+{
+    counters_.bytes += len;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    heap_inst_frame_header_t header;
+    if (len < kHeader) {
+        counters_.malformed++;
+        return;
+    }
+    std::memcpy(&header, bytes, kHeader);
+    if (header.magic != HEAP_INST_FRAME_MAGIC || header.record_count > HEAP_INST_FRAME_MAX_RECORDS ||
+        len != kHeader + header.record_count * sizeof(record)) {
+        counters_.malformed++;
+        return;
+    }
+    deliver(bytes, len);
+}
+
+void frame_decoder::feed_stream(const void* data, size_t len)
+{
+    counters_.bytes += len;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    pending_.insert(pending_.end(), bytes, bytes + len);
+
+    const uint8_t* magic = reinterpret_cast<const uint8_t*>(&kMagic);
+    size_t pos = 0;
+    while (pending_.size() - pos >= kHeader) {
+        auto begin = pending_.begin() + static_cast<std::ptrdiff_t>(pos);
+        auto found = std::search(begin, pending_.end(), magic, magic + sizeof(kMagic));
+        if (found == pending_.end()) {
+            /* Skip all but a possible partial magic at the end */
+            size_t keep = std::min(pending_.size() - pos, sizeof(kMagic) - 1);
+            counters_.resync_bytes += pending_.size() - pos - keep;
+            pos = pending_.size() - keep;
+            break;
+        }
+        size_t at = static_cast<size_t>(found - pending_.begin());
+        counters_.resync_bytes += at - pos;
+        pos = at;
+        if (pending_.size() - pos < kHeader) {
+            break;
+        }
+
+        heap_inst_frame_header_t header;
+        std::memcpy(&header, pending_.data() + pos, kHeader);
+        size_t frame_len = kHeader + header.record_count * sizeof(record);
+        if (header.record_count <= HEAP_INST_FRAME_MAX_RECORDS) {
+            if (pending_.size() - pos < frame_len) {
+                break;
+            }
+            if (deliver(pending_.data() + pos, frame_len)) {
+                pos += frame_len;
+                continue;
+            }
+        }
+        /* Corrupt frame or a false magic: rescan from the next byte */
+        counters_.resync_bytes++;
+        pos++;
+    }
+    pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(pos));
+}
+
+trace_receiver::trace_receiver(receiver_options options) : options_(std::move(options)) {}
+
+trace_receiver::~trace_receiver()
+{
+    try {
+        close_all();
+    } catch (const std::exception&) {
+        /* Held frames could not be written; still close every segment */
+        for (auto& [id, d] : devices_) {
+            close_segment(d);
+        }
+    }
+}
+
+trace_receiver::device& trace_receiver::device_for(uint16_t id)
+{
+    auto it = devices_.find(id);
+    if (it != devices_.end()) {
+        return it->second;
+    }
+
+    device& d = devices_[id];
+    d.id = id;
+    char name[16];
+    std::snprintf(name, sizeof(name), "dev%04x", id);
+    d.directory = (std::filesystem::path(options_.directory) / name).string();
+    std::filesystem::create_directories(d.directory);
+
+    /* Continue numbering after the segments of an earlier run */
+    for (const auto& entry : std::filesystem::directory_iterator(d.directory)) {
+        if (entry.path().extension() == ".bin") {
+            d.number = std::max<uint64_t>(d.number, std::strtoull(entry.path().stem().string().c_str(), nullptr, 10));
+        }
+    }
+    std::string index = d.directory + "/index.csv";
+    if (!std::filesystem::exists(index)) {
+        std::ofstream(index) << "segment,first_seq,last_seq,records,bytes,first_us,last_us,lost_frames\n";
+    }
+    return d;
+}
+
+void trace_receiver::open_segment(device& d)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%06" PRIu64 ".bin", ++d.number);
+    std::string path = d.directory + name;
+    d.file = std::fopen(path.c_str(), "wb");
+    if (d.file == nullptr) {
+        throw std::runtime_error("cannot create " + path + ": " + std::strerror(errno));
+    }
+    /* Large buffer: the receive loop must not stall on small writes */
+    std::setvbuf(d.file, nullptr, _IOFBF, 1 << 20);
+    d.opened_s = now_seconds();
+    d.seg_bytes = d.seg_records = d.seg_lost = 0;
+    d.first_us = d.last_us = 0;
+    d.counters.segments++;
+}
+
+void trace_receiver::close_segment(device& d)
+{
+    if (d.file == nullptr) {
+        return;
+    }
+    std::fclose(d.file);
+    d.file = nullptr;
+
+    char row[200];
+    std::snprintf(row, sizeof(row), "%06" PRIu64 ".bin,%" PRIu32 ",%" PRIu32 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+                  ",%" PRIu64 "\n",
+                  d.number, d.first_seq, d.last_seq, d.seg_records, d.seg_bytes, d.first_us, d.last_us, d.seg_lost);
+    std::ofstream(d.directory + "/index.csv", std::ios::app) << row;
+}
+
+trace_receiver::seen_frame& trace_receiver::history_slot(device& d, uint32_t sequence)
+{
+    if (d.history.empty()) {
+        d.history.resize(std::max<uint32_t>(options_.history_frames, 1));
+    }
+    return d.history[sequence % d.history.size()];
+}
+
+void trace_receiver::on_frame(const heap_inst_frame_header_t& header, const record* records, size_t count)
+{
+    device& d = device_for(header.device_id);
+    uint32_t sequence = header.sequence;
+
+    if (d.seen && sequence != d.expected) {
+        /* A run visibly starts at sequence 0 or with an INIT record */
+        bool run_start = sequence == 0 || (count != 0 && records[0].operation == HEAP_OP_INIT);
+        bool restarted = run_start;
+        if (!restarted && sequence - d.expected >= (1u << 31)) {
+            /* Behind: a late frame of a gap, a duplicate, or a new run */
+            seen_frame& slot = history_slot(d, sequence);
+            if (d.missing.erase(sequence) != 0) {
+                /* Too late to write in order, but not lost after all */
+                d.counters.lost_frames--;
+                d.counters.late_frames++;
+                slot = {sequence, header.crc32, true};
+                return;
+            }
+            if (slot.valid && slot.sequence == sequence && slot.crc == header.crc32) {
+                d.counters.late_frames++;
+                return;
+            }
+            restarted = true;
+        }
+        if (restarted) {
+            /* Finish the old run; a new one whose start was not seen began at 0 */
+            release(d, true);
+            d.history.clear();
+            d.missing.clear();
+            d.expected = run_start ? sequence : 0;
+            d.counters.restarts++;
+        }
+    }
+    if (!d.seen) {
+        d.seen = true;
+        d.expected = sequence;
+    }
+
+    for (const held_frame& h : d.held) {
+        if (h.sequence == sequence) {
+            d.counters.late_frames++; /* duplicate of a held frame */
+            return;
+        }
+    }
+    d.held.push_back({sequence, header.crc32, std::vector<record>(records, records + count)});
+    release(d, false);
+}
+
+void trace_receiver::release(device& d, bool drain)
+{
+    uint64_t lost = 0;
+    while (!d.held.empty()) {
+        /* Held frame closest ahead of expected */
+        auto next = std::min_element(d.held.begin(), d.held.end(), [&](const held_frame& x, const held_frame& y) {
+            return x.sequence - d.expected < y.sequence - d.expected;
+        });
+        if (next->sequence != d.expected) {
+            if (!drain && d.held.size() <= options_.reorder_frames) {
+                break;
+            }
+            /* Give up on the gap; remember its most recent frames */
+            uint32_t gap = next->sequence - d.expected;
+            uint32_t remembered = std::min<uint32_t>(gap, std::max<uint32_t>(options_.history_frames, 1));
+            for (uint32_t i = gap - remembered; i < gap; i++) {
+                d.missing.insert(d.expected + i);
+            }
+            lost += gap;
+            d.counters.lost_frames += gap;
+            d.expected = next->sequence;
+        }
+        held_frame frame = std::move(*next);
+        d.held.erase(next);
+        write_frame(d, frame, lost);
+        lost = 0;
+    }
+    /* Frames further back than the history can no longer be told apart */
+    while (d.missing.size() > std::max<uint32_t>(options_.history_frames, 1)) {
+        d.missing.erase(d.missing.begin());
+    }
+}
+
+void trace_receiver::write_frame(device& d, const held_frame& frame, uint64_t lost)
+{
+    d.expected = frame.sequence + 1;
+    history_slot(d, frame.sequence) = {frame.sequence, frame.crc, true};
+
+    if (d.file == nullptr) {
+        open_segment(d);
+        d.first_seq = frame.sequence;
+    }
+    size_t count = frame.records.size();
+    size_t bytes = count * sizeof(record);
+    if (count != 0 && std::fwrite(frame.records.data(), sizeof(record), count, d.file) != count) {
+        throw std::runtime_error("write failed in " + d.directory + ": " + std::strerror(errno));
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (d.seg_records + i == 0) {
+            d.first_us = frame.records[i].timestamp_us;
+        }
+        d.last_us = frame.records[i].timestamp_us;
+    }
+    d.last_seq = frame.sequence;
+    d.seg_records += count;
+    d.seg_bytes += bytes;
+    d.seg_lost += lost;
+    d.counters.frames++;
+    d.counters.records += count;
+    d.counters.bytes += bytes;
+
+    if (d.seg_bytes >= options_.segment_bytes) {
+        close_segment(d);
+    }
+}
+
+void trace_receiver::rotate_aged(uint64_t now_s)
+{
+    if (options_.segment_seconds == 0) {
+        return;
+    }
+    for (auto& [id, d] : devices_) {
+        if (d.file != nullptr && now_s - d.opened_s >= options_.segment_seconds) {
+            close_segment(d);
+        }
+    }
+}
+
+void trace_receiver::close_all()
+{
+    for (auto& [id, d] : devices_) {
+        release(d, true);
+        close_segment(d);
+    }
+}
+
+std::map<uint16_t, device_counters> trace_receiver::counters() const
+{
+    std::map<uint16_t, device_counters> out;
+    for (const auto& [id, d] : devices_) {
+        out[id] = d.counters;
+    }
+    return out;
+}
+
+void trace_receiver::write_metrics(std::ostream& out,
+                                   const std::vector<std::pair<std::string, source_counters>>& sources) const
+{
+    struct metric {
+        const char* name;
+        const char* help;
+        uint64_t device_counters::*field;
+    };
+    static const metric kDeviceMetrics[] = {
+        {"frames", "Frames accepted", &device_counters::frames},
+        {"records", "Records written", &device_counters::records},
+        {"bytes", "Record bytes written", &device_counters::bytes},
+        {"lost_frames", "Frames missing from the sequence", &device_counters::lost_frames},
+        {"late_frames", "Late or duplicate frames dropped", &device_counters::late_frames},
+        {"restarts", "Sequence restarts (device reboots)", &device_counters::restarts},
+        {"segments", "Segments opened", &device_counters::segments},
+    };
+    for (const metric& m : kDeviceMetrics) {
+        out << "# HELP heapinst_receiver_" << m.name << "_total " << m.help << "\n";
+        out << "# TYPE heapinst_receiver_" << m.name << "_total counter\n";
+        for (const auto& [id, d] : devices_) {
+            char device[8];
+            std::snprintf(device, sizeof(device), "%04x", id);
+            out << "heapinst_receiver_" << m.name << "_total{device=\"" << device << "\"} " << d.counters.*m.field
+                << "\n";
+        }
+    }
+
+    struct source_metric {
+        const char* name;
+        const char* help;
+        uint64_t source_counters::*field;
+    };
+    static const source_metric kSourceMetrics[] = {
+        {"received_bytes", "Bytes received", &source_counters::bytes},
+        {"crc_errors", "Frames failing the CRC", &source_counters::crc_errors},
+        {"malformed", "Datagrams that are not one whole frame", &source_counters::malformed},
+        {"resync_bytes", "Stream bytes skipped to find a frame", &source_counters::resync_bytes},
+    };
+    for (const source_metric& m : kSourceMetrics) {
+        out << "# HELP heapinst_receiver_" << m.name << "_total " << m.help << "\n";
+        out << "# TYPE heapinst_receiver_" << m.name << "_total counter\n";
+        for (const auto& [name, s] : sources) {
+            out << "heapinst_receiver_" << m.name << "_total{source=\"" << name << "\"} " << s.*m.field << "\n";
+        }
+    }
+}
+
+}  // namespace heapinst::analyzer
@@ -0,0 +1,146 @@
+/**
+ * @file replay.cpp
+ * @brief Live-set reconstruction from MALLOC/REALLOC/FREE records.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/replay.hpp"
+
+#include <stdexcept>
+
+namespace heapinst::analyzer
+{
+
+allocation heap_replay::insert(const record& rec, uint32_t ptr, uint32_t size)
+{
+    uint32_t usable = (rec.flags & HEAP_RECORD_FLAG_USABLE_SIZE) ? rec.arg4 : 0;
+    allocation a{.ptr = ptr,
+                 .size = size,
+                 .usable = usable,
+                 .site = callsite_of(rec),
+                 .tag = rec.tag,
+                 .time_us = rec.timestamp_us,
+                 .index = records_ - 1};
+    live_[ptr] = a;
+    live_bytes_ += size;
+    live_extra_ += (usable > size) ? usable - size : 0;
+    total_allocs_++;
+    total_bytes_ += size;
+    if (live_bytes_ > peak_bytes_) {
+        peak_bytes_ = live_bytes_;
+        peak_time_us_ = rec.timestamp_us;
+        peak_index_ = records_ - 1;
+    }
+    return a;
+}
+
+std::optional<allocation> heap_replay::erase(uint32_t ptr)
+{
+    auto it = live_.find(ptr);
+    if (it == live_.end()) {
+        return std::nullopt;
+    }
+    allocation a = it->second;
+    live_bytes_ -= a.size;
+    live_extra_ -= (a.usable > a.size) ? a.usable - a.size : 0;
+    live_.erase(it);
+    return a;
+}
+
+replay_step heap_replay::apply(const record& rec)
+{
+    replay_step step;
+
+    if (records_ == 0) {
+        first_time_us_ = rec.timestamp_us;
+    }
+    records_++;
+    time_us_ = rec.timestamp_us;
+
+    switch (rec.operation) {
+        case HEAP_OP_INIT:
+            /* A new INIT means the target restarted: nothing survives it */
+            live_.clear();
+            live_bytes_ = 0;
+            live_extra_ = 0;
+            if (rec.arg3 & HEAP_INIT_FLAG_HEAP_INFO_VALID) {
+                heap_base_ = rec.arg1;
+                heap_size_ = rec.arg2;
+            }
+            break;
+
+        case HEAP_OP_MALLOC:
+            if (rec.arg2 == 0) {
+                failed_allocs_++;
+                break;
+            }
+            /* A block handed out twice means its free was lost */
+            step.freed = erase(rec.arg2);
+            step.allocated = insert(rec, rec.arg2, rec.arg1);
+            break;
+
+        case HEAP_OP_FREE:
+            if (rec.arg1 == 0) {
+                break;
+            }
+            step.freed = erase(rec.arg1);
+            if (!step.freed) {
+                unmatched_frees_++;
+            }
+            break;
+
+        case HEAP_OP_REALLOC: {
+            uint32_t old_ptr = rec.arg1;
+            uint32_t new_size = rec.arg2;
+            uint32_t new_ptr = rec.arg3;
+            if (new_ptr == 0 && new_size != 0) {
+                /* Failed: the old block is untouched */
+                failed_allocs_++;
+                break;
+            }
+            step.is_realloc = (old_ptr != 0);
+            if (old_ptr != 0) {
+                step.freed = erase(old_ptr);
+                if (!step.freed) {
+                    unmatched_frees_++;
+                }
+            }
+            if (new_ptr != 0) {
+                if (new_ptr != old_ptr) {
+                    /* Stale entry whose free was lost */
+                    erase(new_ptr);
+                }
+                step.allocated = insert(rec, new_ptr, new_size);
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    return step;
+}
+
+trace_point trace_point::parse(const std::string& text)
+{
+    trace_point point;
+    try {
+        if (text.empty() || text == "end") {
+            return point;
+        }
+        if (text.rfind("marker:", 0) == 0) {
+            point.type = kind::marker;
+            point.value = std::stoull(text.substr(7), nullptr, 0);
+        } else {
+            point.type = kind::time;
+            point.value = std::stoull(text, nullptr, 0);
+        }
+    } catch (const std::logic_error&) {
+        throw std::invalid_argument("invalid trace point '" + text + "' (expected end, <us> or marker:<id>)");
+    }
+    return point;
+}
+
+}  // namespace heapinst::analyzer
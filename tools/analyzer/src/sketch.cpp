@@ -0,0 +1,132 @@
+/**
+ * @file sketch.cpp
+ * @brief DDSketch and log2 histogram.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/sketch.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <stdexcept>
+
+namespace heapinst::analyzer
+{
+
+dd_sketch::dd_sketch(double alpha, size_t max_buckets)
+    : alpha_(alpha), gamma_log_(std::log((1.0 + alpha) / (1.0 - alpha))), max_buckets_(std::max<size_t>(max_buckets, 2))
+{
+    if (!(alpha > 0.0 && alpha < 1.0)) {
+        throw std::invalid_argument("sketch accuracy must be in (0, 1)");
+    }
+}
+
+int32_t dd_sketch::index_of(double value) const
+{
+    return static_cast<int32_t>(std::ceil(std::log(value) / gamma_log_));
+}
+
+double dd_sketch::value_of(int32_t index) const
+{
+    /* Midpoint (in relative terms) of (gamma^(i-1), gamma^i] */
+    double gamma = std::exp(gamma_log_);
+    return 2.0 * std::exp(gamma_log_ * index) / (gamma + 1.0);
+}
+
+void dd_sketch::add(double value, uint64_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    if (count_ == 0) {
+        min_ = max_ = value;
+    } else {
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+    count_ += count;
+    sum_ += value * static_cast<double>(count);
+
+    if (value < 1.0) {
+        zero_count_ += count;
+        return;
+    }
+    buckets_[index_of(value)] += count;
+    if (buckets_.size() > max_buckets_) {
+        collapse();
+    }
+}
+
+void dd_sketch::collapse()
+{
+    /* Fold the lowest buckets into the first one kept */
+    while (buckets_.size() > max_buckets_) {
+        auto lowest = buckets_.begin();
+        uint64_t count = lowest->second;
+        buckets_.erase(lowest);
+        buckets_.begin()->second += count;
+    }
+}
+
+void dd_sketch::merge(const dd_sketch& other)
+{
+    if (other.alpha_ != alpha_) {
+        throw std::invalid_argument("cannot merge sketches of different accuracy");
+    }
+    if (other.count_ == 0) {
+        return;
+    }
+    if (count_ == 0) {
+        min_ = other.min_;
+        max_ = other.max_;
+    } else {
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    zero_count_ += other.zero_count_;
+    for (const auto& [index, count] : other.buckets_) {
+        buckets_[index] += count;
+    }
+    collapse();
+}
+
+double dd_sketch::quantile(double q) const
+{
+    if (count_ == 0) {
+        return 0.0;
+    }
+    q = std::clamp(q, 0.0, 1.0);
+    if (q == 1.0) {
+        return max_;
+    }
+    double rank = q * static_cast<double>(count_ - 1);
+    uint64_t seen = zero_count_;
+    if (static_cast<double>(seen) > rank) {
+        return std::clamp(0.0, min_, max_);
+    }
+    for (const auto& [index, count] : buckets_) {
+        seen += count;
+        if (static_cast<double>(seen) > rank) {
+            return std::clamp(value_of(index), min_, max_);
+        }
+    }
+    return max_;
+}
+
+void log2_histogram::add(uint64_t value, uint64_t count)
+{
+    buckets[value ? std::bit_width(value) : 0] += count;
+}
+
+void log2_histogram::merge(const log2_histogram& other)
+{
+    for (size_t i = 0; i < buckets.size(); i++) {
+        buckets[i] += other.buckets[i];
+    }
+}
+
+}  // namespace heapinst::analyzer
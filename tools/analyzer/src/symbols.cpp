@@ -0,0 +1,160 @@
+/**
+ * @file symbols.cpp
+ * @brief nm and site-table based callsite resolution.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/symbols.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace heapinst::analyzer
+{
+
+namespace
+{
+
+bool parse_hex(const std::string& token, uint64_t& value)
+{
+    if (token.empty()) {
+        return false;
+    }
+    size_t used = 0;
+    try {
+        value = std::stoull(token, &used, 16);
+    } catch (const std::logic_error&) {
+        return false;
+    }
+    return used == token.size();
+}
+
+std::ifstream open_text(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    return in;
+}
+
+}  // namespace
+
+void symbolizer::add_symbol(uint64_t address, uint64_t size, std::string name)
+{
+    symbols_.push_back({address, size, std::move(name)});
+    sorted_ = false;
+}
+
+void symbolizer::add_file(uint16_t file_id, std::string path) { files_[file_id] = std::move(path); }
+
+void symbolizer::load_nm(const std::string& path)
+{
+    std::ifstream in = open_text(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        /* "<addr> [<size>] <type> <name...>"; undefined symbols have no address */
+        std::istringstream fields(line);
+        std::string addr_text, second, third;
+        if (!(fields >> addr_text >> second)) {
+            continue;
+        }
+        uint64_t address = 0, size = 0;
+        if (!parse_hex(addr_text, address)) {
+            continue;
+        }
+        std::string type = second;
+        if (second.size() > 1 && parse_hex(second, size) && (fields >> third)) {
+            type = third;
+        }
+        if (type.size() != 1 || std::string("TtWw").find(type[0]) == std::string::npos) {
+            continue; /* only code symbols can be callsites */
+        }
+        std::string name;
+        std::getline(fields >> std::ws, name);
+        if (!name.empty()) {
+            add_symbol(address, size, std::move(name));
+        }
+    }
+}
+
+void symbolizer::load_site_table(const std::string& path)
+{
+    std::ifstream in = open_text(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string id_text, file;
+        uint64_t id = 0;
+        if (!(fields >> id_text) || !parse_hex(id_text.rfind("0x", 0) == 0 ? id_text.substr(2) : id_text, id)) {
+            continue;
+        }
+        std::getline(fields >> std::ws, file);
+        add_file(static_cast<uint16_t>(id), std::move(file));
+    }
+}
+
+const symbolizer::symbol* symbolizer::lookup(uint64_t address) const
+{
+    if (!sorted_) {
+        std::sort(symbols_.begin(), symbols_.end(),
+                  [](const symbol& a, const symbol& b) { return a.address < b.address; });
+        sorted_ = true;
+    }
+    auto it = std::upper_bound(symbols_.begin(), symbols_.end(), address,
+                               [](uint64_t addr, const symbol& s) { return addr < s.address; });
+    if (it == symbols_.begin()) {
+        return nullptr;
+    }
+    --it;
+    if (it->size != 0 && address >= it->address + it->size) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+frame symbolizer::resolve(const callsite& site) const
+{
+    frame f;
+    if (site.is_site_id) {
+        auto it = files_.find(static_cast<uint16_t>(site.site >> 16));
+        if (it != files_.end()) {
+            f.file = it->second;
+        }
+        f.line = site.site & 0xFFFFu;
+        return f;
+    }
+
+    if (site.site != 0) {
+        /* Return addresses point past the call; drop the Thumb bit too */
+        uint64_t pc = (site.site & ~1u) - 1;
+        if (const symbol* s = lookup(pc)) {
+            f.function = s->name;
+        }
+    }
+    return f;
+}
+
+std::string symbolizer::name(const callsite& site) const
+{
+    frame f = resolve(site);
+    if (!f.function.empty()) {
+        return f.function;
+    }
+    if (site.is_site_id) {
+        std::string file = f.file.empty() ? "file#" + std::to_string(site.site >> 16) : f.file;
+        return file + ":" + std::to_string(f.line);
+    }
+    char text[24];
+    std::snprintf(text, sizeof(text), "0x%08x", static_cast<unsigned>(site.site));
+    return text;
+}
+
+}  // namespace heapinst::analyzer
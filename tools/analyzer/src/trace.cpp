@@ -0,0 +1,114 @@
+/**
+ * @file trace.cpp
+ * @brief Binary trace file reading and writing.
+ *
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ */
+
+#include "heapInstAnalyzer/trace.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+namespace heapinst::analyzer
+{
+
+namespace
+{
+
+std::runtime_error file_error(const std::string& what, const std::string& path)
+{
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+}  // namespace
+
+trace_reader::trace_reader(const std::string& path, size_t block_records)
+    : path_(path), file_(std::fopen(path.c_str(), "rb"), &std::fclose), block_(block_records ? block_records : 1)
+{
+    if (!file_) {
+        throw file_error("cannot open", path);
+    }
+}
+
+bool trace_reader::fill()
+{
+    size_t n = std::fread(block_.data(), 1, block_.size() * sizeof(record), file_.get());
+    if (n % sizeof(record) != 0) {
+        /* Only possible at end of file: a record cut mid-write */
+        truncated_ = true;
+    }
+    pos_ = 0;
+    end_ = n / sizeof(record);
+    return end_ > 0;
+}
+
+bool trace_reader::next(record& out)
+{
+    if (pos_ >= end_ && !fill()) {
+        return false;
+    }
+    out = block_[pos_++];
+    count_++;
+    return true;
+}
+
+bool segment_reader::next(record& out)
+{
+    while (!reader_ || !reader_->next(out)) {
+        if (reader_) {
+            truncated_ = truncated_ || reader_->truncated();
+        }
+        if (index_ == paths_.size()) {
+            reader_.reset();
+            return false;
+        }
+        reader_ = std::make_unique<trace_reader>(paths_[index_++]);
+    }
+    return true;
+}
+
+std::vector<std::string> trace_segments(const std::string& path)
+{
+    if (!std::filesystem::is_directory(path)) {
+        return {path};
+    }
+    std::vector<std::string> segments;
+    for (const auto& entry : std::filesystem::directory_iterator(path)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".bin") {
+            segments.push_back(entry.path().string());
+        }
+    }
+    if (segments.empty()) {
+        throw std::runtime_error("no .bin segments in " + path);
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+std::vector<record> read_trace(const std::string& path)
+{
+    trace_reader reader(path);
+    std::vector<record> records;
+    record rec;
+    while (reader.next(rec)) {
+        records.push_back(rec);
+    }
+    return records;
+}
+
+void write_trace(const std::string& path, const std::vector<record>& records)
+{
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "wb"), &std::fclose);
+    if (!file) {
+        throw file_error("cannot create", path);
+    }
+    if (std::fwrite(records.data(), sizeof(record), records.size(), file.get()) != records.size()) {
+        throw file_error("cannot write", path);
+    }
+}
+
+}  // namespace heapinst::analyzer